@@ -0,0 +1,144 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "debug_log_decoder.h"
+#include "keyer_modes.h"
+
+static uint32_t debugLogDecoderReadValue(const uint8_t *data)
+{
+    return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+void debugLogDecoderInit(DebugLogDecoder *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+static bool debugLogDecoderValid(const DebugLogDecoder *decoder)
+{
+    if (decoder->frame[1] == 0 || decoder->frame[1] >= DEBUG_LOG_MESSAGE_COUNT) {
+        return false;
+    }
+
+    uint8_t checksum = 0;
+    for (uint8_t i = 1; i < DEBUG_LOG_FRAME_SIZE - 1; i++) {
+        checksum += decoder->frame[i];
+    }
+    return checksum == decoder->frame[DEBUG_LOG_FRAME_SIZE - 1];
+}
+
+// Restarts from the next sync byte inside the rejected frame, if any
+static void debugLogDecoderResync(DebugLogDecoder *decoder)
+{
+    uint8_t i = 1;
+    while (i < decoder->length && decoder->frame[i] != DEBUG_LOG_FRAME_SYNC) {
+        i++;
+    }
+    memmove(decoder->frame, &decoder->frame[i], decoder->length - i);
+    decoder->skippedByteCount += i;
+    decoder->length -= i;
+}
+
+bool debugLogDecoderFeed(DebugLogDecoder *decoder, uint8_t value, DebugLogEntry *entry)
+{
+    if (decoder->length == 0 && value != DEBUG_LOG_FRAME_SYNC) {
+        decoder->skippedByteCount++;
+        return false;
+    }
+
+    decoder->frame[decoder->length++] = value;
+    // The bytes kept after a resync may complete another frame
+    while (decoder->length == DEBUG_LOG_FRAME_SIZE) {
+        if (!debugLogDecoderValid(decoder)) {
+            decoder->invalidFrameCount++;
+            debugLogDecoderResync(decoder);
+            continue;
+        }
+
+        entry->message = decoder->frame[1];
+        entry->ticks = hostTicksExtend(&decoder->ticks, debugLogDecoderReadValue(&decoder->frame[2]));
+        for (uint8_t i = 0; i < DEBUG_LOG_ARGUMENTS; i++) {
+            entry->arguments[i] = debugLogDecoderReadValue(&decoder->frame[6 + 4 * i]);
+        }
+        if (entry->message == DEBUG_LOG_MESSAGE_DROPPED) {
+            decoder->droppedRecordCount += entry->arguments[0];
+        }
+
+        decoder->frameCount++;
+        decoder->length = 0;
+        return true;
+    }
+    return false;
+}
+
+static const char *debugLogPinName(uint32_t pin)
+{
+    switch (pin) {
+        case DEBUG_LOG_PIN_RING:
+            return "ring";
+        case DEBUG_LOG_PIN_TIP:
+            return "tip";
+        case DEBUG_LOG_PIN_PTT:
+            return "PTT";
+        default:
+            return "unknown";
+    }
+}
+
+void debugLogFormat(const DebugLogEntry *entry, char *text, size_t size)
+{
+    const uint32_t *arguments = entry->arguments;
+
+    switch (entry->message) {
+        case DEBUG_LOG_MESSAGE_DROPPED:
+            snprintf(text, size, "Dropped records: %u", arguments[0]);
+            break;
+        case DEBUG_LOG_MESSAGE_INTERRUPT:
+            snprintf(text, size, "Interrupt: %s %s", debugLogPinName(arguments[0]), arguments[1] ? "high" : "low");
+            break;
+        case DEBUG_LOG_MESSAGE_TIMING:
+            snprintf(text, size, "Timing: wpm: %u dit: %u dah: %u pause: %u ahead: %u", arguments[0],
+                    arguments[1] & 0xFFFF, arguments[1] >> 16, arguments[2] & 0xFFFF, arguments[2] >> 16);
+            break;
+        case DEBUG_LOG_MESSAGE_SCHEDULE:
+            snprintf(text, size, "Scheduling event: ticks: %u start: %u end: %u %s", (uint32_t) entry->ticks,
+                    arguments[0], arguments[1], arguments[2] == KEYER_ACTION_DAH ? "dah" : "dit");
+            break;
+        case DEBUG_LOG_MESSAGE_KEYER_MODE:
+            snprintf(text, size, "Keyer mode: %u", arguments[0]);
+            break;
+        case DEBUG_LOG_MESSAGE_KEY:
+            snprintf(text, size, "Keying: 0x%02x %s", (unsigned) (arguments[0] & 0xff), arguments[1] ? "on" : "off");
+            break;
+        case DEBUG_LOG_MESSAGE_SPEED:
+            snprintf(text, size, "Raw speed: %u speed: %u", arguments[0], arguments[1]);
+            break;
+        case DEBUG_LOG_MESSAGE_PITCH:
+            snprintf(text, size, "Raw pitch: %u tuning word: %u", arguments[0], arguments[1]);
+            break;
+        case DEBUG_LOG_MESSAGE_PTT:
+            snprintf(text, size, "PTT %s", arguments[0] ? "on" : "off");
+            break;
+        default:
+            snprintf(text, size, "Unknown message %u", entry->message);
+            break;
+    }
+}
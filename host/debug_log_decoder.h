@@ -0,0 +1,60 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Host-side decoder and formatter of the binary debug log sent over the CDC serial port
+ * (see src/debug_log.h and src/debug_log_format.h).
+ *
+ * Bytes are fed one at a time as they are read from the serial port. The decoder resynchronizes on the frame
+ * sync byte after any invalid frame, so the other serial output between the frames is skipped. The 32-bit tick
+ * timestamps are extended to 64 bits. debugLogFormat() turns a record back into the text the firmware used to
+ * print with the DEBUG_ defines.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_DEBUG_LOG_DECODER_H
+#define WRC_MORSE_KEY_ADAPTER_DEBUG_LOG_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "debug_log_format.h"
+#include "host_ticks.h"
+
+struct DebugLogEntry {
+    uint8_t message;
+    uint64_t ticks;
+    uint32_t arguments[DEBUG_LOG_ARGUMENTS];
+};
+
+struct DebugLogDecoder {
+    uint8_t frame[DEBUG_LOG_FRAME_SIZE];
+    uint8_t length;
+    HostTicks ticks;
+    uint32_t frameCount;
+    uint32_t invalidFrameCount;
+    uint32_t skippedByteCount;
+    uint32_t droppedRecordCount;
+};
+
+void debugLogDecoderInit(DebugLogDecoder *decoder);
+
+// Feeds one received byte to the decoder. Returns true when the byte completes a valid frame, which is written to entry.
+bool debugLogDecoderFeed(DebugLogDecoder *decoder, uint8_t value, DebugLogEntry *entry);
+
+// Formats the entry as text without the tick
+void debugLogFormat(const DebugLogEntry *entry, char *text, size_t size);
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Extension of the 32-bit firmware tick timestamps to 64 bits on the host, so that they keep
+ * increasing when the firmware tick counter wraps around (every ~38 hours).
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_HOST_TICKS_H
+#define WRC_MORSE_KEY_ADAPTER_HOST_TICKS_H
+
+#include <stdint.h>
+
+struct HostTicks {
+    bool valid;
+    uint64_t lastTicks;
+};
+
+// Consecutive timestamps are assumed to be less than half of the wrap-around period apart
+inline uint64_t hostTicksExtend(HostTicks *hostTicks, uint32_t ticks)
+{
+    if (!hostTicks->valid) {
+        hostTicks->valid = true;
+        hostTicks->lastTicks = ticks;
+        return ticks;
+    }
+
+    hostTicks->lastTicks += (int32_t) (ticks - (uint32_t) hostTicks->lastTicks);
+    return hostTicks->lastTicks;
+}
+
+#endif
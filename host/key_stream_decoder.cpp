@@ -0,0 +1,95 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "key_stream_decoder.h"
+
+void keyStreamDecoderInit(KeyStreamDecoder *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+// Drops the given number of bytes from the start of the buffer, then any bytes up to the next sync byte
+static void keyStreamDecoderDiscard(KeyStreamDecoder *decoder, uint8_t length)
+{
+    uint8_t i = length;
+    while (i < decoder->length && decoder->frame[i] != KEY_STREAM_FRAME_SYNC) {
+        i++;
+    }
+    memmove(decoder->frame, &decoder->frame[i], decoder->length - i);
+    decoder->skippedByteCount += i - length;
+    decoder->length -= i;
+}
+
+// Restarts from the next sync byte inside the rejected frame, if any
+static void keyStreamDecoderResync(KeyStreamDecoder *decoder)
+{
+    decoder->invalidFrameCount++;
+    decoder->skippedByteCount++;
+    keyStreamDecoderDiscard(decoder, 1);
+}
+
+size_t keyStreamDecoderFeed(KeyStreamDecoder *decoder, uint8_t value, KeyStreamEdge *edges)
+{
+    if (decoder->length == 0 && value != KEY_STREAM_FRAME_SYNC) {
+        decoder->skippedByteCount++;
+        return 0;
+    }
+
+    decoder->frame[decoder->length++] = value;
+
+    // A rejected frame may hold the start of one or more valid frames, every sync byte in the buffer is
+    // a candidate that is validated in place before waiting for more bytes
+    size_t edgeCount = 0;
+    while (decoder->length >= 2) {
+        uint8_t count = decoder->frame[1];
+        if (count == 0 || count > KEY_STREAM_FRAME_MAX_RECORDS) {
+            keyStreamDecoderResync(decoder);
+            continue;
+        }
+
+        uint8_t length = KEY_STREAM_FRAME_OVERHEAD + count * KEY_STREAM_RECORD_SIZE;
+        if (decoder->length < length) {
+            break;
+        }
+
+        uint8_t checksum = 0;
+        for (uint8_t i = 1; i < length - 1; i++) {
+            checksum += decoder->frame[i];
+        }
+        if (checksum != decoder->frame[length - 1]) {
+            keyStreamDecoderResync(decoder);
+            continue;
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            const uint8_t *record = &decoder->frame[2 + i * KEY_STREAM_RECORD_SIZE];
+            uint32_t ticks = (uint32_t) record[1] | ((uint32_t) record[2] << 8) | ((uint32_t) record[3] << 16)
+                    | ((uint32_t) record[4] << 24);
+            KeyStreamEdge *edge = &edges[edgeCount++];
+            edge->input = record[0] & KEY_STREAM_INPUT_MASK;
+            edge->on = (record[0] & KEY_STREAM_RECORD_ON) != 0;
+            edge->ticks = hostTicksExtend(&decoder->ticks, ticks);
+        }
+
+        decoder->frameCount++;
+        keyStreamDecoderDiscard(decoder, length);
+    }
+    return edgeCount;
+}
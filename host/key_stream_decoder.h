@@ -0,0 +1,61 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Host-side decoder for the binary key edge stream sent over the CDC serial port
+ * (see src/key_stream.h and src/key_stream_format.h).
+ *
+ * Bytes are fed one at a time as they are read from the serial port. After an invalid frame the decoder
+ * rescans the bytes it has already received for the next frame sync byte, so a corrupted or truncated frame
+ * only loses itself, the stream can be opened at any point and text printed by the firmware in between frames
+ * is skipped. The 32-bit tick timestamps are extended
+ * to 64 bits so that they keep increasing when the firmware tick counter wraps around.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEY_STREAM_DECODER_H
+#define WRC_MORSE_KEY_ADAPTER_KEY_STREAM_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "key_stream_format.h"
+#include "host_ticks.h"
+
+struct KeyStreamEdge {
+    uint8_t input;
+    bool on;
+    uint64_t ticks;
+};
+
+struct KeyStreamDecoder {
+    uint8_t frame[KEY_STREAM_FRAME_OVERHEAD + KEY_STREAM_FRAME_MAX_RECORDS * KEY_STREAM_RECORD_SIZE];
+    uint8_t length;
+    HostTicks ticks;
+    uint32_t frameCount;
+    uint32_t invalidFrameCount;
+    uint32_t skippedByteCount;
+};
+
+void keyStreamDecoderInit(KeyStreamDecoder *decoder);
+
+/**
+ * Feeds one received byte to the decoder. Returns the number of edges written to edges when the byte
+ * completes one or more valid frames, otherwise 0. The frames completed by a single byte all fit in the frame
+ * buffer, so the edges array only needs to hold KEY_STREAM_FRAME_MAX_RECORDS entries.
+ */
+size_t keyStreamDecoderFeed(KeyStreamDecoder *decoder, uint8_t value, KeyStreamEdge *edges);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "raw_hid_decoder.h"
+
+void rawHidDecoderInit(RawHidDecoder *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+size_t rawHidDecoderDecode(RawHidDecoder *decoder, const uint8_t *report, size_t length, RawHidEdge *edges)
+{
+    if (length < RAW_HID_REPORT_SIZE || report[2] > RAW_HID_REPORT_MAX_EDGES) {
+        decoder->invalidReportCount++;
+        return 0;
+    }
+
+    uint8_t sequence = report[1];
+    if (decoder->hasSequence) {
+        decoder->lostReportCount += (uint8_t) (sequence - decoder->sequence - 1);
+    }
+    decoder->hasSequence = true;
+    decoder->sequence = sequence;
+    decoder->state = report[0];
+    decoder->reportCount++;
+
+    uint8_t count = report[2];
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t *record = &report[RAW_HID_REPORT_HEADER_SIZE + i * RAW_HID_RECORD_SIZE];
+        uint32_t ticks = (uint32_t) record[1] | ((uint32_t) record[2] << 8) | ((uint32_t) record[3] << 16)
+                | ((uint32_t) record[4] << 24);
+        edges[i].output = record[0] & RAW_HID_OUTPUT_MASK;
+        edges[i].on = (record[0] & RAW_HID_RECORD_ON) != 0;
+        edges[i].ticks = hostTicksExtend(&decoder->ticks, ticks);
+    }
+
+    return count;
+}
+
+bool rawHidDecoderIsOn(const RawHidDecoder *decoder, uint8_t output)
+{
+    return (decoder->state & (1 << (output & RAW_HID_OUTPUT_MASK))) != 0;
+}
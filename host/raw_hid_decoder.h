@@ -0,0 +1,59 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Host-side decoder for the vendor-defined raw HID reports of the adapter (see src/raw_hid.h
+ * and src/raw_hid_format.h). The report data is passed without the report ID byte.
+ * Lost reports are detected from gaps in the sequence numbers.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_RAW_HID_DECODER_H
+#define WRC_MORSE_KEY_ADAPTER_RAW_HID_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "raw_hid_format.h"
+#include "host_ticks.h"
+
+struct RawHidEdge {
+    uint8_t output;
+    bool on;
+    uint64_t ticks;
+};
+
+struct RawHidDecoder {
+    uint8_t state;
+    bool hasSequence;
+    uint8_t sequence;
+    HostTicks ticks;
+    uint32_t reportCount;
+    uint32_t lostReportCount;
+    uint32_t invalidReportCount;
+};
+
+void rawHidDecoderInit(RawHidDecoder *decoder);
+
+/**
+ * Decodes one input report. Returns the number of edges written to edges, which must hold
+ * RAW_HID_REPORT_MAX_EDGES entries. The output state after the report is in decoder->state.
+ */
+size_t rawHidDecoderDecode(RawHidDecoder *decoder, const uint8_t *report, size_t length, RawHidEdge *edges);
+
+// Returns true if the given output is on in the last decoded state
+bool rawHidDecoderIsOn(const RawHidDecoder *decoder, uint8_t output);
+
+#endif
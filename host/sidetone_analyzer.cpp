@@ -0,0 +1,307 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sidetone_analyzer.h"
+
+void sidetoneRendererInit(SidetoneRenderer *renderer, double periodSeconds)
+{
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->periodSeconds = periodSeconds;
+}
+
+static void sidetoneFilterDerivative(const double *state, double input, double *derivative)
+{
+    double v1 = state[1];
+    double v2 = state[2];
+    double v3 = state[3];
+    double i4 = (input - state[0] - v1) / SIDETONE_FILTER_R4;
+    double i5 = (v1 - v2) / SIDETONE_FILTER_R5;
+    double i6 = (v2 - v3) / SIDETONE_FILTER_R6;
+
+    derivative[0] = i4 / SIDETONE_FILTER_C3;
+    derivative[1] = (i4 - i5) / SIDETONE_FILTER_C4;
+    derivative[2] = (i5 - i6) / SIDETONE_FILTER_C5;
+    derivative[3] = (i6 - v3 / SIDETONE_FILTER_R7) / SIDETONE_FILTER_C6;
+}
+
+static void sidetoneFilterStep(double *state, double input, double step)
+{
+    double k1[4], k2[4], k3[4], k4[4], next[4];
+
+    sidetoneFilterDerivative(state, input, k1);
+    for (int i = 0; i < 4; i++) {
+        next[i] = state[i] + k1[i] * step / 2;
+    }
+    sidetoneFilterDerivative(next, input, k2);
+    for (int i = 0; i < 4; i++) {
+        next[i] = state[i] + k2[i] * step / 2;
+    }
+    sidetoneFilterDerivative(next, input, k3);
+    for (int i = 0; i < 4; i++) {
+        next[i] = state[i] + k3[i] * step;
+    }
+    sidetoneFilterDerivative(next, input, k4);
+    for (int i = 0; i < 4; i++) {
+        state[i] += (k1[i] + 2 * k2[i] + 2 * k3[i] + k4[i]) * step / 6;
+    }
+}
+
+// Integrates a piece of constant PWM output and samples the filter output at the sample times inside it
+static size_t sidetoneRenderPiece(SidetoneRenderer *renderer, double input, double length, float *samples)
+{
+    size_t count = 0;
+    if (length <= 0) {
+        return 0;
+    }
+
+    int steps = (int) ceil(length * SIDETONE_FILTER_STEPS / renderer->periodSeconds);
+    double step = length / steps;
+    for (int i = 0; i < steps; i++) {
+        double startTime = renderer->time;
+        double startOutput = renderer->output;
+        sidetoneFilterStep(renderer->state, input, step);
+        renderer->time += step;
+        renderer->output = renderer->state[3];
+
+        while (renderer->sampleTime <= renderer->time) {
+            double fraction = (renderer->sampleTime - startTime) / step;
+            samples[count++] = (float) (startOutput + (renderer->output - startOutput) * fraction);
+            renderer->sampleCount++;
+            renderer->sampleTime = (double) renderer->sampleCount / SIDETONE_SAMPLE_RATE;
+        }
+    }
+
+    return count;
+}
+
+size_t sidetoneRendererPeriod(SidetoneRenderer *renderer, uint16_t value, uint16_t top, float *samples)
+{
+    // Phase and frequency correct PWM: the output is high while the timer counts below the compare value, half
+    // of the high time before and half after BOTTOM, where the period starts with the overflow interrupt
+    double duty = value >= top ? 1.0 : (double) value / top;
+    double high = duty * renderer->periodSeconds / 2;
+    double low = renderer->periodSeconds - 2 * high;
+    size_t count = 0;
+
+    count += sidetoneRenderPiece(renderer, 1.0, high, &samples[count]);
+    count += sidetoneRenderPiece(renderer, 0.0, low, &samples[count]);
+    count += sidetoneRenderPiece(renderer, 1.0, high, &samples[count]);
+    return count;
+}
+
+static void sidetoneWriteLittleEndian(FILE *file, uint32_t value, int size)
+{
+    for (int i = 0; i < size; i++) {
+        fputc((value >> (8 * i)) & 0xFF, file);
+    }
+}
+
+bool sidetoneWriteWav(const char *path, const float *samples, size_t count)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint32_t dataSize = (uint32_t) (count * 2);
+    fwrite("RIFF", 1, 4, file);
+    sidetoneWriteLittleEndian(file, 36 + dataSize, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    sidetoneWriteLittleEndian(file, 16, 4);
+    sidetoneWriteLittleEndian(file, 1, 2);                         // PCM
+    sidetoneWriteLittleEndian(file, 1, 2);                         // Mono
+    sidetoneWriteLittleEndian(file, SIDETONE_SAMPLE_RATE, 4);
+    sidetoneWriteLittleEndian(file, SIDETONE_SAMPLE_RATE * 2, 4);  // Bytes per second
+    sidetoneWriteLittleEndian(file, 2, 2);                         // Bytes per frame
+    sidetoneWriteLittleEndian(file, 16, 2);                        // Bits per sample
+    fwrite("data", 1, 4, file);
+    sidetoneWriteLittleEndian(file, dataSize, 4);
+
+    for (size_t i = 0; i < count; i++) {
+        double value = samples[i] / SIDETONE_FULL_SCALE * 32767;
+        if (value > 32767) {
+            value = 32767;
+        } else if (value < -32768) {
+            value = -32768;
+        }
+        sidetoneWriteLittleEndian(file, (uint16_t) (int16_t) lrint(value), 2);
+    }
+
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
+
+static void sidetoneFft(double *real, double *imaginary, size_t size)
+{
+    for (size_t i = 1, j = 0; i < size; i++) {
+        size_t bit = size >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double swap = real[i];
+            real[i] = real[j];
+            real[j] = swap;
+            swap = imaginary[i];
+            imaginary[i] = imaginary[j];
+            imaginary[j] = swap;
+        }
+    }
+
+    for (size_t length = 2; length <= size; length <<= 1) {
+        double angle = -2 * M_PI / length;
+        for (size_t start = 0; start < size; start += length) {
+            for (size_t k = 0; k < length / 2; k++) {
+                double wr = cos(angle * k);
+                double wi = sin(angle * k);
+                size_t a = start + k;
+                size_t b = a + length / 2;
+                double tr = real[b] * wr - imaginary[b] * wi;
+                double ti = real[b] * wi + imaginary[b] * wr;
+                real[b] = real[a] - tr;
+                imaginary[b] = imaginary[a] - ti;
+                real[a] += tr;
+                imaginary[a] += ti;
+            }
+        }
+    }
+}
+
+// Rising zero crossings with hysteresis, interpolated between the samples
+static double sidetoneMeasureFrequency(const double *signal, size_t count, double threshold)
+{
+    bool armed = false;
+    double first = 0;
+    double last = 0;
+    size_t crossings = 0;
+
+    for (size_t i = 1; i < count; i++) {
+        if (signal[i] < -threshold) {
+            armed = true;
+        } else if (armed && signal[i - 1] < 0 && signal[i] >= 0) {
+            double time = (i - 1) + signal[i - 1] / (signal[i - 1] - signal[i]);
+            if (crossings == 0) {
+                first = time;
+            }
+            last = time;
+            crossings++;
+            armed = false;
+        }
+    }
+
+    return crossings < 2 ? 0 : (crossings - 1) * SIDETONE_SAMPLE_RATE / (last - first);
+}
+
+// Power of a tone as the sum of the bins in the main lobe around the given bin
+static double sidetoneLobePower(const double *power, long bin)
+{
+    double sum = 0;
+    for (long i = bin - SIDETONE_ANALYSIS_LOBE_BINS; i <= bin + SIDETONE_ANALYSIS_LOBE_BINS; i++) {
+        if (i >= 0 && i <= SIDETONE_ANALYSIS_SIZE / 2) {
+            sum += power[i];
+        }
+    }
+    return sum;
+}
+
+void sidetoneAnalyze(const float *samples, double frequency, SidetoneQuality *quality)
+{
+    static double real[SIDETONE_ANALYSIS_SIZE];
+    static double imaginary[SIDETONE_ANALYSIS_SIZE];
+    static double power[SIDETONE_ANALYSIS_SIZE / 2 + 1];
+    const size_t size = SIDETONE_ANALYSIS_SIZE;
+    const double binWidth = (double) SIDETONE_SAMPLE_RATE / size;
+
+    // The coupling capacitor removes the DC of the PWM, remove what is left of its settling
+    double mean = 0;
+    double peak = 0;
+    for (size_t i = 0; i < size; i++) {
+        mean += samples[i];
+    }
+    mean /= size;
+    for (size_t i = 0; i < size; i++) {
+        real[i] = samples[i] - mean;
+        imaginary[i] = 0;
+        peak = fmax(peak, fabs(real[i]));
+    }
+
+    memset(quality, 0, sizeof(*quality));
+    quality->frequency = sidetoneMeasureFrequency(real, size, peak / 4);
+
+    // Four term Blackman-Harris window, sidelobes below -92 dB
+    double windowPower = 0;
+    for (size_t i = 0; i < size; i++) {
+        double phase = 2 * M_PI * i / size;
+        double window = 0.35875 - 0.48829 * cos(phase) + 0.14128 * cos(2 * phase) - 0.01168 * cos(3 * phase);
+        real[i] *= window;
+        windowPower += window * window;
+    }
+    sidetoneFft(real, imaginary, size);
+    for (size_t i = 0; i <= size / 2; i++) {
+        power[i] = real[i] * real[i] + imaginary[i] * imaginary[i];
+    }
+
+    if (quality->frequency > 0) {
+        frequency = quality->frequency;
+    }
+    long fundamentalBin = lrint(frequency / binWidth);
+    double fundamental = sidetoneLobePower(power, fundamentalBin);
+    if (fundamental <= 0) {
+        return;
+    }
+    quality->level = sqrt(4 * fundamental / (size * windowPower));
+
+    double harmonics = 0;
+    for (int k = 2; k * frequency < SIDETONE_ANALYSIS_BAND_HIGH; k++) {
+        harmonics += sidetoneLobePower(power, lrint(k * frequency / binWidth));
+    }
+    quality->thd = sqrt(harmonics / fundamental);
+
+    long lowBin = (long) ceil(SIDETONE_ANALYSIS_BAND_LOW / binWidth);
+    long highBin = (long) floor(SIDETONE_ANALYSIS_BAND_HIGH / binWidth);
+    double total = 0;
+    double fundamentalPeak = 0;
+    double spur = 0;
+    long spurBin = 0;
+    for (long i = lowBin; i <= highBin; i++) {
+        total += power[i];
+
+        double harmonic = i * binWidth / frequency;
+        long nearest = lrint(harmonic);
+        if (nearest >= 1 && labs(i - lrint(nearest * frequency / binWidth)) <= SIDETONE_ANALYSIS_LOBE_BINS) {
+            if (nearest == 1) {
+                fundamentalPeak = fmax(fundamentalPeak, power[i]);
+            }
+        } else if (power[i] > spur) {
+            spur = power[i];
+            spurBin = i;
+        }
+    }
+    quality->thdNoise = sqrt(fmax(total - fundamental, 0) / fundamental);
+    if (spur > 0 && fundamentalPeak > 0) {
+        quality->spurDbc = 10 * log10(spur / fundamentalPeak);
+        quality->spurFrequency = spurBin * binWidth;
+    } else {
+        quality->spurDbc = -INFINITY;
+    }
+}
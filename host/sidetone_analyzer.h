@@ -0,0 +1,107 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Host-side model of the sidetone output and its spectral analysis. The renderer takes the PWM compare value
+ * written by the tick interrupt for each timer period, models the phase and frequency correct PWM pulse (high
+ * around the BOTTOM of the timer, value / TOP of the period) and the low-pass filter of the board between the PWM
+ * pin and the volume potentiometer, and samples the filter output at SIDETONE_SAMPLE_RATE for a WAV file:
+ *
+ *   PWM -- C3 100n -- R4 15k --+-- R5 15k --+-- R6 15k --+-- R7 10k volume potentiometer -- GND
+ *                              |            |            |
+ *                           C4 10n       C5 10n       C6 10n
+ *                              |            |            |
+ *                             GND          GND          GND
+ *
+ * The levels are fractions of the supply voltage. The analyzer measures the frequency of a steady tone from
+ * its zero crossings and the harmonics and spurs from a Blackman-Harris windowed FFT of SIDETONE_ANALYSIS_SIZE
+ * samples in the audio band.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_SIDETONE_ANALYZER_H
+#define WRC_MORSE_KEY_ADAPTER_SIDETONE_ANALYZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Above twice the PWM frequency, so that the ripple of the PWM carrier does not alias into the audio band
+#define SIDETONE_SAMPLE_RATE 96000
+
+// Filter components of the schematic, in ohms and farads
+#define SIDETONE_FILTER_C3 100e-9
+#define SIDETONE_FILTER_R4 15e3
+#define SIDETONE_FILTER_C4 10e-9
+#define SIDETONE_FILTER_R5 15e3
+#define SIDETONE_FILTER_C5 10e-9
+#define SIDETONE_FILTER_R6 15e3
+#define SIDETONE_FILTER_C6 10e-9
+#define SIDETONE_FILTER_R7 10e3
+
+// Integration steps per PWM period, about 2 us, well below the 100 us time constants of the filter
+#define SIDETONE_FILTER_STEPS 16
+
+// Amplitude of a full scale sine at the PWM pin, the full scale of the WAV samples
+#define SIDETONE_FULL_SCALE 0.5
+
+// Output samples of a PWM period at tick rates above SIDETONE_SAMPLE_RATE / 4
+#define SIDETONE_RENDER_MAX_SAMPLES 4
+
+// FFT size of the analysis, 0.34 s at SIDETONE_SAMPLE_RATE, and the audio band of the THD+N and the spurs
+#define SIDETONE_ANALYSIS_SIZE 32768
+#define SIDETONE_ANALYSIS_BAND_LOW 20.0
+#define SIDETONE_ANALYSIS_BAND_HIGH 20000.0
+
+// Bins on both sides of a tone that belong to the main lobe of the window
+#define SIDETONE_ANALYSIS_LOBE_BINS 6
+
+struct SidetoneRenderer {
+    // Voltages of C3, C4, C5 and C6
+    double state[4];
+    double periodSeconds;
+    double time;
+    double sampleTime;
+    double output;
+    uint64_t sampleCount;
+};
+
+struct SidetoneQuality {
+    // Measured frequency and the level of the fundamental as the amplitude in supply voltage fractions
+    double frequency;
+    double level;
+    // Total harmonic distortion, and with the noise, as ratios of the fundamental
+    double thd;
+    double thdNoise;
+    // Largest non-harmonic component in the audio band relative to the fundamental in dB, and its frequency
+    double spurDbc;
+    double spurFrequency;
+};
+
+// The period is the real time of a PWM timer period, 1 / tick rate
+void sidetoneRendererInit(SidetoneRenderer *renderer, double periodSeconds);
+
+/**
+ * Renders one PWM period with the given compare value and TOP of the timer. Writes the output samples that fall
+ * in the period to samples and returns their number, at most SIDETONE_RENDER_MAX_SAMPLES.
+ */
+size_t sidetoneRendererPeriod(SidetoneRenderer *renderer, uint16_t value, uint16_t top, float *samples);
+
+// Writes the samples as a 16-bit mono WAV file at SIDETONE_SAMPLE_RATE, returns false on a write error
+bool sidetoneWriteWav(const char *path, const float *samples, size_t count);
+
+// Analyzes SIDETONE_ANALYSIS_SIZE samples of a steady tone near the given frequency
+void sidetoneAnalyze(const float *samples, double frequency, SidetoneQuality *quality);
+
+#endif
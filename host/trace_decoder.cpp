@@ -0,0 +1,149 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "trace_decoder.h"
+
+static uint32_t traceDecoderReadValue(const uint8_t *data, uint8_t size)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        value |= (uint32_t) data[i] << (8 * i);
+    }
+    return value;
+}
+
+bool traceDecoderFindDump(const uint8_t *data, size_t length, TraceDump *dump)
+{
+    bool found = false;
+
+    for (size_t offset = 0; offset + TRACE_DUMP_OVERHEAD <= length; offset++) {
+        const uint8_t *header = &data[offset];
+        if (header[0] != TRACE_DUMP_SYNC || header[1] != TRACE_DUMP_VERSION) {
+            continue;
+        }
+
+        uint16_t recordCount = traceDecoderReadValue(&header[2], 2);
+        size_t dumpLength = TRACE_DUMP_OVERHEAD + (size_t) recordCount * TRACE_RECORD_SIZE;
+        if (offset + dumpLength > length) {
+            continue;
+        }
+
+        uint8_t checksum = 0;
+        for (size_t i = 1; i < dumpLength - 1; i++) {
+            checksum += header[i];
+        }
+        if (checksum != header[dumpLength - 1]) {
+            continue;
+        }
+
+        // The end is after the last record even if the tick counter wrapped around in between, which
+        // the recorder keeps within the wraparound-safe distance with gap records
+        TraceDecoder decoder;
+        traceDecoderInit(&decoder, traceDecoderReadValue(&header[4], 4));
+        for (uint16_t i = 0; i < recordCount; i++) {
+            const uint8_t *record = &header[TRACE_DUMP_HEADER_SIZE + i * TRACE_RECORD_SIZE];
+            TraceEvent event;
+            traceDecoderFeed(&decoder, record[0], (uint16_t) traceDecoderReadValue(&record[1], 2), &event);
+        }
+        dump->startTicks = traceDecoderReadValue(&header[4], 4);
+        dump->endTicks = decoder.ticks + (uint32_t) (traceDecoderReadValue(&header[8], 4) - (uint32_t) decoder.ticks);
+        dump->startFlags = header[12];
+        dump->startPins = header[13];
+        dump->startSwitches = header[14];
+        dump->startMode = header[15];
+        dump->startSpeed = traceDecoderReadValue(&header[16], 2);
+        dump->recordCount = recordCount;
+        dump->records = &header[TRACE_DUMP_HEADER_SIZE];
+        found = true;
+        offset += dumpLength - 1;
+    }
+
+    return found;
+}
+
+void traceDecoderInit(TraceDecoder *decoder, uint64_t startTicks)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->ticks = startTicks;
+}
+
+bool traceDecoderFeed(TraceDecoder *decoder, uint8_t event, uint16_t value, TraceEvent *decoded)
+{
+    uint8_t type = event & TRACE_EVENT_TYPE_MASK;
+
+    switch (type) {
+        case TRACE_EVENT_GAP:
+            decoder->pending = false;
+            decoder->ticks += (uint64_t) value << TRACE_GAP_SHIFT;
+            return false;
+        case TRACE_EVENT_MISSED:
+            decoder->pending = false;
+            decoder->missedEventCount += value;
+            return false;
+        case TRACE_EVENT_VALUE:
+            // A value without its event was cut off at the start of the trace
+            if (!decoder->pending) {
+                return false;
+            }
+            decoder->pending = false;
+            decoder->event.value = value;
+            *decoded = decoder->event;
+            return true;
+        default:
+            break;
+    }
+
+    decoder->ticks += (int16_t) value;
+    decoder->event.type = type;
+    decoder->event.argument = event & TRACE_EVENT_ARGUMENT_MASK;
+    decoder->event.value = 0;
+    decoder->event.ticks = decoder->ticks;
+
+    decoder->pending = type == TRACE_EVENT_SPEED || type == TRACE_EVENT_SERIAL;
+    if (decoder->pending) {
+        return false;
+    }
+    *decoded = decoder->event;
+    return true;
+}
+
+const char *traceDecoderEventName(uint8_t type)
+{
+    switch (type) {
+        case TRACE_EVENT_PIN:
+            return "pin";
+        case TRACE_EVENT_DEBOUNCED:
+            return "debounced";
+        case TRACE_EVENT_ELEMENT:
+            return "element";
+        case TRACE_EVENT_OUTPUT:
+            return "output";
+        case TRACE_EVENT_SWITCHES:
+            return "switches";
+        case TRACE_EVENT_MODE:
+            return "mode";
+        case TRACE_EVENT_SPEED:
+            return "speed";
+        case TRACE_EVENT_SERIAL:
+            return "serial";
+        default:
+            return "unknown";
+    }
+}
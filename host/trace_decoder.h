@@ -0,0 +1,73 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Host-side decoder for the trace dump of the adapter (see src/trace_recorder.h and src/trace_format.h).
+ *
+ * traceDecoderFindDump() finds the last valid dump in the bytes read from the serial port, which may contain
+ * other output before it. The records are then fed one at a time to a decoder, which turns the tick
+ * differences into 64-bit ticks and joins the events with the values following them.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_TRACE_DECODER_H
+#define WRC_MORSE_KEY_ADAPTER_TRACE_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "trace_format.h"
+
+struct TraceDump {
+    uint64_t startTicks;
+    uint64_t endTicks;
+    uint8_t startFlags;
+    uint8_t startPins;
+    uint8_t startSwitches;
+    uint8_t startMode;
+    uint16_t startSpeed;
+    uint16_t recordCount;
+    const uint8_t *records;
+};
+
+struct TraceEvent {
+    uint8_t type;
+    uint8_t argument;
+    uint16_t value;
+    uint64_t ticks;
+};
+
+struct TraceDecoder {
+    uint64_t ticks;
+    bool pending;
+    TraceEvent event;
+    uint32_t missedEventCount;
+};
+
+// Returns true if a valid dump was found in the data
+bool traceDecoderFindDump(const uint8_t *data, size_t length, TraceDump *dump);
+
+void traceDecoderInit(TraceDecoder *decoder, uint64_t startTicks);
+
+/**
+ * Feeds one record to the decoder. Returns true when the record completes an event, which is written
+ * to event. An event with a value is completed by the value record following it.
+ */
+bool traceDecoderFeed(TraceDecoder *decoder, uint8_t event, uint16_t value, TraceEvent *decoded);
+
+// Name of the event type for printing
+const char *traceDecoderEventName(uint8_t type);
+
+#endif
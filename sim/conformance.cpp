@@ -0,0 +1,247 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+#include "conformance.h"
+#include "simulator.h"
+#include "runner.h"
+#include "pins.h"
+#include "keyboard_definitions.h"
+#include "hid_report_queue.h"
+#include "keyer_queue.h"
+#include "keyer_config.h"
+#include "keyer_parameters.h"
+
+// The element timing conformance run starts once the firmware has settled after the start, and each pattern ends
+// after the keyer has been idle for more than a word space. An element or a space may be off from the PARIS timing
+// in real time by the 0.4 % difference between REFCLK and millisToPwmTicks() and a tick of the timing table
+// (0.13 % of a dit at 50 WPM), a paddle press may take up to one USB frame to key the sidetone and the key.
+#define SIM_CONFORMANCE_START_MILLIS 1000
+#define SIM_CONFORMANCE_IDLE_UNITS 10
+#define SIM_CONFORMANCE_TOLERANCE_PERCENT 0.55
+#define SIM_CONFORMANCE_LATENCY_TICKS 31
+
+// A paddle edge of a conformance pattern, at a time in dit durations from the start of the pattern
+struct ConformanceEdge {
+    double units;
+    uint8_t pin;
+    bool on;
+};
+
+// Paddle patterns of the element timing conformance run and the elements expected in iambic A and B
+struct ConformancePattern {
+    const char *name;
+    ConformanceEdge edges[4];
+    uint8_t edgeCount;
+    const char *expected[2];
+};
+
+static const ConformancePattern conformancePatterns[] = {
+    {"dit", {{0, PIN_KEY_TIP, true}, {0.5, PIN_KEY_TIP, false}}, 2, {".", "."}},
+    {"dah", {{0, PIN_KEY_RING, true}, {0.5, PIN_KEY_RING, false}}, 2, {"-", "-"}},
+    // Held paddles, released in the middle of the fifth dit and the fourth dah
+    {"held-dit", {{0, PIN_KEY_TIP, true}, {8.5, PIN_KEY_TIP, false}}, 2, {".....", "....."}},
+    {"held-dah", {{0, PIN_KEY_RING, true}, {13.5, PIN_KEY_RING, false}}, 2, {"----", "----"}},
+    // The dit paddle tapped during a dah is sent after it
+    {"memory", {{0, PIN_KEY_RING, true}, {0.5, PIN_KEY_RING, false}, {1, PIN_KEY_TIP, true},
+            {1.5, PIN_KEY_TIP, false}}, 4, {"-.", "-."}},
+    // Squeezes released in the middle of an element: iambic B sends one more alternating element
+    {"squeeze", {{0, PIN_KEY_TIP, true}, {0.25, PIN_KEY_RING, true}, {9.5, PIN_KEY_TIP, false},
+            {9.5, PIN_KEY_RING, false}}, 4, {".-.-", ".-.-."}},
+    {"squeeze-dit", {{0, PIN_KEY_TIP, true}, {0.25, PIN_KEY_RING, true}, {6.5, PIN_KEY_TIP, false},
+            {6.5, PIN_KEY_RING, false}}, 4, {".-.", ".-.-"}},
+    {"squeeze-dah", {{0, PIN_KEY_RING, true}, {0.25, PIN_KEY_TIP, true}, {4.5, PIN_KEY_RING, false},
+            {4.5, PIN_KEY_TIP, false}}, 4, {"-.", "-.-"}},
+};
+
+#define SIM_CONFORMANCE_PATTERN_COUNT (sizeof(conformancePatterns) / sizeof(ConformancePattern))
+
+static const uint8_t conformanceModes[2] = {KEYER_MODE_IAMBIC_A, KEYER_MODE_IAMBIC_B};
+static const char *conformanceModeNames[2] = {"iambic-a", "iambic-b"};
+
+struct ConformanceResult {
+    std::string elements;
+    uint32_t dropped;
+    uint32_t extra;
+    // Largest errors against the PARIS timing in real time, in ticks and in percent of the ideal duration
+    double durationError;
+    double durationErrorPercent;
+    double gapError;
+    double gapErrorPercent;
+    // Paddle press to the first sidetone edge and to the first HID report of the key
+    uint32_t latency;
+    uint32_t hidLatency;
+};
+
+// Length of the longest common subsequence, the elements of both sequences not in it are dropped or extra
+static size_t commonElements(const std::string &a, const std::string &b)
+{
+    std::vector<size_t> row(b.size() + 1, 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        size_t diagonal = 0;
+        for (size_t j = 0; j < b.size(); j++) {
+            size_t above = row[j + 1];
+            row[j + 1] = a[i] == b[j] ? diagonal + 1 : std::max(row[j + 1], row[j]);
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+static void recordError(double error, double idealTicks, double *worst, double *worstPercent)
+{
+    if (fabs(error) > fabs(*worst)) {
+        *worst = error;
+    }
+    double percent = error / idealTicks * 100.0;
+    if (fabs(percent) > fabs(*worstPercent)) {
+        *worstPercent = percent;
+    }
+}
+
+// Keys one pattern at the current speed from the current tick and measures the elements against the PARIS unit
+// of the speed in real time, 1.2 s / WPM. Returns when the keyer has been idle for SIM_CONFORMANCE_IDLE_UNITS.
+static void runConformancePattern(const ConformancePattern &pattern, double idealUnitTicks, const char *expected,
+        ConformanceResult *result)
+{
+    const std::vector<SimSidetoneEvent> &sidetoneEvents = simSidetoneEvents();
+    const std::vector<SimHidEvent> &hidEvents = simHidEvents();
+    size_t sidetoneStart = sidetoneEvents.size();
+    size_t hidStart = hidEvents.size();
+    uint32_t unitTicks = keyerParameters()->timing.ditDurationTicks;
+    uint32_t startTicks = simTicks();
+
+    for (uint8_t i = 0; i < pattern.edgeCount; i++) {
+        uint32_t edgeTicks = startTicks + (uint32_t) (pattern.edges[i].units * unitTicks + 0.5);
+        while (simTicks() < edgeTicks) {
+            simStep();
+        }
+        simSetDigital(pattern.edges[i].pin, pattern.edges[i].on ? PIN_STATE_KEY_ON : !PIN_STATE_KEY_ON);
+    }
+
+    uint32_t idleTicks = SIM_CONFORMANCE_IDLE_UNITS * unitTicks;
+    uint32_t idleSince = simTicks();
+    while (simTicks() - idleSince < idleTicks) {
+        simStep();
+        if (keyerQueueDepth() > 0 || pwmIsEnabled()) {
+            idleSince = simTicks();
+        }
+    }
+
+    *result = ConformanceResult();
+    uint32_t onTicks = 0;
+    uint32_t offTicks = 0;
+    bool first = true;
+    for (size_t i = sidetoneStart; i < sidetoneEvents.size(); i++) {
+        if (sidetoneEvents[i].on) {
+            if (first) {
+                result->latency = sidetoneEvents[i].tick - startTicks;
+            } else {
+                recordError(sidetoneEvents[i].tick - offTicks - idealUnitTicks, idealUnitTicks, &result->gapError,
+                        &result->gapErrorPercent);
+            }
+            onTicks = sidetoneEvents[i].tick;
+            first = false;
+        } else {
+            offTicks = sidetoneEvents[i].tick;
+            uint32_t duration = offTicks - onTicks;
+            bool dah = duration > 2 * unitTicks;
+            double idealTicks = (dah ? 3 : 1) * idealUnitTicks;
+            result->elements += dah ? '-' : '.';
+            recordError(duration - idealTicks, idealTicks, &result->durationError, &result->durationErrorPercent);
+        }
+    }
+    for (size_t i = hidStart; i < hidEvents.size(); i++) {
+        if (hidEvents[i].key == hidUsageForKey(KEYBOARD_KEY_STRAIGHT) && hidEvents[i].pressed) {
+            result->hidLatency = hidEvents[i].tick - startTicks;
+            break;
+        }
+    }
+
+    size_t common = commonElements(result->elements, expected);
+    result->dropped = (uint32_t) (strlen(expected) - common);
+    result->extra = (uint32_t) (result->elements.size() - common);
+}
+
+bool runConformance(bool quiet)
+{
+    simInit(1);
+    simSetDigital(PIN_KEY_INVERTED, LOW);
+    uint32_t startTicks = simMillisToTicks(SIM_CONFORMANCE_START_MILLIS);
+    while (simTicks() < startTicks) {
+        simStep();
+    }
+
+    uint32_t runs = 0;
+    uint32_t failedRuns = 0;
+    double worstDuration = 0;
+    double worstGap = 0;
+    uint32_t worstLatency = 0;
+    uint32_t worstHidLatency = 0;
+    for (int wpm = KEYER_SPEED_WPM_MINIMUM; wpm <= KEYER_SPEED_WPM_MAXIMUM; wpm++) {
+        keyerSetSpeedWpm(wpm);
+        double idealUnitTicks = 1.2 / wpm * simTickRate();
+        double unitError = (keyerParameters()->timing.ditDurationTicks / idealUnitTicks - 1.0) * 100.0;
+
+        for (uint8_t mode = 0; mode < 2; mode++) {
+            keyerSetSwitchModes(conformanceModes[mode], conformanceModes[mode]);
+            for (size_t i = 0; i < SIM_CONFORMANCE_PATTERN_COUNT; i++) {
+                const ConformancePattern &pattern = conformancePatterns[i];
+                ConformanceResult result;
+                runConformancePattern(pattern, idealUnitTicks, pattern.expected[mode], &result);
+
+                bool failed = result.dropped > 0 || result.extra > 0
+                        || fabs(result.durationErrorPercent) > SIM_CONFORMANCE_TOLERANCE_PERCENT
+                        || fabs(result.gapErrorPercent) > SIM_CONFORMANCE_TOLERANCE_PERCENT
+                        || result.latency > SIM_CONFORMANCE_LATENCY_TICKS
+                        || result.hidLatency > SIM_CONFORMANCE_LATENCY_TICKS;
+                if (!quiet || failed) {
+                    printf("conformance wpm %d mode %s pattern %s elements %s expected %s dropped %u extra %u"
+                            " duration_error %+.1f ticks %+.3f %% gap_error %+.1f ticks %+.3f %%"
+                            " latency %u hid_latency %u unit_error %+.3f %% %s\n", wpm, conformanceModeNames[mode],
+                            pattern.name, result.elements.empty() ? "none" : result.elements.c_str(),
+                            pattern.expected[mode], result.dropped, result.extra, result.durationError,
+                            result.durationErrorPercent, result.gapError, result.gapErrorPercent, result.latency,
+                            result.hidLatency, unitError, failed ? "fail" : "pass");
+                }
+
+                runs++;
+                failedRuns += failed ? 1 : 0;
+                worstDuration = fabs(result.durationErrorPercent) > fabs(worstDuration)
+                        ? result.durationErrorPercent : worstDuration;
+                worstGap = fabs(result.gapErrorPercent) > fabs(worstGap) ? result.gapErrorPercent : worstGap;
+                worstLatency = std::max(worstLatency, result.latency);
+                worstHidLatency = std::max(worstHidLatency, result.hidLatency);
+            }
+        }
+    }
+
+    printf("conformance runs %u failed %u duration_error_max %+.3f %% gap_error_max %+.3f %% latency_max %u"
+            " hid_latency_max %u\n", runs, failedRuns, worstDuration, worstGap, worstLatency, worstHidLatency);
+    if (failedRuns > 0) {
+        fprintf(stderr, "%u conformance runs dropped or added elements, or exceeded %.2f %% or %u ticks\n",
+                failedRuns, SIM_CONFORMANCE_TOLERANCE_PERCENT, SIM_CONFORMANCE_LATENCY_TICKS);
+        return false;
+    }
+    return true;
+}
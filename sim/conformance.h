@@ -0,0 +1,28 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Element timing conformance run of the simulator runner, option --conformance.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_CONFORMANCE_H
+#define WRC_MORSE_KEY_ADAPTER_CONFORMANCE_H
+
+// Keys every conformance pattern in iambic A and B at every speed, prints a line per run (only the failed runs
+// if quiet) and a summary line. Returns false if a run dropped or added elements, or exceeded the tolerances.
+bool runConformance(bool quiet);
+
+#endif
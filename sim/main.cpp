@@ -0,0 +1,1336 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Command-line runner for the tick-driven simulator. The trace dump and replay, the sidetone quality and
+ * the conformance runs are in sim/replay.cpp, sim/sidetone_quality.cpp and sim/conformance.cpp.
+ *
+ * Usage: wrc-sim [--loop-interval TICKS] [--max-latency TICKS] [--adc-noise STEPS] [--quiet]
+ *                [--key-stream] [--raw-hid] [--golden] [--debug-log] [--stress-parameters]
+ *                [--instrumentation] [--clock-error PPM] [--dump-trace FILE] [--wav FILE]
+ *                [SCRIPT | --replay FILE]
+ *        wrc-sim [--quiet] [--clock-error PPM] --stress-parameters
+ *        wrc-sim [--clock-error PPM] --sidetone-quality
+ *        wrc-sim [--clock-error PPM] [--quiet] --conformance
+ *        wrc-sim --benchmark
+ *
+ * The script is read from the given file or from standard input. Each line contains
+ * a time followed by a signal name and a value, for example:
+ *
+ *   # time  signal     value
+ *   0       automatic  on
+ *   0       iambic     on
+ *   0       inverted   off
+ *   0       speed      300
+ *   10ms    tip        on
+ *   100ms   tip        off
+ *   500ms   end
+ *
+ * Times are absolute, either in ticks or in milliseconds when suffixed with "ms", and must not decrease.
+ * Signals tip, ring and ptt are active low inputs (on = pin pulled low), automatic, iambic and inverted
+ * are switches (on = pin high), speed and pitch set the raw ADC value of the potentiometers, usb off stops
+ * the host from polling the HID endpoint until usb on (a busy or suspended host), mode selects the keyer mode
+ * of both iambic switch positions (iambic-a, iambic-b, ultimatic or bug), skip advances the firmware tick counter
+ * by the given time without simulating it (an idle period, for testing the tick counter wraparound), text writes
+ * the rest of the line to the serial port (the text keyer, requires a build with -D TEXT_KEYER_ENABLED=true; put the
+ * text in double quotes to keep leading or trailing spaces), serial writes the hex bytes of the rest of the line to
+ * the serial port (the commands, for example 18 for the CAN of the text keyer) and end stops the simulation. Times in
+ * the output are simulator ticks, which do not include the skipped periods.
+ *
+ * A line with the signal expect is a golden trace element instead of an input: the time is the tick the sidetone
+ * of the element starts at and the value is its duration in ticks. Expect lines are not ordered with the inputs.
+ * If a script has expect lines, the sidetone elements must match them exactly or the exit status is 1.
+ * The golden traces of the keyer modes are in sim/golden/. A line with the signal dropped gives the number of
+ * paddle taps the keyer is expected to drop because its paddle memory is full (the taps_dropped of the summary);
+ * the exit status is 1 if it does not match.
+ *
+ * The recorded HID output stream (key presses and releases as HID usages) and the sidetone edges are printed with the measured element durations,
+ * the paddle/PTT edge to HID report latencies and the distribution of sidetone and HID key edge jitter,
+ * which is the difference between the actual edge and the tick the keyer scheduled it at. The exit status is 1 if a latency exceeds --max-latency.
+ *
+ * If the script writes text, the spaces between the sidetone elements are counted in dit durations: element (1),
+ * character (3), word (7), pause (longer, the text ran out) and irregular. The exit status is 1 if there are irregular
+ * spaces and no paddle was pressed.
+ *
+ * A line with the signal decode gives the rest of the line as the text the CW decoder is expected to output (requires
+ * a build with -D CW_DECODER_ENABLED=true); decode lines are concatenated with a space between them. The text written
+ * to the serial port and the text typed with the keyboard output, read from the key presses in the US layout, are
+ * printed with the final dit duration average and the exit status is 1 if they do not match. The typed text is
+ * compared in lowercase with the characters on the keys used for keying replaced by CW_DECODER_KEYBOARD_MARKER.
+ *
+ * Option --adc-noise adds uniform noise of +-STEPS to the simulated potentiometer ADC conversions, to check
+ * the filtering of the ADC sampler. The speed and pitch changes made by the keyer are printed as the dit duration
+ * and the DDS tuning word.
+ *
+ * Option --key-stream decodes the binary key edge stream written to the serial port (requires a build with
+ * -D KEY_STREAM_OUTPUT=true) using the host-side decoder in host/key_stream_decoder.cpp and prints the edges
+ * with the latency from the input edge to the tick the frame carrying it was sent at. Script signal noise adds
+ * the hex bytes of the rest of the line to the serial output seen by the decoder (line noise or a truncated
+ * frame) and a line with the signal edges gives the number of edges the decoder is expected to recover, which
+ * implies --key-stream; the exit status is 1 if it does not match.
+ *
+ * Option --raw-hid switches the firmware to raw HID output mode with the serial port command (requires a build
+ * with -D RAW_HID_ENABLED=true), decodes the reports with host/raw_hid_decoder.cpp and prints the edges with the delay
+ * from the edge to the report carrying it. The key edges must switch the scheduled elements on and off at their
+ * ticks, and the element and latency measurements of the summary are taken from the raw edges as the host would see
+ * them in keyboard mode. The exit status is 1 if an edge had to wait for a later report than the next one or was
+ * dropped, that is, if one report per USB frame was not enough, or if the key edges do not match the elements.
+ *
+ * Option --debug-log decodes the debug log written to the serial port (requires a build with one of the DEBUG_
+ * defines of src/debug_log.h) with host/debug_log_decoder.cpp and prints the records with the delay from each
+ * record to the tick it was written to the serial port at.
+ *
+ * Option --golden prints the sidetone elements as expect lines, for writing a golden trace from a verified run.
+ *
+ * Option --stress-parameters sweeps the speed and pitch potentiometers continuously (overriding the script) and checks
+ * at every tick interrupt and at the preemption points of the parameter updates in the main loop that the keyer
+ * parameter block seen by the interrupt holds the timing of one speed and the tuning word of one pitch. Without
+ * a script it holds the dit paddle for 2 s instead of reading the script from the standard input. The exit status
+ * is 1 if a torn snapshot was seen or the sweep made less than 50 parameter updates per simulated second.
+ *
+ * Option --dump-trace FILE requests a dump of the trace recorder through the serial port after the script,
+ * like the host would (see src/trace_recorder.h), and writes the serial output of the dump to FILE.
+ *
+ * Option --replay FILE replays a trace dump instead of a script: FILE holds the bytes read from the serial
+ * port of the adapter after sending the dump command, or written with --dump-trace. The dump is decoded with
+ * host/trace_decoder.cpp and printed, and the start state, pin edges, switches, speed, keyer mode and serial
+ * input are applied to the simulated adapter at the recorded ticks, with idle periods over 10 s skipped.
+ * The debounced changes, scheduled elements and output edges recorded by the simulated firmware are compared
+ * with the ones in the dump, from the start if the trace starts at the firmware start and otherwise from the first
+ * debounced key or PTT press after 250 ms without output, as the keyer state before it is not in the trace.
+ * The exit status is 1 if the sequences differ. The largest tick difference of the matching
+ * events is printed, it is 0 for a dump of the simulator and the main loop timing of a real adapter otherwise.
+ *
+ * Option --instrumentation sends the instrumentation readout command through the serial port after the script
+ * (requires a build with -D INSTRUMENTATION_ENABLED=true, see src/instrumentation.h) and prints the readout. The cycle
+ * counts are host nanoseconds, the latency histograms and counters are those of the simulated adapter.
+ *
+ * Option --clock-error PPM makes the tick of the simulated adapter run fast by the given error (slow if negative),
+ * like a board with an inaccurate resonator: the script times in milliseconds and the USB frames of the host are real
+ * time. After the script, the dit duration and the pitch in use and the last element keyed by the keyer are compared in real
+ * time with the ones of the speed and pitch potentiometers, with the estimate of the timebase calibration
+ * (requires a build with -D TIMEBASE_CALIBRATION_ENABLED=true, see src/timebase_calibration.h). The exit status
+ * is 1 if they differ by more than 0.2 %. Without the calibration the timing has the error of the clock and the
+ * 0.4 % difference between REFCLK and the tick rate of millisToPwmTicks().
+ *
+ * Option --wav FILE writes the sidetone of the run to FILE as a 96 kHz WAV file, rendered with host/sidetone_analyzer.cpp
+ * from the PWM values of the tick interrupt through a model of the output filter of the board.
+ *
+ * Option --sidetone-quality runs no script: it switches the sidetone on, sets the pitches from 300 to 1200 Hz in 100 Hz
+ * steps and prints the measured frequency and its error, the level relative to a full scale sine, the THD, the THD+N
+ * and the largest non-harmonic spur in the audio band of the rendered output at each pitch, and the worst of them.
+ * It then keys the sidetone on and off with the envelope ramps and prints the ADC conversions sampled within 1 us of
+ * an edge of the PWM output and the lowest PWM compare value of them. The exit status is 1 if one was sampled at less
+ * than half the sidetone amplitude.
+ *
+ * Option --conformance runs no script: it keys paddle patterns (single dits and dahs, held paddles, paddle memory and
+ * squeezes released in the middle of an element) in iambic A and B at every speed from 5 to 50 WPM and prints a line
+ * per run with the elements against the expected ones, the dropped and extra elements, the largest element duration
+ * and space errors against the PARIS timing in real time, and the paddle to sidetone and HID report latencies,
+ * then a summary line. With --quiet only the failed runs and the summary are printed. The exit status is 1 if a run
+ * dropped or added an element, or exceeded the tolerances of the timing or the latency.
+ *
+ * Option --benchmark runs the hot path benchmarks in src/benchmark.cpp and prints the results.
+ *
+ * A build with -D IDLE_MODE_ENABLED=true (see src/idle_mode.h) also prints the idle mode entries and exits, the share
+ * of the ticks the CPU slept through and of the ticks with a tick interrupt, and the longest time from leaving the
+ * idle mode to the first sidetone element.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <algorithm>
+
+#include "simulator.h"
+#include "benchmark.h"
+#include "pins.h"
+#include "keyboard_definitions.h"
+#include "keyer_queue.h"
+#include "dds_sine_generator.h"
+#include "keyer_parameters.h"
+#include "key_stream.h"
+#include "key_stream_decoder.h"
+#include "raw_hid.h"
+#include "hid_report_queue.h"
+#include "keyer_modes.h"
+#include "raw_hid_decoder.h"
+#include "cw_decoder.h"
+#include "text_keyer.h"
+#include "trace_recorder.h"
+#include "instrumentation.h"
+#include "debug_log.h"
+#include "timebase_calibration.h"
+#include "trace_decoder.h"
+#include "debug_log_decoder.h"
+#include "sidetone_analyzer.h"
+#include "idle_mode.h"
+#include "runner.h"
+#include "conformance.h"
+#include "replay.h"
+#include "sidetone_quality.h"
+
+// Largest error of the element timing and the pitch in real time accepted with --clock-error, a tick of a dit
+// at 50 WPM is 0.13 %
+#define SIM_TIMEBASE_TOLERANCE_PERCENT 0.2
+
+// Duration of the --stress-parameters run without a script and the minimum rate of parameter updates of the sweep,
+// which makes about 120 updates per second
+#define SIM_STRESS_MILLIS 2000
+#define SIM_STRESS_MINIMUM_UPDATES_PER_SECOND 50
+
+static bool parseTime(const char *text, uint32_t *ticks)
+{
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) {
+        return false;
+    }
+    if (strcmp(end, "ms") == 0) {
+        *ticks = simMillisToTicks(value);
+        return true;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    *ticks = (uint32_t) value;
+    return true;
+}
+
+struct SimExpectedElement {
+    uint32_t startTick;
+    uint32_t durationTicks;
+};
+
+static bool parseScript(FILE *file, std::vector<SimScriptEvent> &events, std::vector<SimExpectedElement> &expected,
+        std::string &expectedDecoded, int32_t &expectedStreamEdges, int32_t &expectedTapsDropped)
+{
+    char line[256];
+    int lineNumber = 0;
+    uint32_t previousTick = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char time[32];
+        SimScriptEvent event;
+        memset(&event, 0, sizeof(event));
+        int count = sscanf(line, "%31s %15s %15s", time, event.signal, event.value);
+        if (count <= 0) {
+            continue;
+        }
+        if (count < 2 || !parseTime(time, &event.tick)) {
+            fprintf(stderr, "Invalid script line %d\n", lineNumber);
+            return false;
+        }
+        if (strcmp(event.signal, "text") == 0 || strcmp(event.signal, "decode") == 0
+                || strcmp(event.signal, "noise") == 0 || strcmp(event.signal, "serial") == 0) {
+            // The value is the rest of the line, or the text between double quotes to include the leading
+            // or trailing spaces
+            char *text = strstr(line, event.signal) + strlen(event.signal);
+            text += strspn(text, " \t");
+            size_t length;
+            if (*text == '"') {
+                text++;
+                length = strcspn(text, "\"\r\n");
+            } else {
+                length = strcspn(text, "\r\n");
+                while (length > 0 && (text[length - 1] == ' ' || text[length - 1] == '\t')) {
+                    length--;
+                }
+            }
+            if (length >= sizeof(event.value)) {
+                fprintf(stderr, "Text too long on script line %d\n", lineNumber);
+                return false;
+            }
+            memcpy(event.value, text, length);
+            event.value[length] = '\0';
+        }
+        if (strcmp(event.signal, "decode") == 0) {
+            if (!expectedDecoded.empty()) {
+                expectedDecoded += ' ';
+            }
+            expectedDecoded += event.value;
+            continue;
+        }
+        if (strcmp(event.signal, "expect") == 0) {
+            SimExpectedElement element;
+            element.startTick = event.tick;
+            element.durationTicks = (uint32_t) atol(event.value);
+            expected.push_back(element);
+            continue;
+        }
+        if (strcmp(event.signal, "edges") == 0) {
+            expectedStreamEdges = atol(event.value);
+            continue;
+        }
+        if (strcmp(event.signal, "dropped") == 0) {
+            expectedTapsDropped = atol(event.value);
+            continue;
+        }
+        if (event.tick < previousTick) {
+            fprintf(stderr, "Invalid script line %d\n", lineNumber);
+            return false;
+        }
+        previousTick = event.tick;
+        events.push_back(event);
+    }
+
+    return true;
+}
+
+static void addScriptEvent(std::vector<SimScriptEvent> &events, uint32_t tick, const char *signal, const char *value)
+{
+    SimScriptEvent event;
+    memset(&event, 0, sizeof(event));
+    event.tick = tick;
+    strncpy(event.signal, signal, sizeof(event.signal) - 1);
+    strncpy(event.value, value, sizeof(event.value) - 1);
+    events.push_back(event);
+}
+
+// The script of --stress-parameters without a script: the dit paddle is held so that the keyer uses the parameters
+// while the potentiometers are swept
+static void buildStressScript(std::vector<SimScriptEvent> &events)
+{
+    addScriptEvent(events, 0, "automatic", "on");
+    addScriptEvent(events, 0, "iambic", "on");
+    addScriptEvent(events, 0, "inverted", "off");
+    addScriptEvent(events, simMillisToTicks(10), "tip", "on");
+    addScriptEvent(events, simMillisToTicks(SIM_STRESS_MILLIS), "tip", "off");
+    addScriptEvent(events, simMillisToTicks(SIM_STRESS_MILLIS + 100), "end", "");
+}
+
+const char *keyerModeNames[KEYER_MODE_COUNT] = {"iambic-a", "iambic-b", "ultimatic", "bug"};
+
+static int keyerModeForName(const char *name)
+{
+    for (int i = 0; i < KEYER_MODE_COUNT; i++) {
+        if (strcmp(name, keyerModeNames[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool applyEvent(const SimScriptEvent &event, std::vector<uint32_t> &inputEdges)
+{
+    bool on = strcmp(event.value, "on") == 0;
+
+    if (strcmp(event.signal, "tip") == 0) {
+        simSetDigital(PIN_KEY_TIP, on ? PIN_STATE_KEY_ON : !PIN_STATE_KEY_ON);
+    } else if (strcmp(event.signal, "ring") == 0) {
+        simSetDigital(PIN_KEY_RING, on ? PIN_STATE_KEY_ON : !PIN_STATE_KEY_ON);
+    } else if (strcmp(event.signal, "ptt") == 0) {
+        simSetDigital(PIN_PTT, on ? PIN_STATE_PTT_ON : !PIN_STATE_PTT_ON);
+    } else if (strcmp(event.signal, "automatic") == 0) {
+        simSetDigital(PIN_KEY_AUTOMATIC_MODE, on ? HIGH : LOW);
+        return true;
+    } else if (strcmp(event.signal, "iambic") == 0) {
+        simSetDigital(PIN_KEY_IAMBIC, on ? HIGH : LOW);
+        return true;
+    } else if (strcmp(event.signal, "inverted") == 0) {
+        simSetDigital(PIN_KEY_INVERTED, on ? HIGH : LOW);
+        return true;
+    } else if (strcmp(event.signal, "speed") == 0) {
+        simSetAnalog(PIN_ANALOG_KEYER_SPEED, (uint16_t) atoi(event.value));
+        return true;
+    } else if (strcmp(event.signal, "pitch") == 0) {
+        simSetAnalog(PIN_ANALOG_KEYER_PITCH, (uint16_t) atoi(event.value));
+        return true;
+    } else if (strcmp(event.signal, "usb") == 0) {
+        simSetUsbPolling(on);
+        return true;
+    } else if (strcmp(event.signal, "mode") == 0) {
+        int mode = keyerModeForName(event.value);
+        if (mode < 0) {
+            fprintf(stderr, "Unknown keyer mode: %s\n", event.value);
+            return false;
+        }
+        keyerSetSwitchModes((uint8_t) mode, (uint8_t) mode);
+        return true;
+    } else if (strcmp(event.signal, "skip") == 0) {
+        uint32_t ticks;
+        if (!parseTime(event.value, &ticks)) {
+            fprintf(stderr, "Invalid skip time: %s\n", event.value);
+            return false;
+        }
+        simSkipTicks(ticks);
+        return true;
+    } else if (strcmp(event.signal, "text") == 0) {
+        simSerialInput(event.value, strlen(event.value));
+        return true;
+    } else if (strcmp(event.signal, "serial") == 0 || strcmp(event.signal, "noise") == 0) {
+        uint8_t data[sizeof(event.value) / 2];
+        size_t length = 0;
+        const char *text = event.value;
+        char *end;
+        for (unsigned long value = strtoul(text, &end, 16); end != text; value = strtoul(text, &end, 16)) {
+            if (value > 0xFF || length == sizeof(data)) {
+                fprintf(stderr, "Invalid %s bytes: %s\n", event.signal, event.value);
+                return false;
+            }
+            data[length++] = (uint8_t) value;
+            text = end;
+        }
+        if (strcmp(event.signal, "serial") == 0) {
+            simSerialInput((const char *) data, length);
+        } else {
+            simSerialNoise(data, length);
+        }
+        return true;
+    } else if (strcmp(event.signal, "end") == 0) {
+        return true;
+    } else {
+        fprintf(stderr, "Unknown signal: %s\n", event.signal);
+        return false;
+    }
+
+    // Key and PTT press edges are the reference points for latency measurement
+    if (on) {
+        inputEdges.push_back(simTicks());
+    }
+    return true;
+}
+
+// Collects the edge time differences of the given on/off edges against the scheduled elements
+static uint32_t measureJitter(const std::vector<SimElement> &elements, const std::vector<uint32_t> &onTicks,
+        const std::vector<uint32_t> &offTicks, std::map<int32_t, uint32_t> &histogram)
+{
+    uint32_t maxJitter = 0;
+
+    for (size_t i = 0; i < elements.size(); i++) {
+        int32_t deltas[2] = {INT32_MAX, INT32_MAX};
+        if (i < onTicks.size()) {
+            deltas[0] = (int32_t) (onTicks[i] - elements[i].startTicks);
+        }
+        if (i < offTicks.size()) {
+            deltas[1] = (int32_t) (offTicks[i] - elements[i].endTicks);
+        }
+        for (int j = 0; j < 2; j++) {
+            if (deltas[j] == INT32_MAX) {
+                continue;
+            }
+            histogram[deltas[j]]++;
+            uint32_t jitter = (uint32_t) (deltas[j] < 0 ? -deltas[j] : deltas[j]);
+            if (jitter > maxJitter) {
+                maxJitter = jitter;
+            }
+        }
+    }
+
+    return maxJitter;
+}
+
+// Decodes the key edge stream from the serial output, the frames are sent in order at simulated ticks.
+// Returns false if the number of decoded edges does not match the expected number, if given (not negative).
+static bool printKeyStream(bool quiet, int32_t expectedEdges)
+{
+    const std::string &output = simSerialOutput();
+    const std::vector<uint32_t> &writeTicks = simSerialWriteTicks();
+    const std::vector<size_t> &writeOffsets = simSerialWriteOffsets();
+
+    KeyStreamDecoder decoder;
+    keyStreamDecoderInit(&decoder);
+    KeyStreamEdge edges[KEY_STREAM_FRAME_MAX_RECORDS];
+
+    uint32_t edgeCount = 0;
+    uint32_t maxDelay = 0;
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < output.size(); i++) {
+        while (writeIndex + 1 < writeOffsets.size() && writeOffsets[writeIndex + 1] <= i) {
+            writeIndex++;
+        }
+        size_t count = keyStreamDecoderFeed(&decoder, (uint8_t) output[i], edges);
+        for (size_t j = 0; j < count; j++) {
+            uint32_t sentTick = writeIndex < writeTicks.size() ? writeTicks[writeIndex] : simTicks();
+            uint32_t delay = sentTick - (uint32_t) edges[j].ticks;
+            if (delay > maxDelay) {
+                maxDelay = delay;
+            }
+            if (!quiet) {
+                printf("stream %llu %u %s %u\n", (unsigned long long) edges[j].ticks, edges[j].input,
+                        edges[j].on ? "on" : "off", delay);
+            }
+            edgeCount++;
+        }
+    }
+
+    printf("key_stream frames %u edges %u invalid_frames %u skipped_bytes %u dropped_records %u delay_max %u\n",
+            decoder.frameCount, edgeCount, decoder.invalidFrameCount, decoder.skippedByteCount,
+            keyStreamDroppedRecords(), maxDelay);
+
+    if (expectedEdges >= 0 && edgeCount != (uint32_t) expectedEdges) {
+        fprintf(stderr, "Decoded %u key stream edges instead of %d\n", edgeCount, expectedEdges);
+        return false;
+    }
+    return true;
+}
+
+// Decodes the debug log from the serial output and prints the records with the delay to the tick they were written at
+static void printDebugLog(bool quiet)
+{
+    const std::string &output = simSerialOutput();
+    const std::vector<uint32_t> &writeTicks = simSerialWriteTicks();
+    const std::vector<size_t> &writeOffsets = simSerialWriteOffsets();
+
+    DebugLogDecoder decoder;
+    debugLogDecoderInit(&decoder);
+
+    uint32_t maxDelay = 0;
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < output.size(); i++) {
+        while (writeIndex + 1 < writeOffsets.size() && writeOffsets[writeIndex + 1] <= i) {
+            writeIndex++;
+        }
+        DebugLogEntry entry;
+        if (!debugLogDecoderFeed(&decoder, (uint8_t) output[i], &entry)) {
+            continue;
+        }
+        uint32_t sentTick = writeIndex < writeTicks.size() ? writeTicks[writeIndex] : simTicks();
+        uint32_t delay = sentTick - (uint32_t) entry.ticks;
+        if (delay > maxDelay) {
+            maxDelay = delay;
+        }
+        if (!quiet) {
+            char text[96];
+            debugLogFormat(&entry, text, sizeof(text));
+            printf("debug %llu %s (%u)\n", (unsigned long long) entry.ticks, text, delay);
+        }
+    }
+
+    printf("debug_log records %u dropped_records %u invalid_frames %u skipped_bytes %u delay_max %u\n",
+            decoder.frameCount, debugLogDroppedRecords(), decoder.invalidFrameCount, decoder.skippedByteCount,
+            maxDelay);
+}
+
+// HID usage of the key press that an edge of a raw HID output would be sent as in keyboard mode
+static uint8_t rawHidOutputUsage(uint8_t output, bool on)
+{
+    switch (output) {
+        case RAW_HID_OUTPUT_PASS_THROUGH_DIT:
+            return hidUsageForKey(KEYBOARD_KEY_PASS_THROUGH_DIT);
+        case RAW_HID_OUTPUT_PASS_THROUGH_DAH:
+            return hidUsageForKey(KEYBOARD_KEY_PASS_THROUGH_DAH);
+        case RAW_HID_OUTPUT_PTT:
+            return hidUsageForKey(on ? KEYBOARD_KEY_PTT_ON : KEYBOARD_KEY_PTT_OFF);
+        default:
+            return hidUsageForKey(KEYBOARD_KEY_STRAIGHT);
+    }
+}
+
+// Decodes the raw HID reports, checks that the edges of each report lead to the reported state and that
+// the key edges carry the ticks of the keyed elements. The edges are added to events as the key presses and
+// releases the host sees at the tick of their report, for the element and latency measurements of keyboard mode.
+static bool printRawHid(bool quiet, std::vector<SimHidEvent> &events)
+{
+    const std::vector<SimRawHidReport> &reports = simRawHidReports();
+    const std::vector<SimElement> &elements = simScheduledElements();
+
+    RawHidDecoder decoder;
+    rawHidDecoderInit(&decoder);
+    RawHidEdge edges[RAW_HID_REPORT_MAX_EDGES];
+
+    uint8_t state = 0;
+    uint32_t edgeCount = 0;
+    uint32_t maxEdgesPerReport = 0;
+    uint32_t maxDelay = 0;
+    uint32_t stateMismatches = 0;
+    uint32_t keyEdgeCount = 0;
+    uint32_t keyOnTicks = 0;
+    size_t keyedElements = 0;
+    for (size_t i = 0; i < reports.size(); i++) {
+        size_t count = rawHidDecoderDecode(&decoder, &reports[i].data[0], reports[i].data.size(), edges);
+        if (count > maxEdgesPerReport) {
+            maxEdgesPerReport = count;
+        }
+        for (size_t j = 0; j < count; j++) {
+            uint32_t delay = reports[i].tick - (uint32_t) edges[j].ticks;
+            if (delay > maxDelay) {
+                maxDelay = delay;
+            }
+            if (edges[j].on) {
+                state |= 1 << edges[j].output;
+            } else {
+                state &= ~(1 << edges[j].output);
+            }
+            if (!quiet) {
+                printf("raw_hid %u %llu %u %s %u\n", reports[i].tick, (unsigned long long) edges[j].ticks,
+                        edges[j].output, edges[j].on ? "on" : "off", delay);
+            }
+            edgeCount++;
+
+            SimHidEvent event = {reports[i].simTick, rawHidOutputUsage(edges[j].output, edges[j].on), edges[j].on};
+            if (edges[j].output == RAW_HID_OUTPUT_PTT) {
+                // The PTT keys of keyboard mode are pressed and released in the same report
+                event.pressed = true;
+                events.push_back(event);
+                event.pressed = false;
+            }
+            events.push_back(event);
+
+            // Each scheduled element is keyed by a key on and off edge at its ticks, the straight key and the manual
+            // dahs of the bug are key edges between the elements
+            if (edges[j].output == RAW_HID_OUTPUT_KEY) {
+                uint32_t ticks = (uint32_t) edges[j].ticks - (reports[i].tick - reports[i].simTick);
+                if (edges[j].on) {
+                    keyOnTicks = ticks;
+                } else if (keyedElements < elements.size() && keyOnTicks == elements[keyedElements].startTicks
+                        && ticks == elements[keyedElements].endTicks) {
+                    keyedElements++;
+                }
+                keyEdgeCount++;
+            }
+        }
+        if (state != decoder.state) {
+            stateMismatches++;
+        }
+    }
+
+    printf("raw_hid reports %u edges %u edges_per_report_max %u delay_max %u deferred %u dropped %u rejected %u"
+            " lost %u state_mismatches %u key_edges %u elements %zu keyed_elements %zu\n", decoder.reportCount,
+            edgeCount, maxEdgesPerReport, maxDelay, rawHidDeferredEdges(), rawHidDroppedEdges(),
+            simHidRejectedReports(), decoder.lostReportCount, stateMismatches, keyEdgeCount, elements.size(),
+            keyedElements);
+
+    if (keyedElements != elements.size()) {
+        fprintf(stderr, "The raw HID key edges key %zu of the %zu scheduled elements\n", keyedElements,
+                elements.size());
+        return false;
+    }
+    return rawHidDeferredEdges() == 0 && rawHidDroppedEdges() == 0 && simHidRejectedReports() == 0
+            && decoder.lostReportCount == 0 && stateMismatches == 0;
+}
+
+// Compares the sidetone elements against the golden trace, prints the first mismatch
+static bool checkGoldenTrace(const std::vector<SimSidetoneEvent> &sidetoneEvents,
+        const std::vector<SimExpectedElement> &expected, bool printGolden)
+{
+    std::vector<SimExpectedElement> actual;
+    for (size_t i = 0; i + 1 < sidetoneEvents.size(); i++) {
+        if (sidetoneEvents[i].on && !sidetoneEvents[i + 1].on) {
+            SimExpectedElement element;
+            element.startTick = sidetoneEvents[i].tick;
+            element.durationTicks = sidetoneEvents[i + 1].tick - sidetoneEvents[i].tick;
+            actual.push_back(element);
+        }
+    }
+
+    if (printGolden) {
+        for (size_t i = 0; i < actual.size(); i++) {
+            printf("%-8u expect %u\n", actual[i].startTick, actual[i].durationTicks);
+        }
+    }
+
+    if (expected.empty()) {
+        return true;
+    }
+
+    for (size_t i = 0; i < actual.size() || i < expected.size(); i++) {
+        if (i < actual.size() && i < expected.size() && actual[i].startTick == expected[i].startTick
+                && actual[i].durationTicks == expected[i].durationTicks) {
+            continue;
+        }
+        fprintf(stderr, "Golden trace mismatch at element %zu: expected", i);
+        if (i < expected.size()) {
+            fprintf(stderr, " %u %u", expected[i].startTick, expected[i].durationTicks);
+        } else {
+            fprintf(stderr, " none");
+        }
+        if (i < actual.size()) {
+            fprintf(stderr, ", got %u %u\n", actual[i].startTick, actual[i].durationTicks);
+        } else {
+            fprintf(stderr, ", got none\n");
+        }
+        return false;
+    }
+
+    printf("golden elements %zu match\n", expected.size());
+    return true;
+}
+
+// Removes the debug log frames that the firmware wrote between the decoded characters
+static std::string removeDebugLogFrames(const std::string &data)
+{
+    DebugLogDecoder decoder;
+    debugLogDecoderInit(&decoder);
+
+    std::string text;
+    for (size_t i = 0; i < data.size(); i++) {
+        text.push_back(data[i]);
+        DebugLogEntry entry;
+        if (debugLogDecoderFeed(&decoder, (uint8_t) data[i], &entry)) {
+            text.resize(text.size() - DEBUG_LOG_FRAME_SIZE);
+        }
+    }
+    return text;
+}
+
+static bool isKeyingKey(uint8_t key)
+{
+    return key == KEYBOARD_KEY_STRAIGHT || key == KEYBOARD_KEY_PASS_THROUGH_DIT || key == KEYBOARD_KEY_PASS_THROUGH_DAH;
+}
+
+// The text the keyboard output of the decoder should type for a decoded text: the letters in lowercase and the
+// characters without a key or on the keys used for keying as CW_DECODER_KEYBOARD_MARKER
+static std::string keyboardText(const std::string &text)
+{
+    std::string typed;
+    for (size_t i = 0; i < text.size(); i++) {
+        uint8_t character = text[i] >= 'A' && text[i] <= 'Z' ? text[i] + ('a' - 'A') : text[i];
+        uint8_t key = hidUnshiftedKey(character);
+        typed.push_back(hidUsageForKey(key) == 0 || isKeyingKey(key) ? CW_DECODER_KEYBOARD_MARKER : character);
+    }
+    return typed;
+}
+
+// The text typed by the key presses of the host keyboard events in the US layout, without the keys used for keying
+// and the PTT keys pressed with their modifier
+static std::string typedKeyboardText()
+{
+    const std::vector<SimHidEvent> &events = simHidEvents();
+    std::string typed;
+    bool shift = false;
+    bool pttModifier = false;
+    for (size_t i = 0; i < events.size(); i++) {
+        const SimHidEvent &event = events[i];
+        if (event.key == hidUsageForKey(KEY_LEFT_SHIFT)) {
+            shift = event.pressed;
+        } else if (event.key == hidUsageForKey(KEYBOARD_KEY_MODIFIER_PTT)) {
+            pttModifier = event.pressed;
+        } else if (event.pressed && !pttModifier) {
+            for (uint8_t character = ' '; character <= '~'; character++) {
+                uint8_t key = hidUnshiftedKey(character);
+                if (hidUsageForKey(key) == event.key && (key != character) == shift
+                        && !(character >= 'A' && character <= 'Z') && !(isKeyingKey(key) && !shift)) {
+                    typed.push_back(character);
+                    break;
+                }
+            }
+        }
+    }
+    return typed;
+}
+
+static void removeTrailingSpaces(std::string &text)
+{
+    while (!text.empty() && text[text.size() - 1] == ' ') {
+        text.erase(text.size() - 1);
+    }
+}
+
+// Compares the characters the decoder wrote to the serial port, before the length written by the end of the
+// script, and the characters it typed with the keyboard with the decode lines of the script
+static bool checkDecodedText(const std::string &expected, size_t length)
+{
+    bool matched = true;
+
+    if (CW_DECODER_OUTPUT & CW_DECODER_OUTPUT_SERIAL) {
+        std::string decoded = simSerialWrites().substr(0, length);
+        if (DEBUG_LOG_ENABLED == true) {
+            decoded = removeDebugLogFrames(decoded);
+        }
+        removeTrailingSpaces(decoded);
+
+        printf("decoder text \"%s\" dit %u\n", decoded.c_str(), cwDecoderDitTicks());
+
+        if (!expected.empty() && decoded != expected) {
+            fprintf(stderr, "Decoded text mismatch: expected \"%s\"\n", expected.c_str());
+            matched = false;
+        }
+    }
+
+    // The decoded characters are not typed in raw HID mode
+    if ((CW_DECODER_OUTPUT & CW_DECODER_OUTPUT_KEYBOARD) && !rawHidIsEnabled()) {
+        std::string typed = typedKeyboardText();
+        removeTrailingSpaces(typed);
+        std::string expectedTyped = keyboardText(expected);
+
+        printf("decoder typed \"%s\" dit %u\n", typed.c_str(), cwDecoderDitTicks());
+
+        if (!expected.empty() && typed != expectedTyped) {
+            fprintf(stderr, "Typed text mismatch: expected \"%s\"\n", expectedTyped.c_str());
+            matched = false;
+        }
+    }
+
+    return matched;
+}
+
+// Compares the element timing and the pitch in real time with the ones set by the potentiometers: the dit duration
+// and the tuning word in use, and the last element scheduled by the keyer unless the speed sweeps
+static bool checkTimebase(double clockError, bool stressParameters)
+{
+    double unitMillis = 1200.0 / keyerSpeedWpm;
+    double ditMillis = keyerParameters()->timing.ditDurationTicks * 1000.0 / simTickRate();
+    double ditError = (ditMillis / unitMillis - 1.0) * 100.0;
+
+    double pitch = keyerTuningWord * REFCLK / 4294967296.0;
+    double actualPitch = keyerParameters()->tuningWord * simTickRate() / 4294967296.0;
+    double pitchError = (actualPitch / pitch - 1.0) * 100.0;
+
+    double elementMillis = 0;
+    double elementError = 0;
+    const std::vector<SimElement> &elements = simScheduledElements();
+    if (!elements.empty() && !stressParameters) {
+        const SimElement &element = elements.back();
+        elementMillis = (element.endTicks - element.startTicks) * 1000.0 / simTickRate();
+        double units = element.action == KEYER_ACTION_DAH ? 3 : 1;
+        elementError = (elementMillis / (units * unitMillis) - 1.0) * 100.0;
+    }
+
+    printf("timebase clock_error %.0f ppm estimate %d ppm windows %u eeprom_writes %u eeprom_blocked %u dit %.3f ms"
+            " error %+.3f %% element %.3f ms error %+.3f %% pitch %.2f Hz error %+.3f %%\n", clockError,
+            timebaseCalibrationPpm(), timebaseCalibrationWindows(), simEepromWrites(), simEepromBlockedTicks(),
+            ditMillis, ditError, elementMillis, elementError, actualPitch, pitchError);
+
+    if (simEepromBlockedTicks() > 0) {
+        fprintf(stderr, "The main loop waited %u ticks for EEPROM writes\n", simEepromBlockedTicks());
+        return false;
+    }
+
+    if (fabs(ditError) > SIM_TIMEBASE_TOLERANCE_PERCENT || fabs(elementError) > SIM_TIMEBASE_TOLERANCE_PERCENT
+            || fabs(pitchError) > SIM_TIMEBASE_TOLERANCE_PERCENT) {
+        fprintf(stderr, "Element timing or pitch off by more than %.2f %% in real time\n",
+                SIM_TIMEBASE_TOLERANCE_PERCENT);
+        return false;
+    }
+    return true;
+}
+
+#if IDLE_MODE_ENABLED == true
+// Prints the idle mode entries and exits, the ticks the CPU slept and ran the tick interrupt, and the longest time
+// from leaving the idle mode to the first sidetone element keyed before the next exit
+static void printIdleMode(const std::vector<uint32_t> &sidetoneOnTicks)
+{
+    const std::vector<uint32_t> &exits = simIdleExitTicks();
+    uint32_t wakeLatencyMax = 0;
+    size_t onIndex = 0;
+    for (size_t i = 0; i < exits.size(); i++) {
+        while (onIndex < sidetoneOnTicks.size() && sidetoneOnTicks[onIndex] < exits[i]) {
+            onIndex++;
+        }
+        if (onIndex == sidetoneOnTicks.size()) {
+            break;
+        }
+        if (i + 1 < exits.size() && sidetoneOnTicks[onIndex] >= exits[i + 1]) {
+            continue;
+        }
+        wakeLatencyMax = std::max(wakeLatencyMax, sidetoneOnTicks[onIndex] - exits[i]);
+    }
+
+    uint32_t ticks = simTicks() > 0 ? simTicks() : 1;
+    printf("idle entries %u exits %zu sleep %.1f %% tick_interrupts %.1f %% wake_to_element_max %u\n",
+            simIdleEntries(), exits.size(), simSleepTicks() * 100.0 / ticks, simTickInterrupts() * 100.0 / ticks,
+            wakeLatencyMax);
+}
+#endif
+
+// Requests the instrumentation readout through the serial port and prints it
+static void printInstrumentation()
+{
+    size_t offset = simSerialWrites().size();
+    char command = INSTRUMENTATION_SERIAL_COMMAND_READ;
+    simSerialInput(&command, 1);
+
+    uint32_t deadline = simTicks() + simMillisToTicks(1000);
+    do {
+        simStep();
+    } while ((simSerialWrites().size() == offset || instrumentationReadingOut()) && simTicks() < deadline);
+
+    fputs(simSerialWrites().substr(offset).c_str(), stdout);
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return true;
+}
+
+static void printUsage()
+{
+    fprintf(stderr, "Usage: wrc-sim [--loop-interval TICKS] [--max-latency TICKS] [--adc-noise STEPS] [--quiet]\n"
+            "               [--key-stream] [--raw-hid] [--golden] [--debug-log] [--stress-parameters]\n"
+            "               [--instrumentation] [--clock-error PPM] [--dump-trace FILE] [--wav FILE]\n"
+            "               [SCRIPT | --replay FILE]\n"
+            "       wrc-sim [--quiet] [--clock-error PPM] --stress-parameters\n"
+            "       wrc-sim [--clock-error PPM] --sidetone-quality\n"
+            "       wrc-sim [--clock-error PPM] [--quiet] --conformance\n"
+            "       wrc-sim --benchmark\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t loopIntervalTicks = 1;
+    long maxLatencyTicks = -1;
+    bool quiet = false;
+    uint16_t adcNoise = 0;
+    bool decodeKeyStream = false;
+    bool rawHid = false;
+    bool printGolden = false;
+    bool stressParameters = false;
+    bool instrumentation = false;
+    bool debugLog = false;
+    bool clockErrorSet = false;
+    double clockError = 0;
+    const char *scriptPath = NULL;
+    const char *dumpTracePath = NULL;
+    const char *replayPath = NULL;
+    const char *wavPath = NULL;
+    bool sidetoneQuality = false;
+    bool conformance = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loop-interval") == 0 && i + 1 < argc) {
+            loopIntervalTicks = (uint32_t) atol(argv[++i]);
+        } else if (strcmp(argv[i], "--max-latency") == 0 && i + 1 < argc) {
+            maxLatencyTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--adc-noise") == 0 && i + 1 < argc) {
+            adcNoise = (uint16_t) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--key-stream") == 0) {
+            decodeKeyStream = true;
+        } else if (strcmp(argv[i], "--raw-hid") == 0) {
+            rawHid = true;
+        } else if (strcmp(argv[i], "--golden") == 0) {
+            printGolden = true;
+        } else if (strcmp(argv[i], "--stress-parameters") == 0) {
+            stressParameters = true;
+        } else if (strcmp(argv[i], "--clock-error") == 0 && i + 1 < argc) {
+            clockErrorSet = true;
+            clockError = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--debug-log") == 0) {
+            debugLog = true;
+        } else if (strcmp(argv[i], "--instrumentation") == 0) {
+            instrumentation = true;
+        } else if (strcmp(argv[i], "--dump-trace") == 0 && i + 1 < argc) {
+            dumpTracePath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+            wavPath = argv[++i];
+        } else if (strcmp(argv[i], "--sidetone-quality") == 0) {
+            sidetoneQuality = true;
+        } else if (strcmp(argv[i], "--conformance") == 0) {
+            conformance = true;
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            benchmarkRun();
+            fputs(simSerialOutput().c_str(), stdout);
+            return 0;
+        } else if (argv[i][0] != '-' && scriptPath == NULL) {
+            scriptPath = argv[i];
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (rawHid && RAW_HID_ENABLED != true) {
+        fprintf(stderr, "Option --raw-hid requires a build with -D RAW_HID_ENABLED=true\n");
+        return 2;
+    }
+
+    if (debugLog && DEBUG_LOG_ENABLED != true) {
+        fprintf(stderr, "Option --debug-log requires a build with a DEBUG_ define, see src/debug_log.h\n");
+        return 2;
+    }
+
+    if (instrumentation && INSTRUMENTATION_ENABLED != true) {
+        fprintf(stderr, "Option --instrumentation requires a build with -D INSTRUMENTATION_ENABLED=true\n");
+        return 2;
+    }
+
+    if ((dumpTracePath != NULL || replayPath != NULL) && TRACE_RECORDER_ENABLED != true) {
+        fprintf(stderr, "Options --dump-trace and --replay require a build with the trace recorder\n");
+        return 2;
+    }
+    if (replayPath != NULL && scriptPath != NULL) {
+        printUsage();
+        return 2;
+    }
+
+    // The script times in milliseconds are real time
+    simSetClockError(clockError);
+
+    if (sidetoneQuality) {
+        return runSidetoneQuality() ? 0 : 1;
+    }
+
+    if (conformance) {
+        return runConformance(quiet) ? 0 : 1;
+    }
+
+    std::vector<SimScriptEvent> script;
+    std::vector<SimExpectedElement> expected;
+    std::string expectedDecoded;
+    int32_t expectedStreamEdges = -1;
+    int32_t expectedTapsDropped = -1;
+
+    // The recorded trace and the trace of the replay
+    TraceDump dump;
+    std::vector<uint8_t> dumpData;
+    std::vector<TraceEvent> recordedTrace;
+    std::vector<TraceEvent> replayedTrace;
+    uint32_t missedEvents = 0;
+
+    if (replayPath != NULL) {
+        if (!readFile(replayPath, dumpData)) {
+            return 2;
+        }
+        if (!traceDecoderFindDump(dumpData.data(), dumpData.size(), &dump)) {
+            fprintf(stderr, "No valid trace dump in %s\n", replayPath);
+            return 2;
+        }
+        missedEvents = decodeTraceDump(dump, recordedTrace);
+        if (!quiet) {
+            for (size_t i = 0; i < recordedTrace.size(); i++) {
+                char text[64];
+                formatTraceEvent(recordedTrace[i], text, sizeof(text));
+                printf("trace %llu %s\n", (unsigned long long) (recordedTrace[i].ticks - dump.startTicks), text);
+            }
+        }
+        buildReplayScript(dump, recordedTrace, script);
+    } else if (scriptPath == NULL && stressParameters) {
+        buildStressScript(script);
+    } else {
+        FILE *scriptFile = scriptPath != NULL ? fopen(scriptPath, "r") : stdin;
+        if (scriptFile == NULL) {
+            perror(scriptPath);
+            return 2;
+        }
+
+        bool parsed = parseScript(scriptFile, script, expected, expectedDecoded, expectedStreamEdges,
+                expectedTapsDropped);
+        if (scriptFile != stdin) {
+            fclose(scriptFile);
+        }
+        if (!parsed) {
+            return 2;
+        }
+    }
+
+    if (!expectedDecoded.empty() && CW_DECODER_ENABLED != true) {
+        fprintf(stderr, "Script lines decode require a build with -D CW_DECODER_ENABLED=true\n");
+        return 2;
+    }
+
+    // The serial bytes of a replayed trace are commands too, a script writes text only for the text keyer
+    for (size_t i = 0; i < script.size() && replayPath == NULL; i++) {
+        if (TEXT_KEYER_ENABLED != true && strcmp(script[i].signal, "text") == 0) {
+            fprintf(stderr, "Script lines text require a build with -D TEXT_KEYER_ENABLED=true\n");
+            return 2;
+        }
+    }
+
+    if (expectedStreamEdges >= 0) {
+        if (KEY_STREAM_OUTPUT != true) {
+            fprintf(stderr, "Script lines edges require a build with -D KEY_STREAM_OUTPUT=true\n");
+            return 2;
+        }
+        decodeKeyStream = true;
+    }
+
+    simSetAdcNoise(adcNoise);
+    simSetParameterStress(stressParameters);
+    simInit(loopIntervalTicks);
+
+    if (rawHid) {
+        char command = RAW_HID_SERIAL_COMMAND_ENABLE;
+        simSerialInput(&command, 1);
+    }
+
+    if (wavPath != NULL) {
+        startSidetoneRendering();
+    }
+
+    TraceDecoder replayDecoder;
+    uint64_t replayStartTicks = traceRecorderStartState()->ticks;
+    uint32_t replayRecordNumber = 0;
+    traceDecoderInit(&replayDecoder, replayStartTicks);
+
+    std::vector<uint32_t> inputEdges;
+    clock_t startClock = clock();
+
+    for (size_t i = 0; i < script.size(); i++) {
+        if (replayPath != NULL) {
+            collectTrace(&replayDecoder, &replayRecordNumber, replayedTrace);
+        }
+        while (simTicks() < script[i].tick) {
+            simStep();
+            if (replayPath != NULL) {
+                collectTrace(&replayDecoder, &replayRecordNumber, replayedTrace);
+            }
+        }
+        if (!applyEvent(script[i], inputEdges)) {
+            return 2;
+        }
+    }
+    if (replayPath != NULL) {
+        collectTrace(&replayDecoder, &replayRecordNumber, replayedTrace);
+    }
+
+    // The readout and the trace dump are written to the same serial port after the decoded characters
+    size_t decodedLength = simSerialWrites().size();
+    if (instrumentation) {
+        printInstrumentation();
+    }
+    if (dumpTracePath != NULL && !dumpTrace(dumpTracePath)) {
+        return 2;
+    }
+
+    double elapsedSeconds = (double) (clock() - startClock) / CLOCKS_PER_SEC;
+
+    if (wavPath != NULL && !sidetoneWriteWav(wavPath, sidetoneRenderedSamples().data(),
+            sidetoneRenderedSamples().size())) {
+        perror(wavPath);
+        return 2;
+    }
+
+    bool keyStreamMatched = !decodeKeyStream || printKeyStream(quiet, expectedStreamEdges);
+
+    if (debugLog) {
+        printDebugLog(quiet);
+    }
+
+    // In raw HID mode the elements and latencies are measured from the edges of the raw reports
+    bool rawHidSufficient = true;
+    std::vector<SimHidEvent> rawHidEvents;
+    if (rawHid) {
+        rawHidSufficient = printRawHid(quiet, rawHidEvents);
+    }
+
+    const std::vector<SimHidEvent> &hidEvents = rawHid ? rawHidEvents : simHidEvents();
+    const std::vector<SimSidetoneEvent> &sidetoneEvents = simSidetoneEvents();
+
+    if (!quiet) {
+        for (size_t i = 0; i < hidEvents.size(); i++) {
+            printf("hid %u %u %s\n", hidEvents[i].tick, hidEvents[i].key, hidEvents[i].pressed ? "press" : "release");
+        }
+        for (size_t i = 0; i < sidetoneEvents.size(); i++) {
+            printf("sidetone %u %s\n", sidetoneEvents[i].tick, sidetoneEvents[i].on ? "on" : "off");
+        }
+    }
+
+    const std::vector<SimControlEvent> &controlEvents = simControlEvents();
+    if (!quiet) {
+        for (size_t i = 0; i < controlEvents.size(); i++) {
+            printf("control %u dit %u tuning_word %u\n", controlEvents[i].tick, controlEvents[i].ditTicks,
+                    controlEvents[i].tuningWord);
+        }
+    }
+
+    // Element timing from the HID stream of the keying key
+    uint32_t elementCount = 0;
+    uint32_t pressTick = 0;
+    uint32_t releaseTick = 0;
+    bool pressed = false;
+    for (size_t i = 0; i < hidEvents.size(); i++) {
+        if (hidEvents[i].key != hidUsageForKey(KEYBOARD_KEY_STRAIGHT)) {
+            continue;
+        }
+        if (hidEvents[i].pressed && !pressed) {
+            if (!quiet && elementCount > 0) {
+                printf("gap %u %u\n", releaseTick, hidEvents[i].tick - releaseTick);
+            }
+            pressTick = hidEvents[i].tick;
+            pressed = true;
+        } else if (!hidEvents[i].pressed && pressed) {
+            releaseTick = hidEvents[i].tick;
+            if (!quiet) {
+                printf("element %u %u\n", pressTick, releaseTick - pressTick);
+            }
+            elementCount++;
+            pressed = false;
+        }
+    }
+
+    // Edge jitter against the scheduled keyer elements
+    std::vector<uint32_t> sidetoneOnTicks;
+    std::vector<uint32_t> sidetoneOffTicks;
+    for (size_t i = 0; i < sidetoneEvents.size(); i++) {
+        (sidetoneEvents[i].on ? sidetoneOnTicks : sidetoneOffTicks).push_back(sidetoneEvents[i].tick);
+    }
+    std::vector<uint32_t> hidOnTicks;
+    std::vector<uint32_t> hidOffTicks;
+    for (size_t i = 0; i < hidEvents.size(); i++) {
+        if (hidEvents[i].key == hidUsageForKey(KEYBOARD_KEY_STRAIGHT)) {
+            (hidEvents[i].pressed ? hidOnTicks : hidOffTicks).push_back(hidEvents[i].tick);
+        }
+    }
+
+    std::map<int32_t, uint32_t> sidetoneJitter;
+    std::map<int32_t, uint32_t> hidJitter;
+    uint32_t sidetoneJitterMax = measureJitter(simScheduledElements(), sidetoneOnTicks, sidetoneOffTicks,
+            sidetoneJitter);
+    uint32_t hidJitterMax = measureJitter(simScheduledElements(), hidOnTicks, hidOffTicks, hidJitter);
+
+    if (!quiet) {
+        for (std::map<int32_t, uint32_t>::iterator it = sidetoneJitter.begin(); it != sidetoneJitter.end(); ++it) {
+            printf("jitter sidetone %d %u\n", it->first, it->second);
+        }
+        for (std::map<int32_t, uint32_t>::iterator it = hidJitter.begin(); it != hidJitter.end(); ++it) {
+            printf("jitter hid %d %u\n", it->first, it->second);
+        }
+    }
+
+    // Spaces between the sidetone elements in dit durations of the speed at the time
+    bool textSent = false;
+    for (size_t i = 0; i < script.size(); i++) {
+        textSent = textSent || strcmp(script[i].signal, "text") == 0;
+    }
+    uint32_t irregularSpaces = 0;
+    if (textSent) {
+        uint32_t spaceCounts[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        uint32_t pauses = 0;
+        size_t controlIndex = 0;
+        for (size_t i = 0; i + 1 < sidetoneEvents.size(); i++) {
+            if (sidetoneEvents[i].on || !sidetoneEvents[i + 1].on) {
+                continue;
+            }
+            while (controlIndex + 1 < controlEvents.size()
+                    && controlEvents[controlIndex + 1].tick <= sidetoneEvents[i].tick) {
+                controlIndex++;
+            }
+            uint32_t ditTicks = controlEvents.empty() ? 0 : controlEvents[controlIndex].ditTicks;
+            uint32_t spaceTicks = sidetoneEvents[i + 1].tick - sidetoneEvents[i].tick;
+            uint32_t units = ditTicks > 0 ? spaceTicks / ditTicks : 0;
+            if (ditTicks > 0 && spaceTicks % ditTicks == 0 && (units == 1 || units == 3 || units == 7)) {
+                spaceCounts[units]++;
+            } else if (ditTicks > 0 && units >= 7) {
+                // The text ran out, or the host did not keep the buffer full
+                pauses++;
+            } else {
+                irregularSpaces++;
+                if (!quiet) {
+                    printf("space %u %u irregular\n", sidetoneEvents[i].tick, spaceTicks);
+                }
+            }
+        }
+        printf("text spaces element %u character %u word %u pause %u irregular %u\n", spaceCounts[1],
+                spaceCounts[3], spaceCounts[7], pauses, irregularSpaces);
+    }
+
+    // Input edge to the first following HID report
+    uint32_t maxLatency = 0;
+    uint64_t totalLatency = 0;
+    uint32_t measuredEdges = 0;
+    size_t hidIndex = 0;
+    for (size_t i = 0; i < inputEdges.size(); i++) {
+        while (hidIndex < hidEvents.size() && hidEvents[hidIndex].tick < inputEdges[i]) {
+            hidIndex++;
+        }
+        if (hidIndex == hidEvents.size()) {
+            break;
+        }
+        uint32_t latency = hidEvents[hidIndex].tick - inputEdges[i];
+        if (latency > maxLatency) {
+            maxLatency = latency;
+        }
+        totalLatency += latency;
+        measuredEdges++;
+    }
+
+    printf("summary ticks %u elements %u hid_reports %u edges %u latency_max %u latency_mean %.2f"
+            " queue_max %u queue_overflows %u taps_dropped %u sidetone_jitter_max %u hid_jitter_max %u"
+            " hid_queue_max %u hid_coalesced %u hid_overflows %u hid_timeouts %u control_changes %zu\n",
+            simTicks(), elementCount, simHidReports(), measuredEdges, maxLatency,
+            measuredEdges > 0 ? (double) totalLatency / measuredEdges : 0.0,
+            keyerQueueHighWaterMark(), keyerQueueOverflows(), keyerTapsDropped, sidetoneJitterMax, hidJitterMax,
+            hidReportQueueHighWaterMark(), hidReportQueueCoalescedReports(), hidReportQueueOverflows(),
+            hidReportQueueSendTimeouts(), controlEvents.size() > 0 ? controlEvents.size() - 1 : 0);
+    fprintf(stderr, "Simulated %u ticks in %.3f s (%.0f ticks/s)\n", simTicks(), elapsedSeconds,
+            elapsedSeconds > 0 ? simTicks() / elapsedSeconds : 0.0);
+
+    if (maxLatencyTicks >= 0 && maxLatency > (uint32_t) maxLatencyTicks) {
+        fprintf(stderr, "Latency %u ticks exceeds maximum of %ld ticks\n", maxLatency, maxLatencyTicks);
+        return 1;
+    }
+
+    if (stressParameters) {
+        uint32_t minimumUpdates = (uint32_t) (simTicks() / simTickRate() * SIM_STRESS_MINIMUM_UPDATES_PER_SECOND);
+        printf("parameters updates %u checks %u torn %u\n", simParameterUpdates(), simParameterChecks(),
+                simParameterTornSnapshots());
+        if (simParameterTornSnapshots() > 0) {
+            fprintf(stderr, "The tick interrupt saw a torn keyer parameter block\n");
+            return 1;
+        }
+        if (simParameterUpdates() < minimumUpdates || minimumUpdates == 0) {
+            fprintf(stderr, "The potentiometer sweep made %u parameter updates, expected at least %u\n",
+                    simParameterUpdates(), minimumUpdates > 0 ? minimumUpdates : 1);
+            return 1;
+        }
+    }
+
+#if IDLE_MODE_ENABLED == true
+    printIdleMode(sidetoneOnTicks);
+#endif
+
+    if (clockErrorSet && !checkTimebase(clockError, stressParameters)) {
+        return 1;
+    }
+
+    // Paddle break-in interrupts the text with irregular spaces
+    if (irregularSpaces > 0 && inputEdges.empty()) {
+        fprintf(stderr, "The text keyer left %u irregular spaces between elements\n", irregularSpaces);
+        return 1;
+    }
+
+    if (!checkGoldenTrace(sidetoneEvents, expected, printGolden)) {
+        return 1;
+    }
+
+    if (expectedTapsDropped >= 0 && keyerTapsDropped != (uint32_t) expectedTapsDropped) {
+        fprintf(stderr, "The keyer dropped %u paddle taps instead of %d\n", keyerTapsDropped, expectedTapsDropped);
+        return 1;
+    }
+
+    if (replayPath != NULL && !checkReplay(recordedTrace, dump, replayedTrace,
+            replayStartTicks + replayLeadTicks(dump), missedEvents)) {
+        return 1;
+    }
+
+    if (CW_DECODER_ENABLED == true && !checkDecodedText(expectedDecoded, decodedLength)) {
+        return 1;
+    }
+
+    if (!keyStreamMatched) {
+        return 1;
+    }
+
+    if (!rawHidSufficient) {
+        fprintf(stderr, "Raw HID reports did not carry all edges within one report per USB frame\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,421 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "replay.h"
+#include "simulator.h"
+#include "pins.h"
+#include "key_stream.h"
+#include "adc_sampler.h"
+#include "trace_recorder.h"
+#include "ticks.h"
+
+// A trace that does not begin at the start of the firmware is replayed from this long after the start
+// of the simulation, for the ADC sampler to settle
+#define REPLAY_LEAD_TICKS 3138
+// Idle periods longer than this are skipped, apart from a second at each end
+#define REPLAY_SKIP_TICKS 313766
+#define REPLAY_SKIP_MARGIN_TICKS 31377
+// The outputs are compared from the first key or PTT press after the outputs have been idle for 250 ms,
+// a replayed press is matched to it if it is at most 1 ms earlier
+#define REPLAY_IDLE_TICKS 7844
+#define REPLAY_SYNC_TICKS 31
+// The ADC sampler publishes a potentiometer change after the samples of both channels have been summed
+#define REPLAY_ADC_LATENCY_TICKS (ADC_SAMPLER_OVERSAMPLING * ADC_SAMPLER_CHANNEL_COUNT * SIM_ADC_CONVERSION_TICKS)
+
+// Events of the trace that the keyer logic produces from the inputs
+static bool isTraceOutput(uint8_t type)
+{
+    return type == TRACE_EVENT_DEBOUNCED || type == TRACE_EVENT_ELEMENT || type == TRACE_EVENT_OUTPUT;
+}
+
+void formatTraceEvent(const TraceEvent &event, char *text, size_t size)
+{
+    static const char *inputNames[4] = {"straight", "dit", "dah", "ptt"};
+    static const char *outputNames[4] = {"key", "dit", "dah", "ptt"};
+    uint8_t index = event.argument & TRACE_INPUT_MASK & 3;
+    bool flag = (event.argument & TRACE_ON) != 0;
+    const char *name = traceDecoderEventName(event.type);
+
+    switch (event.type) {
+        case TRACE_EVENT_PIN:
+            snprintf(text, size, "%s %s %s", name, inputNames[index], flag ? "high" : "low");
+            break;
+        case TRACE_EVENT_DEBOUNCED:
+            snprintf(text, size, "%s %s %s", name, inputNames[index], flag ? "on" : "off");
+            break;
+        case TRACE_EVENT_OUTPUT:
+            snprintf(text, size, "%s %s %s", name, outputNames[index], flag ? "on" : "off");
+            break;
+        case TRACE_EVENT_ELEMENT:
+            snprintf(text, size, "%s %s", name, event.argument == KEYER_ACTION_DAH ? "dah" : "dit");
+            break;
+        case TRACE_EVENT_SWITCHES:
+            snprintf(text, size, "%s automatic %s iambic %s inverted %s", name,
+                    (event.argument & TRACE_SWITCH_AUTOMATIC) ? "on" : "off",
+                    (event.argument & TRACE_SWITCH_IAMBIC) ? "on" : "off",
+                    (event.argument & TRACE_SWITCH_INVERTED) ? "on" : "off");
+            break;
+        case TRACE_EVENT_MODE:
+            snprintf(text, size, "%s %s", name,
+                    event.argument < KEYER_MODE_COUNT ? keyerModeNames[event.argument] : "unknown");
+            break;
+        case TRACE_EVENT_SPEED:
+            snprintf(text, size, "%s %u", name, event.value);
+            break;
+        case TRACE_EVENT_SERIAL:
+            snprintf(text, size, "%s 0x%02x", name, event.value);
+            break;
+        default:
+            snprintf(text, size, "%s 0x%x", name, event.type | event.argument);
+            break;
+    }
+}
+
+uint32_t decodeTraceDump(const TraceDump &dump, std::vector<TraceEvent> &events)
+{
+    TraceDecoder decoder;
+    traceDecoderInit(&decoder, dump.startTicks);
+
+    for (uint16_t i = 0; i < dump.recordCount; i++) {
+        const uint8_t *record = &dump.records[i * TRACE_RECORD_SIZE];
+        TraceEvent event;
+        if (traceDecoderFeed(&decoder, record[0], (uint16_t) (record[1] | (record[2] << 8)), &event)) {
+            events.push_back(event);
+        }
+    }
+
+    return decoder.missedEventCount;
+}
+
+void collectTrace(TraceDecoder *decoder, uint32_t *recordNumber, std::vector<TraceEvent> &events)
+{
+    for (; *recordNumber < traceRecorderRecordCount(); (*recordNumber)++) {
+        uint8_t record;
+        uint16_t value;
+        TraceEvent event;
+        if (traceRecorderReadRecord(*recordNumber, &record, &value) && traceDecoderFeed(decoder, record, value, &event)) {
+            events.push_back(event);
+        }
+    }
+}
+
+uint64_t replayLeadTicks(const TraceDump &dump)
+{
+    return (dump.startFlags & TRACE_START_OVERWRITTEN) ? REPLAY_LEAD_TICKS : 0;
+}
+
+struct ReplayEvent {
+    uint64_t ticks;
+    SimScriptEvent event;
+};
+
+static bool replayEventBefore(const ReplayEvent &a, const ReplayEvent &b)
+{
+    return a.ticks < b.ticks;
+}
+
+static bool traceEventBefore(const TraceEvent &a, const TraceEvent &b)
+{
+    return a.ticks < b.ticks;
+}
+
+static void addReplayEvent(std::vector<ReplayEvent> &events, uint64_t ticks, const char *signal, const char *value)
+{
+    ReplayEvent replayEvent;
+    memset(&replayEvent, 0, sizeof(replayEvent));
+    replayEvent.ticks = ticks;
+    strncpy(replayEvent.event.signal, signal, sizeof(replayEvent.event.signal) - 1);
+    strncpy(replayEvent.event.value, value, sizeof(replayEvent.event.value) - 1);
+    events.push_back(replayEvent);
+}
+
+// Adds the switches that differ from the previous states
+static void addReplaySwitches(std::vector<ReplayEvent> &events, uint64_t ticks, uint8_t switches, uint8_t previous)
+{
+    static const char *signals[3] = {"automatic", "iambic", "inverted"};
+    for (uint8_t i = 0; i < 3; i++) {
+        uint8_t mask = 1 << i;
+        if ((switches & mask) != (previous & mask)) {
+            addReplayEvent(events, ticks, signals[i], (switches & mask) ? "on" : "off");
+        }
+    }
+}
+
+// The pin the pin change interrupt routes to the input with the given switches
+static void addReplayPin(std::vector<ReplayEvent> &events, uint64_t ticks, uint8_t input, bool high, uint8_t switches)
+{
+    bool inverted = (switches & TRACE_SWITCH_INVERTED) != 0;
+    const char *signal;
+    bool on;
+    switch (input) {
+        case KEY_STREAM_INPUT_DIT:
+            signal = inverted ? "ring" : "tip";
+            break;
+        case KEY_STREAM_INPUT_DAH:
+            signal = inverted ? "tip" : "ring";
+            break;
+        case KEY_STREAM_INPUT_PTT:
+            signal = "ptt";
+            break;
+        default:
+            signal = "tip";
+            break;
+    }
+    if (input == KEY_STREAM_INPUT_PTT) {
+        on = high == (PIN_STATE_PTT_ON == HIGH);
+    } else {
+        on = high == (PIN_STATE_KEY_ON == HIGH);
+    }
+    addReplayEvent(events, ticks, signal, on ? "on" : "off");
+}
+
+void buildReplayScript(const TraceDump &dump, const std::vector<TraceEvent> &trace,
+        std::vector<SimScriptEvent> &script)
+{
+    uint64_t leadTicks = replayLeadTicks(dump);
+    std::vector<TraceEvent> inputs;
+    std::vector<uint64_t> ticks;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (!isTraceOutput(trace[i].type)) {
+            inputs.push_back(trace[i]);
+        }
+        ticks.push_back(trace[i].ticks - dump.startTicks + leadTicks);
+    }
+    // Pin edges are recorded when the main loop sees them, after the events of the previous loop
+    std::stable_sort(inputs.begin(), inputs.end(), traceEventBefore);
+    uint64_t endTicks = dump.endTicks - dump.startTicks + leadTicks;
+    ticks.push_back(endTicks);
+    std::sort(ticks.begin(), ticks.end());
+
+    std::vector<ReplayEvent> events;
+    char value[24];
+    uint8_t switches = dump.startSwitches;
+    addReplaySwitches(events, 0, switches, ~switches);
+    snprintf(value, sizeof(value), "%u", dump.startSpeed);
+    addReplayEvent(events, 0, "speed", value);
+    if (dump.startMode < KEYER_MODE_COUNT) {
+        addReplayEvent(events, 0, "mode", keyerModeNames[dump.startMode]);
+    }
+    for (uint8_t input = 0; input <= KEY_STREAM_INPUT_PTT; input++) {
+        if (!(dump.startPins & (1 << input))) {
+            addReplayPin(events, 0, input, false, switches);
+        }
+    }
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        uint64_t eventTicks = inputs[i].ticks - dump.startTicks + leadTicks;
+        uint64_t loopTicks = eventTicks > 0 ? eventTicks - 1 : 0;
+        switch (inputs[i].type) {
+            case TRACE_EVENT_PIN:
+                addReplayPin(events, eventTicks, inputs[i].argument & TRACE_INPUT_MASK,
+                        (inputs[i].argument & TRACE_PIN_HIGH) != 0, switches);
+                break;
+            case TRACE_EVENT_SWITCHES:
+                addReplaySwitches(events, loopTicks, inputs[i].argument, switches);
+                switches = inputs[i].argument;
+                break;
+            case TRACE_EVENT_MODE:
+                if (inputs[i].argument < KEYER_MODE_COUNT) {
+                    addReplayEvent(events, loopTicks, "mode", keyerModeNames[inputs[i].argument]);
+                }
+                break;
+            case TRACE_EVENT_SPEED:
+                // The recorded value is the one published by the ADC sampler, the first value at the start
+                // of the firmware is read without the delay
+                snprintf(value, sizeof(value), "%u", inputs[i].value);
+                addReplayEvent(events, inputs[i].ticks - dump.startTicks < REPLAY_ADC_LATENCY_TICKS ? 0
+                        : eventTicks - REPLAY_ADC_LATENCY_TICKS, "speed", value);
+                break;
+            case TRACE_EVENT_SERIAL:
+                // The text signal writes a string to the serial port
+                if (inputs[i].value != 0) {
+                    value[0] = (char) inputs[i].value;
+                    value[1] = '\0';
+                    addReplayEvent(events, loopTicks, "text", value);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (size_t i = 0; i + 1 < ticks.size(); i++) {
+        if (ticks[i + 1] - ticks[i] <= REPLAY_SKIP_TICKS) {
+            continue;
+        }
+        // In parts within the wraparound-safe distance of the firmware ticks
+        uint64_t skipTicks = ticks[i + 1] - ticks[i] - 2 * REPLAY_SKIP_MARGIN_TICKS;
+        for (uint64_t skipped = 0; skipped < skipTicks; skipped += TICKS_MAXIMUM_AGE) {
+            uint64_t part = skipTicks - skipped < TICKS_MAXIMUM_AGE ? skipTicks - skipped : TICKS_MAXIMUM_AGE;
+            snprintf(value, sizeof(value), "%llu", (unsigned long long) part);
+            addReplayEvent(events, ticks[i] + REPLAY_SKIP_MARGIN_TICKS + skipped, "skip", value);
+        }
+    }
+    addReplayEvent(events, endTicks, "end", "");
+    std::stable_sort(events.begin(), events.end(), replayEventBefore);
+
+    // The script is in simulator ticks, which do not include the skipped periods
+    uint64_t skippedTicks = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        events[i].event.tick = (uint32_t) (events[i].ticks - skippedTicks);
+        if (strcmp(events[i].event.signal, "skip") == 0) {
+            skippedTicks += strtoull(events[i].event.value, NULL, 10);
+        }
+        script.push_back(events[i].event);
+    }
+}
+
+static bool isTracePress(const TraceEvent &event)
+{
+    return event.type == TRACE_EVENT_DEBOUNCED && (event.argument & TRACE_ON);
+}
+
+/**
+ * Finds the first recorded press that the keyer state before the trace does not affect: the previous output
+ * event is a release or the end of an output at least REPLAY_IDLE_TICKS before the press, or the start
+ * of the trace is.
+ */
+static size_t findRecordedSync(const std::vector<TraceEvent> &events, const TraceDump &dump)
+{
+    uint64_t idleTicks = dump.startTicks;
+    bool idle = true;
+    for (size_t i = 0; i < events.size(); i++) {
+        if (!isTraceOutput(events[i].type)) {
+            continue;
+        }
+        if (isTracePress(events[i]) && idle && events[i].ticks >= idleTicks + REPLAY_IDLE_TICKS) {
+            return i;
+        }
+        idleTicks = events[i].ticks;
+        idle = events[i].type != TRACE_EVENT_ELEMENT && !(events[i].argument & TRACE_ON);
+    }
+    return events.size();
+}
+
+// Finds the first replayed press of the given input at or after the given tick (relative to the trace start)
+static size_t findReplayedSync(const std::vector<TraceEvent> &events, uint64_t startTicks, uint8_t argument,
+        int64_t syncTicks)
+{
+    for (size_t i = 0; i < events.size(); i++) {
+        if (isTracePress(events[i]) && events[i].argument == argument
+                && (int64_t) (events[i].ticks - startTicks) >= syncTicks) {
+            return i;
+        }
+    }
+    return events.size();
+}
+
+static void collectReplayOutputs(const std::vector<TraceEvent> &events, size_t first, uint64_t startTicks,
+        std::vector<TraceEvent> &outputs)
+{
+    for (size_t i = first; i < events.size(); i++) {
+        if (isTraceOutput(events[i].type)) {
+            TraceEvent event = events[i];
+            event.ticks -= startTicks;
+            outputs.push_back(event);
+        }
+    }
+}
+
+bool checkReplay(const std::vector<TraceEvent> &recorded, const TraceDump &dump,
+        const std::vector<TraceEvent> &replayed, uint64_t replayedStartTicks, uint32_t missedEvents)
+{
+    uint64_t recordedStartTicks = dump.startTicks;
+    // A trace from the start of the firmware is compared from the start
+    size_t recordedSync = 0;
+    size_t replayedSync = 0;
+    if (dump.startFlags & TRACE_START_OVERWRITTEN) {
+        recordedSync = findRecordedSync(recorded, dump);
+        replayedSync = recordedSync == recorded.size() ? replayed.size()
+                : findReplayedSync(replayed, replayedStartTicks, recorded[recordedSync].argument,
+                        (int64_t) (recorded[recordedSync].ticks - recordedStartTicks) - REPLAY_SYNC_TICKS);
+    }
+
+    std::vector<TraceEvent> expected;
+    std::vector<TraceEvent> actual;
+    collectReplayOutputs(recorded, recordedSync, recordedStartTicks, expected);
+    collectReplayOutputs(replayed, replayedSync, replayedStartTicks, actual);
+
+    int64_t maxOffset = 0;
+    size_t matched = 0;
+    for (; matched < expected.size() && matched < actual.size(); matched++) {
+        if (expected[matched].type != actual[matched].type || expected[matched].argument != actual[matched].argument) {
+            break;
+        }
+        int64_t offset = (int64_t) actual[matched].ticks - (int64_t) expected[matched].ticks;
+        if ((offset < 0 ? -offset : offset) > maxOffset) {
+            maxOffset = offset < 0 ? -offset : offset;
+        }
+    }
+
+    printf("replay outputs %zu matched %zu offset_max %lld missed %u\n", expected.size(), matched,
+            (long long) maxOffset, missedEvents);
+    if (missedEvents > 0) {
+        fprintf(stderr, "The trace has a gap of %u events recorded during a previous dump\n", missedEvents);
+    }
+    if (recordedSync == recorded.size() && !recorded.empty()) {
+        fprintf(stderr, "The overwritten trace has no press after an idle period to compare from\n");
+    }
+
+    if (matched == expected.size() && matched == actual.size()) {
+        return true;
+    }
+
+    char text[64];
+    fprintf(stderr, "Replay mismatch at output %zu: expected", matched);
+    if (matched < expected.size()) {
+        formatTraceEvent(expected[matched], text, sizeof(text));
+        fprintf(stderr, " %s at %lld", text, (long long) expected[matched].ticks);
+    } else {
+        fprintf(stderr, " none");
+    }
+    if (matched < actual.size()) {
+        formatTraceEvent(actual[matched], text, sizeof(text));
+        fprintf(stderr, ", got %s at %lld\n", text, (long long) actual[matched].ticks);
+    } else {
+        fprintf(stderr, ", got none\n");
+    }
+    return false;
+}
+
+bool dumpTrace(const char *path)
+{
+    size_t offset = simSerialWrites().size();
+    char command = TRACE_SERIAL_COMMAND_DUMP;
+    simSerialInput(&command, 1);
+
+    uint32_t deadline = simTicks() + simMillisToTicks(1000);
+    do {
+        simStep();
+    } while ((simSerialWrites().size() == offset || traceRecorderDumping()) && simTicks() < deadline);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    const std::string &output = simSerialWrites();
+    fwrite(output.data() + offset, 1, output.size() - offset, file);
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,58 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Trace dump and replay of the simulator runner, options --dump-trace and --replay.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_REPLAY_H
+#define WRC_MORSE_KEY_ADAPTER_REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "runner.h"
+#include "trace_decoder.h"
+
+// Formats an event of the trace for printing
+void formatTraceEvent(const TraceEvent &event, char *text, size_t size);
+
+// Decodes all records of a dump
+uint32_t decodeTraceDump(const TraceDump &dump, std::vector<TraceEvent> &events);
+
+// Collects the records of the simulated firmware as they are recorded
+void collectTrace(TraceDecoder *decoder, uint32_t *recordNumber, std::vector<TraceEvent> &events);
+
+// A trace from the start of the firmware is replayed from the start of the simulation
+uint64_t replayLeadTicks(const TraceDump &dump);
+
+/**
+ * Converts the start state and the input events of a dump to script events, with the idle periods skipped.
+ * The pin edges are applied at the recorded tick, like the pin change interrupt saw them, and the inputs
+ * recorded by the main loop a tick before, so that the loop sees them at the recorded tick.
+ */
+void buildReplayScript(const TraceDump &dump, const std::vector<TraceEvent> &trace,
+        std::vector<SimScriptEvent> &script);
+
+// Compares the outputs of the replay with the recorded ones, prints the first mismatch
+bool checkReplay(const std::vector<TraceEvent> &recorded, const TraceDump &dump,
+        const std::vector<TraceEvent> &replayed, uint64_t replayedStartTicks, uint32_t missedEvents);
+
+// Requests a trace dump through the serial port and writes the serial output of the dump to a file
+bool dumpTrace(const char *path);
+
+#endif
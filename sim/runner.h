@@ -0,0 +1,55 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Script events and firmware functions shared by the runners of the simulator command line. The firmware
+ * functions have no header, the runners set the keyer with them directly.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_RUNNER_H
+#define WRC_MORSE_KEY_ADAPTER_RUNNER_H
+
+#include <stdint.h>
+
+#include "keyer_modes.h"
+
+// Sets the keyer modes of the iambic switch positions in the firmware
+void keyerSetSwitchModes(uint8_t switchOnMode, uint8_t switchOffMode);
+
+// Sets the sidetone pitch in the firmware, with the timebase calibration applied
+void keyerSetTuningWord(uint32_t tuningWord);
+
+// Sets the keyer speed in the firmware, until the speed potentiometer changes
+void keyerSetSpeedWpm(int wpm);
+
+// Keyer speed and tuning word of the firmware before the timebase calibration
+extern uint8_t keyerSpeedWpm;
+extern uint32_t keyerTuningWord;
+
+// Paddle taps the firmware dropped because the paddle memory was full
+extern uint32_t keyerTapsDropped;
+
+// Keyer mode names of the script signal mode and the trace output, by mode number
+extern const char *keyerModeNames[KEYER_MODE_COUNT];
+
+// An input of a script at a simulator tick
+struct SimScriptEvent {
+    uint32_t tick;
+    char signal[16];
+    char value[128];
+};
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "sidetone_quality.h"
+#include "simulator.h"
+#include "runner.h"
+#include "keyer_config.h"
+#include "sidetone_analyzer.h"
+
+// Pitches of the sidetone quality sweep, the time to start the sidetone and the time to settle after a pitch change
+#define SIM_SIDETONE_PITCH_STEP 100
+#define SIM_SIDETONE_START_MILLIS 200
+#define SIM_SIDETONE_SETTLE_MILLIS 20
+
+// Sidetone on and off ramps keyed after the pitch sweep, so that the ADC samples are also taken at low amplitude
+#define SIM_SIDETONE_RAMPS 20
+
+static SidetoneRenderer sidetoneRenderer;
+static std::vector<float> sidetoneSamples;
+
+static void renderSidetone(uint16_t value)
+{
+    float samples[SIDETONE_RENDER_MAX_SAMPLES];
+    size_t count = sidetoneRendererPeriod(&sidetoneRenderer, value, SIM_PWM_TOP, samples);
+    sidetoneSamples.insert(sidetoneSamples.end(), samples, samples + count);
+}
+
+void startSidetoneRendering()
+{
+    sidetoneRendererInit(&sidetoneRenderer, 1.0 / simTickRate());
+    sidetoneSamples.clear();
+    simSetPwmListener(renderSidetone);
+}
+
+const std::vector<float> &sidetoneRenderedSamples()
+{
+    return sidetoneSamples;
+}
+
+bool runSidetoneQuality()
+{
+    simInit(1);
+    startSidetoneRendering();
+
+    // The potentiometers have been sampled and the coupling capacitor has charged by the first pitch
+    pwmSetEnabled(true);
+    uint32_t startTicks = simMillisToTicks(SIM_SIDETONE_START_MILLIS);
+    while (simTicks() < startTicks) {
+        simStep();
+    }
+
+    double worstError = 0;
+    double worstThd = 0;
+    double worstThdNoise = 0;
+    double worstSpur = -INFINITY;
+    for (int pitch = KEYER_PITCH_MINIMUM; pitch <= KEYER_PITCH_MAXIMUM; pitch += SIM_SIDETONE_PITCH_STEP) {
+        keyerTuningWord = pwmFrequencyToTuningWord(pitch);
+        keyerSetTuningWord(keyerTuningWord);
+
+        uint32_t settleTicks = simTicks() + simMillisToTicks(SIM_SIDETONE_SETTLE_MILLIS);
+        while (simTicks() < settleTicks) {
+            simStep();
+        }
+        sidetoneSamples.clear();
+        while (sidetoneSamples.size() < SIDETONE_ANALYSIS_SIZE) {
+            simStep();
+        }
+
+        SidetoneQuality quality;
+        sidetoneAnalyze(sidetoneSamples.data(), pitch, &quality);
+        double error = (quality.frequency / pitch - 1.0) * 1000000.0;
+        printf("sidetone pitch %d frequency %.4f Hz error %+.1f ppm level %.1f dB thd %.3f %% thd_n %.3f %%"
+                " spur %.1f dBc at %.0f Hz\n", pitch, quality.frequency, error,
+                20 * log10(quality.level / SIDETONE_FULL_SCALE), quality.thd * 100, quality.thdNoise * 100,
+                quality.spurDbc, quality.spurFrequency);
+
+        worstError = fmax(worstError, fabs(error));
+        worstThd = fmax(worstThd, quality.thd);
+        worstThdNoise = fmax(worstThdNoise, quality.thdNoise);
+        worstSpur = fmax(worstSpur, quality.spurDbc);
+    }
+
+    printf("sidetone worst error %.1f ppm thd %.3f %% thd_n %.3f %% spur %.1f dBc\n", worstError, worstThd * 100,
+            worstThdNoise * 100, worstSpur);
+
+    for (int i = 0; i < SIM_SIDETONE_RAMPS; i++) {
+        pwmSetEnabled(i % 2 != 0);
+        uint32_t settleTicks = simTicks() + simMillisToTicks(SIM_SIDETONE_SETTLE_MILLIS);
+        while (simTicks() < settleTicks) {
+            simStep();
+        }
+    }
+    pwmSetEnabled(false);
+
+    // The PWM output only switches close to the sample-and-hold at the top of the counter, at the peaks
+    // of the full amplitude sine
+    uint32_t conversions = simAdcConversions() > 0 ? simAdcConversions() : 1;
+    uint16_t lowestValue = simAdcEdgeLowestPwmValue();
+    printf("adc conversions %u near_pwm_edge %u (%.2f %%) lowest_pwm_value %d of %d\n", simAdcConversions(),
+            simAdcEdgeConversions(), simAdcEdgeConversions() * 100.0 / conversions,
+            lowestValue == UINT16_MAX ? -1 : lowestValue, SIM_PWM_TOP);
+    if (lowestValue < SIM_PWM_TOP / 2) {
+        fprintf(stderr, "An ADC conversion was sampled close to a PWM output edge at a low sidetone amplitude\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Sidetone rendering of the simulator runner and the --sidetone-quality run.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_SIDETONE_QUALITY_H
+#define WRC_MORSE_KEY_ADAPTER_SIDETONE_QUALITY_H
+
+#include <vector>
+
+// Renders the sidetone of every simulated tick from now on, see host/sidetone_analyzer.h
+void startSidetoneRendering();
+
+// Samples rendered since startSidetoneRendering()
+const std::vector<float> &sidetoneRenderedSamples();
+
+// Keys the sidetone at each pitch of the potentiometer range and prints the quality of the filtered output,
+// then keys envelope ramps and prints the ADC conversions sampled close to an edge of the PWM output.
+// Returns false if such a conversion was sampled at less than half the sidetone amplitude.
+bool runSidetoneQuality();
+
+#endif
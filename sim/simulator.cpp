@@ -0,0 +1,775 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "simulator.h"
+#include "dds_sine_generator.h"
+#include "keyer_queue.h"
+#include "hid_report_queue.h"
+#include "raw_hid_format.h"
+#include "keyer_parameters.h"
+#include "keyer_config.h"
+#include "pins.h"
+#include "timebase_calibration.h"
+
+void setup();
+
+void loop();
+
+struct SimPin {
+    int level;
+    void (*handler)();
+};
+
+static SimPin simPins[SIM_PIN_COUNT];
+// Input levels of the ports, indexed by HAL_PORT_*
+static uint8_t simPortLevels[HAL_PORT_F + 1];
+static uint16_t simAnalogValues[SIM_PIN_COUNT];
+
+static uint32_t simTickCount = 0;
+static double simClockRate = SIM_TICK_RATE;
+static uint32_t simFirmwareTickOffset = 0;
+static uint32_t simLoopIntervalTicks = 1;
+static bool simSidetoneOn = false;
+static uint16_t simPwmValue = 0;
+// The compare value is double-buffered: a value written by the tick interrupt is used from the next BOTTOM
+static uint16_t simPwmActiveValue = 0;
+static void (*simPwmListener)(uint16_t value) = NULL;
+static bool simPwmTickInterruptEnabled = true;
+static bool simAdcEnabled = false;
+static uint8_t simAdcPin = 0;
+static uint16_t simAdcResultValue = 0;
+static uint16_t simAdcNoise = 0;
+static uint32_t simAdcNoiseState = 1;
+static uint32_t simAdcConversionCount = 0;
+static uint32_t simAdcEdgeConversionCount = 0;
+static uint16_t simAdcEdgeLowestValue = UINT16_MAX;
+static bool simSetupDone = false;
+static bool simParameterStress = false;
+static uint32_t simParameterUpdateCount = 0;
+static uint32_t simParameterCheckCount = 0;
+static uint32_t simParameterTornCount = 0;
+static KeyerTiming simParameterValidTiming;
+static uint32_t simParameterValidTuningWord = 0;
+static uint8_t simParameterActive = 0;
+
+static std::vector<SimHidEvent> simHidEventList;
+static std::vector<SimSidetoneEvent> simSidetoneEventList;
+static std::vector<SimRawHidReport> simRawHidReportList;
+static std::vector<SimControlEvent> simControlEventList;
+static HidKeyboardReport simKeyboardReport;
+static bool simUsbPolling = true;
+static bool simHidReportSent = false;
+static uint32_t simHidReportFrame = 0;
+static uint32_t simHidReportCount = 0;
+static uint32_t simHidRejectedReportCount = 0;
+static std::vector<SimElement> simScheduledElementList;
+static uint8_t simKeyerQueueHead = 0;
+static std::string simSerialText;
+static std::string simSerialWriteText;
+static std::string simSerialInputText;
+static size_t simSerialInputOffset = 0;
+static uint32_t simSerialPacketTick = 0;
+static bool simSerialPacketPending = false;
+static std::vector<uint32_t> simSerialWriteTickList;
+static std::vector<size_t> simSerialWriteOffsetList;
+static std::vector<uint8_t> simEepromData(SIM_EEPROM_SIZE, 0xFF);
+static uint32_t simEepromWriteCount = 0;
+static uint32_t simEepromReadyTick = 0;
+static uint32_t simEepromBlockedTickCount = 0;
+// Idle rate tick: the interrupt runs once per HAL_PWM_IDLE_TICKS ticks from the base tick
+static bool simPwmIdle = false;
+static uint32_t simPwmIdleBase = 0;
+static uint32_t simIdleEntryCount = 0;
+static std::vector<uint32_t> simIdleExitTickList;
+// The CPU sleeps until the next interrupt, the USB start of frame interrupt included
+static bool simCpuSleeping = false;
+static uint32_t simSleepFrame = 0;
+static uint32_t simSleepTickCount = 0;
+static uint32_t simTickInterruptCount = 0;
+
+static uint32_t simUsbFrame();
+
+void simInit(uint32_t loopIntervalTicks)
+{
+    for (int i = 0; i < SIM_PIN_COUNT; i++) {
+        // Inputs are pulled up when nothing is connected
+        simPins[i].level = HIGH;
+        simPins[i].handler = NULL;
+        simAnalogValues[i] = 0;
+    }
+    memset(simPortLevels, 0xFF, sizeof(simPortLevels));
+
+    simTickCount = 0;
+    simLoopIntervalTicks = loopIntervalTicks > 0 ? loopIntervalTicks : 1;
+    simPwmIdle = false;
+    simPwmIdleBase = 0;
+    simIdleEntryCount = 0;
+    simIdleExitTickList.clear();
+    simCpuSleeping = false;
+    simSleepTickCount = 0;
+    simTickInterruptCount = 0;
+    simPwmActiveValue = 0;
+    simAdcConversionCount = 0;
+    simAdcEdgeConversionCount = 0;
+    simAdcEdgeLowestValue = UINT16_MAX;
+
+    setup();
+    simSetupDone = true;
+    simParameterActive = keyerParametersActive;
+}
+
+void simSetDigital(uint8_t pin, int level)
+{
+    if (pin >= SIM_PIN_COUNT || simPins[pin].level == level) {
+        return;
+    }
+
+    simPins[pin].level = level;
+    if (pinPort(pin) != HAL_PORT_NONE) {
+        if (level == HIGH) {
+            simPortLevels[pinPort(pin)] |= pinMask(pin);
+        } else {
+            simPortLevels[pinPort(pin)] &= ~pinMask(pin);
+        }
+    }
+    if (simPins[pin].handler != NULL) {
+        simCpuSleeping = false;
+        simPins[pin].handler();
+    }
+}
+
+void simSetAnalog(uint8_t pin, uint16_t value)
+{
+    if (pin < SIM_PIN_COUNT) {
+        simAnalogValues[pin] = value;
+    }
+}
+
+// Keyer state of the firmware observed by the simulator
+extern volatile uint32_t pwmInterruptCounter;
+
+void simSetParameterStress(bool stress)
+{
+    simParameterStress = stress;
+}
+
+// Checks that the published parameter block is the result of a single update: a timing of one
+// keyer speed and a tuning word of one pitch potentiometer position
+static void simCheckParameters()
+{
+    const KeyerParameters *parameters = keyerParameters();
+    simParameterCheckCount++;
+    if (keyerParametersActive != simParameterActive) {
+        simParameterActive = keyerParametersActive;
+        simParameterUpdateCount++;
+    }
+
+    // The values are corrected by the timebase calibration, the block published before a calibration change
+    // was valid for the previous correction
+    bool timingValid = memcmp(&simParameterValidTiming, &parameters->timing, sizeof(KeyerTiming)) == 0;
+    for (int wpm = KEYER_SPEED_WPM_MINIMUM; wpm <= KEYER_SPEED_WPM_MAXIMUM && !timingValid; wpm++) {
+        KeyerTiming timing;
+        keyerTimingForSpeedWpm(wpm, &timing);
+        timebaseCalibrateTiming(&timing);
+        timingValid = memcmp(&timing, &parameters->timing, sizeof(KeyerTiming)) == 0;
+    }
+
+    bool tuningWordValid = parameters->tuningWord == simParameterValidTuningWord
+            || parameters->tuningWord == timebaseCalibrateTuningWord(pwmFrequencyToTuningWord(KEYER_PITCH_DEFAULT));
+    for (uint16_t value = 0; value < KEYER_ANALOG_TABLE_SIZE && !tuningWordValid; value++) {
+        tuningWordValid = parameters->tuningWord == timebaseCalibrateTuningWord(keyerTuningWordForAnalogValue(value));
+    }
+
+    if (timingValid) {
+        simParameterValidTiming = parameters->timing;
+    }
+    if (tuningWordValid) {
+        simParameterValidTuningWord = parameters->tuningWord;
+    }
+
+    if (!timingValid || !tuningWordValid) {
+        simParameterTornCount++;
+    }
+}
+
+uint8_t halInterruptsDisable()
+{
+    return 0;
+}
+
+void halInterruptsRestore(uint8_t state)
+{
+}
+
+void halPreemptionPoint()
+{
+    if (simParameterStress && simSetupDone) {
+        simCheckParameters();
+    }
+}
+
+uint32_t simParameterUpdates()
+{
+    return simParameterUpdateCount;
+}
+
+uint32_t simParameterChecks()
+{
+    return simParameterCheckCount;
+}
+
+uint32_t simParameterTornSnapshots()
+{
+    return simParameterTornCount;
+}
+
+// Triangle wave between 0 and the maximum ADC code with the given period in ticks
+static uint16_t simTriangle(uint32_t tick, uint32_t periodTicks)
+{
+    uint32_t phase = tick % periodTicks;
+    uint32_t half = periodTicks / 2;
+    uint32_t distance = phase < half ? phase : periodTicks - phase;
+    return (uint16_t) (distance * 1023 / half);
+}
+
+void simSetAdcNoise(uint16_t amplitude)
+{
+    simAdcNoise = amplitude;
+}
+
+// Converts the selected input with uniformly distributed noise of the given amplitude
+// Distance in CPU clocks from the sample-and-hold to the nearest edge of the PWM output, which switches where
+// the counter matches the compare value counting up and counting down. Compare values 0 and TOP keep the output
+// constant.
+static uint32_t simAdcHoldEdgeDistance(uint16_t value)
+{
+    if (value == 0 || value >= SIM_PWM_TOP) {
+        return UINT32_MAX;
+    }
+
+    int32_t hold = SIM_ADC_HOLD_CPU_CLOCKS * SIM_PWM_TIMER_CLOCKS_PER_CPU_CLOCK;
+    int32_t up = abs(hold - (int32_t) value);
+    int32_t down = abs(hold - (2 * SIM_PWM_TOP - (int32_t) value));
+    return (uint32_t) (up < down ? up : down) / SIM_PWM_TIMER_CLOCKS_PER_CPU_CLOCK;
+}
+
+static void simAdcConvert()
+{
+    simAdcConversionCount++;
+    if (simAdcHoldEdgeDistance(simPwmActiveValue) < SIM_ADC_EDGE_CPU_CLOCKS) {
+        simAdcEdgeConversionCount++;
+        if (simPwmActiveValue < simAdcEdgeLowestValue) {
+            simAdcEdgeLowestValue = simPwmActiveValue;
+        }
+    }
+
+    int32_t value = simAdcPin < SIM_PIN_COUNT ? simAnalogValues[simAdcPin] : 0;
+
+    if (simAdcNoise > 0) {
+        simAdcNoiseState = simAdcNoiseState * 1103515245 + 12345;
+        value += (int32_t) ((simAdcNoiseState >> 16) % (2 * simAdcNoise + 1)) - simAdcNoise;
+    }
+
+    simAdcResultValue = value < 0 ? 0 : (value > 1023 ? 1023 : value);
+}
+
+void simStep()
+{
+    // Both potentiometers sweep their range continuously, with periods that are not multiples of each other
+    if (simParameterStress) {
+        simAnalogValues[PIN_ANALOG_KEYER_SPEED] = simTriangle(simTickCount, SIM_STRESS_SPEED_PERIOD_TICKS);
+        simAnalogValues[PIN_ANALOG_KEYER_PITCH] = simTriangle(simTickCount, SIM_STRESS_PITCH_PERIOD_TICKS);
+    }
+
+    // At the idle rate the timer overflows once per HAL_PWM_IDLE_TICKS ticks
+    bool idle = simPwmIdle;
+    bool overflow = !idle || simTickCount + 1 - simPwmIdleBase >= HAL_PWM_IDLE_TICKS;
+    if (idle && overflow) {
+        simPwmIdleBase = simTickCount + 1;
+    }
+    bool interrupted = false;
+
+    if (overflow) {
+        simPwmActiveValue = simPwmValue;
+    }
+    if (simPwmTickInterruptEnabled && overflow) {
+        halPwmTickIsr();
+        halPreemptionPoint();
+        simTickInterruptCount++;
+        interrupted = true;
+    }
+    if (simPwmListener != NULL) {
+        simPwmListener(simPwmValue);
+    }
+
+    // A conversion takes 13.5 ADC clocks (3.4 ticks), so every fourth tick overflow triggers one.
+    // An idle rate overflow is longer than a conversion and triggers one every time.
+    if (simAdcEnabled && overflow && (idle || simTickCount % SIM_ADC_CONVERSION_TICKS == 0)) {
+        simAdcConvert();
+        halAdcIsr();
+        interrupted = true;
+    }
+
+    // The sidetone edge is recorded at the tick whose interrupt switched the PWM output
+    bool sidetoneOn = pwmIsEnabled();
+    if (sidetoneOn != simSidetoneOn) {
+        simSidetoneOn = sidetoneOn;
+        simSidetoneEventList.push_back({simTickCount, sidetoneOn});
+    }
+
+    simTickCount++;
+
+    if (simCpuSleeping && (interrupted || simUsbFrame() != simSleepFrame)) {
+        simCpuSleeping = false;
+    }
+    if (simCpuSleeping) {
+        simSleepTickCount++;
+    } else if (simTickCount % simLoopIntervalTicks == 0) {
+        loop();
+    }
+
+    const KeyerParameters *parameters = keyerParameters();
+    if (simControlEventList.empty() || simControlEventList.back().ditTicks != parameters->timing.ditDurationTicks
+            || simControlEventList.back().tuningWord != parameters->tuningWord) {
+        simControlEventList.push_back({simTickCount, parameters->timing.ditDurationTicks, parameters->tuningWord});
+    }
+
+    // Record the elements scheduled by the keyer
+    while (simKeyerQueueHead != keyerQueueHead) {
+        KeyerElement *element = &keyerQueueElements[simKeyerQueueHead & (KEYER_QUEUE_SIZE - 1)];
+        simScheduledElementList.push_back({element->startTicks - simFirmwareTickOffset,
+                element->endTicks - simFirmwareTickOffset, element->action});
+        simKeyerQueueHead++;
+    }
+}
+
+uint32_t simTicks()
+{
+    return simTickCount;
+}
+
+void simSkipTicks(uint32_t ticks)
+{
+    while (ticks > 0) {
+        uint32_t step = ticks < SIM_SKIP_LOOP_TICKS ? ticks : SIM_SKIP_LOOP_TICKS;
+        pwmInterruptCounter += step;
+        simFirmwareTickOffset += step;
+        ticks -= step;
+        loop();
+    }
+}
+
+uint32_t simFirmwareTicks()
+{
+    return simTickCount + simFirmwareTickOffset;
+}
+
+uint16_t simPwmOutput()
+{
+    return simPwmValue;
+}
+
+void simSetPwmListener(void (*listener)(uint16_t value))
+{
+    simPwmListener = listener;
+}
+
+uint32_t simMillisToTicks(double milliseconds)
+{
+    return (uint32_t) (milliseconds * simClockRate / 1000.0 + 0.5);
+}
+
+void simSetClockError(double ppm)
+{
+    simClockRate = SIM_TICK_RATE * (1.0 + ppm / 1000000.0);
+}
+
+double simTickRate()
+{
+    return simClockRate;
+}
+
+uint32_t simEepromWrites()
+{
+    return simEepromWriteCount;
+}
+
+uint32_t simEepromBlockedTicks()
+{
+    return simEepromBlockedTickCount;
+}
+
+const std::vector<SimHidEvent> &simHidEvents()
+{
+    return simHidEventList;
+}
+
+uint32_t simAdcConversions()
+{
+    return simAdcConversionCount;
+}
+
+uint32_t simAdcEdgeConversions()
+{
+    return simAdcEdgeConversionCount;
+}
+
+uint16_t simAdcEdgeLowestPwmValue()
+{
+    return simAdcEdgeLowestValue;
+}
+
+const std::vector<SimSidetoneEvent> &simSidetoneEvents()
+{
+    return simSidetoneEventList;
+}
+
+const std::vector<SimRawHidReport> &simRawHidReports()
+{
+    return simRawHidReportList;
+}
+
+const std::vector<SimControlEvent> &simControlEvents()
+{
+    return simControlEventList;
+}
+
+void simSetUsbPolling(bool polling)
+{
+    simUsbPolling = polling;
+}
+
+uint32_t simHidReports()
+{
+    return simHidReportCount;
+}
+
+uint32_t simHidRejectedReports()
+{
+    return simHidRejectedReportCount;
+}
+
+const std::vector<SimElement> &simScheduledElements()
+{
+    return simScheduledElementList;
+}
+
+const std::string &simSerialOutput()
+{
+    return simSerialText;
+}
+
+const std::string &simSerialWrites()
+{
+    return simSerialWriteText;
+}
+
+void simSerialInput(const char *data, size_t length)
+{
+    simSerialInputText.append(data, length);
+    // The USB endpoint interrupt wakes the CPU
+    simCpuSleeping = false;
+}
+
+const std::vector<uint32_t> &simSerialWriteTicks()
+{
+    return simSerialWriteTickList;
+}
+
+const std::vector<size_t> &simSerialWriteOffsets()
+{
+    return simSerialWriteOffsetList;
+}
+
+// USB start of frame count, one frame per millisecond
+static uint32_t simUsbFrame()
+{
+    return (uint32_t) (simTickCount * 1000.0 / simClockRate);
+}
+
+// Host-native HAL implementation
+
+void halPinModeInput(uint8_t pin)
+{
+}
+
+void halPinModeInputPullup(uint8_t pin)
+{
+}
+
+void halPinModeOutput(uint8_t pin)
+{
+}
+
+int halDigitalRead(uint8_t pin)
+{
+    return pin < SIM_PIN_COUNT ? simPins[pin].level : LOW;
+}
+
+uint8_t halPortRead(uint8_t port)
+{
+    return port <= HAL_PORT_F ? simPortLevels[port] : 0;
+}
+
+void halAdcInit()
+{
+    simAdcEnabled = true;
+}
+
+void halAdcSelectChannel(uint8_t pin)
+{
+    simAdcPin = pin;
+}
+
+uint16_t halAdcResult()
+{
+    return simAdcResultValue;
+}
+
+void halAttachPinChangeInterrupt(uint8_t pin, void (*handler)())
+{
+    if (pin < SIM_PIN_COUNT) {
+        simPins[pin].handler = handler;
+    }
+}
+
+void halKeyboardBegin()
+{
+}
+
+uint16_t halUsbFrameNumber()
+{
+    return simUsbFrame() & 0x7FF;
+}
+
+void halEepromRead(uint16_t address, void *data, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++) {
+        ((uint8_t *) data)[i] = address + i < SIM_EEPROM_SIZE ? simEepromData[address + i] : 0xFF;
+    }
+}
+
+bool halEepromReady()
+{
+    return (int32_t) (simTickCount - simEepromReadyTick) >= 0;
+}
+
+void halEepromWriteByte(uint16_t address, uint8_t value)
+{
+    // On the hardware the write would wait in the main loop for the previous one to complete
+    uint32_t startTick = simTickCount;
+    if (!halEepromReady()) {
+        simEepromBlockedTickCount += simEepromReadyTick - simTickCount;
+        startTick = simEepromReadyTick;
+    }
+    if (address >= SIM_EEPROM_SIZE || simEepromData[address] == value) {
+        return;
+    }
+    simEepromData[address] = value;
+    simEepromWriteCount++;
+    simEepromReadyTick = startTick + (uint32_t) (SIM_EEPROM_WRITE_MILLIS * simTickRate() / 1000.0 + 0.5);
+}
+
+// The host reads the interrupt endpoint once per frame, so only one report fits in a frame
+bool halHidReady()
+{
+    return simUsbPolling && (!simHidReportSent || simHidReportFrame != simUsbFrame());
+}
+
+// Records the key press and release events from the differences between consecutive keyboard reports
+static void simRecordKeyboardReport(const uint8_t *data)
+{
+    const HidKeyboardReport *report = (const HidKeyboardReport *) data;
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        uint8_t mask = 1 << bit;
+        if ((report->modifiers & mask) != (simKeyboardReport.modifiers & mask)) {
+            simHidEventList.push_back({simTickCount, (uint8_t) (HID_USAGE_MODIFIER_FIRST + bit),
+                    (report->modifiers & mask) != 0});
+        }
+    }
+    for (int i = 0; i < HID_KEYBOARD_REPORT_KEYS; i++) {
+        uint8_t key = simKeyboardReport.keys[i];
+        if (key != 0 && memchr(report->keys, key, HID_KEYBOARD_REPORT_KEYS) == NULL) {
+            simHidEventList.push_back({simTickCount, key, false});
+        }
+    }
+    for (int i = 0; i < HID_KEYBOARD_REPORT_KEYS; i++) {
+        uint8_t key = report->keys[i];
+        if (key != 0 && memchr(simKeyboardReport.keys, key, HID_KEYBOARD_REPORT_KEYS) == NULL) {
+            simHidEventList.push_back({simTickCount, key, true});
+        }
+    }
+
+    simKeyboardReport = *report;
+}
+
+void halHidSendReport(uint8_t id, const uint8_t *data, uint8_t length)
+{
+    if (!halHidReady()) {
+        // On the hardware the send would wait for the host to poll the endpoint
+        simHidRejectedReportCount++;
+    }
+    simHidReportSent = true;
+    simHidReportFrame = simUsbFrame();
+    simHidReportCount++;
+
+    if (id == HID_KEYBOARD_REPORT_ID && length == sizeof(HidKeyboardReport)) {
+        simRecordKeyboardReport(data);
+    } else if (id == RAW_HID_REPORT_ID) {
+        simRawHidReportList.push_back({simFirmwareTicks(), simTickCount, std::vector<uint8_t>(data, data + length)});
+    }
+}
+
+void halSerialBegin(unsigned long baud)
+{
+}
+
+bool halSerialConnected()
+{
+    return true;
+}
+
+void halSerialPrintln(const char *text)
+{
+    simSerialText += text;
+    simSerialText += "\r\n";
+}
+
+int halSerialAvailable()
+{
+    return (int) (simSerialInputText.size() - simSerialInputOffset);
+}
+
+int halSerialPeek()
+{
+    if (simSerialInputOffset == simSerialInputText.size()) {
+        return -1;
+    }
+    return (uint8_t) simSerialInputText[simSerialInputOffset];
+}
+
+int halSerialRead()
+{
+    if (simSerialInputOffset == simSerialInputText.size()) {
+        return -1;
+    }
+    return (uint8_t) simSerialInputText[simSerialInputOffset++];
+}
+
+int halSerialAvailableForWrite()
+{
+    if (simSerialPacketPending && simTickCount - simSerialPacketTick < SIM_SERIAL_FRAME_TICKS) {
+        return 0;
+    }
+
+    simSerialPacketPending = false;
+    return SIM_SERIAL_PACKET_SIZE;
+}
+
+void halSerialWrite(const uint8_t *data, size_t length)
+{
+    simSerialWriteTickList.push_back(simFirmwareTicks());
+    simSerialWriteOffsetList.push_back(simSerialText.size());
+    simSerialText.append((const char *) data, length);
+    simSerialWriteText.append((const char *) data, length);
+    simSerialPacketTick = simTickCount;
+    simSerialPacketPending = true;
+}
+
+void simSerialNoise(const uint8_t *data, size_t length)
+{
+    simSerialText.append((const char *) data, length);
+}
+
+void halPwmInit()
+{
+}
+
+void halPwmWrite(uint8_t value)
+{
+    simPwmValue = value;
+}
+
+void halPwmWriteHighResolution(uint16_t value)
+{
+    simPwmValue = value;
+}
+
+void halPwmTickInterruptSetEnabled(bool enabled)
+{
+    simPwmTickInterruptEnabled = enabled;
+}
+
+void halPwmTickSetIdle(bool idle)
+{
+    simPwmIdle = idle;
+    if (idle) {
+        // Called by the tick interrupt, the idle rate starts with the next timer period
+        simPwmIdleBase = simTickCount + 1;
+        simIdleEntryCount++;
+    } else {
+        simIdleExitTickList.push_back(simTickCount);
+    }
+}
+
+uint8_t halPwmTickIdleElapsed()
+{
+    return (uint8_t) (simTickCount - simPwmIdleBase);
+}
+
+void halCpuSleep()
+{
+    simCpuSleeping = true;
+    simSleepFrame = simUsbFrame();
+}
+
+uint32_t simIdleEntries()
+{
+    return simIdleEntryCount;
+}
+
+const std::vector<uint32_t> &simIdleExitTicks()
+{
+    return simIdleExitTickList;
+}
+
+uint32_t simSleepTicks()
+{
+    return simSleepTickCount;
+}
+
+uint32_t simTickInterrupts()
+{
+    return simTickInterruptCount;
+}
+
+void halCycleCounterInit()
+{
+}
+
+uint16_t halCycleCounterRead()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint16_t) now.tv_nsec;
+}
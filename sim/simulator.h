@@ -0,0 +1,208 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Deterministic tick-driven simulator of the morse key adapter hardware. The simulator implements
+ * the host-native HAL (see src/hal_native.h) and runs the unchanged firmware code: every simulated
+ * tick calls the PWM timer tick handler and loop() is called every loopIntervalTicks ticks.
+ *
+ * The firmware keeps its state in global variables, so a single simulation can be run per process.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_SIMULATOR_H
+#define WRC_MORSE_KEY_ADAPTER_SIMULATOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "hal.h"
+#include "dds_sine_generator.h"
+
+// Measured REFCLK of the PWM timer tick, see src/dds_sine_generator.cpp
+#define SIM_TICK_RATE 31376.6
+
+#define SIM_PIN_COUNT 32
+
+// EEPROM of the ATmega32U4, erased at the start of the simulation, and the time a byte write takes
+#define SIM_EEPROM_SIZE 1024
+#define SIM_EEPROM_WRITE_MILLIS 3.4
+
+// Ticks per auto-triggered ADC conversion at the ADC clock prescaler of 128
+#define SIM_ADC_CONVERSION_TICKS 4
+
+// TOP of the PWM timer the compare values are relative to, the timer clock is 1 or 3 CPU clocks
+#if PWM_HIGH_RESOLUTION == true
+#define SIM_PWM_TOP PWM_HIGH_RESOLUTION_TOP
+#else
+#define SIM_PWM_TOP 255
+#endif
+#define SIM_PWM_TIMER_CLOCKS_PER_CPU_CLOCK (SIM_PWM_TOP / 255)
+
+// An auto-triggered conversion samples 2 ADC clocks and 3 synchronization clocks after the Timer4 overflow
+// at the BOTTOM of the counter, in CPU clocks. A sample-and-hold closer than SIM_ADC_EDGE_CPU_CLOCKS (1 us)
+// to an edge of the PWM output is counted.
+#define SIM_ADC_HOLD_CPU_CLOCKS (2 * 128 + 3)
+#define SIM_ADC_EDGE_CPU_CLOCKS 16
+
+// The CDC serial port sends at most one bulk packet per 1 ms USB frame
+#define SIM_SERIAL_PACKET_SIZE 64
+#define SIM_SERIAL_FRAME_TICKS 31
+
+// The main loop runs once per this many ticks of a skipped period (33 s)
+#define SIM_SKIP_LOOP_TICKS 0x100000
+
+// Potentiometer sweep periods of the parameter stress mode, coprime so that all speed and pitch change combinations occur
+#define SIM_STRESS_SPEED_PERIOD_TICKS 997
+#define SIM_STRESS_PITCH_PERIOD_TICKS 1013
+
+// Key press or release seen by the host, the key is the HID usage (see hidUsageForKey())
+struct SimHidEvent {
+    uint32_t tick;
+    uint8_t key;
+    bool pressed;
+};
+
+struct SimElement {
+    uint32_t startTicks;
+    uint32_t endTicks;
+    char action;
+};
+
+// Raw HID report, the firmware tick it was sent at and the simulator tick, which does not include the skipped periods
+struct SimRawHidReport {
+    uint32_t tick;
+    uint32_t simTick;
+    std::vector<uint8_t> data;
+};
+
+// Keyer speed or pitch change, given as the dit duration and the DDS tuning word
+struct SimControlEvent {
+    uint32_t tick;
+    uint32_t ditTicks;
+    uint32_t tuningWord;
+};
+
+struct SimSidetoneEvent {
+    uint32_t tick;
+    bool on;
+};
+
+void simInit(uint32_t loopIntervalTicks);
+
+void simSetDigital(uint8_t pin, int level);
+
+void simSetAnalog(uint8_t pin, uint16_t value);
+
+// Adds uniform noise of +-amplitude steps to the ADC conversions
+void simSetAdcNoise(uint16_t amplitude);
+
+// ADC conversions, the conversions sampled closer than SIM_ADC_EDGE_CPU_CLOCKS to an edge of the PWM output
+// and the lowest PWM compare value of them (UINT16_MAX if none)
+uint32_t simAdcConversions();
+
+uint32_t simAdcEdgeConversions();
+
+uint16_t simAdcEdgeLowestPwmValue();
+
+void simStep();
+
+// Sweeps the speed and pitch potentiometers continuously and checks the keyer parameter block at every
+// tick interrupt and every preemption point of the main loop for a mix of two updates (torn snapshot)
+void simSetParameterStress(bool stress);
+
+uint32_t simParameterUpdates();
+
+uint32_t simParameterChecks();
+
+uint32_t simParameterTornSnapshots();
+
+uint32_t simTicks();
+
+// Advances the firmware tick counter without simulating the ticks, like a long idle period.
+// The simulator ticks are not advanced, the firmware ticks are offset from them from now on.
+void simSkipTicks(uint32_t ticks);
+
+// Firmware tick counter value at the current simulator tick
+uint32_t simFirmwareTicks();
+
+uint16_t simPwmOutput();
+
+// Called after the tick interrupt of every simulated tick with the PWM compare value of the next timer period,
+// NULL to stop
+void simSetPwmListener(void (*listener)(uint16_t value));
+
+uint32_t simMillisToTicks(double milliseconds);
+
+// Makes the tick of the simulated adapter run fast by the given error relative to SIM_TICK_RATE, like a board with
+// an inaccurate resonator. Script times in milliseconds and the USB frames of the host follow the real time.
+// Set before the script is read.
+void simSetClockError(double ppm);
+
+// Ticks per second of real time
+double simTickRate();
+
+// EEPROM bytes written by the firmware
+uint32_t simEepromWrites();
+
+// Ticks the main loop would have waited for the EEPROM, that is, bytes written while a write was in progress
+uint32_t simEepromBlockedTicks();
+
+const std::vector<SimHidEvent> &simHidEvents();
+
+const std::vector<SimSidetoneEvent> &simSidetoneEvents();
+
+const std::vector<SimRawHidReport> &simRawHidReports();
+
+const std::vector<SimControlEvent> &simControlEvents();
+
+// Stops and resumes the host polling of the HID endpoint, like a busy or suspended host
+void simSetUsbPolling(bool polling);
+
+// Number of HID reports sent and the number of them sent while the endpoint was busy
+uint32_t simHidReports();
+
+uint32_t simHidRejectedReports();
+
+const std::vector<SimElement> &simScheduledElements();
+
+const std::string &simSerialOutput();
+
+// Data written to the serial port with halSerialWrite(), without the text lines
+const std::string &simSerialWrites();
+
+// Queues bytes to be read by the firmware from the serial port
+void simSerialInput(const char *data, size_t length);
+
+// Adds bytes to the serial output received by the host without the firmware writing them, like line noise
+void simSerialNoise(const uint8_t *data, size_t length);
+
+// Firmware tick and output offset of each binary serial write
+const std::vector<uint32_t> &simSerialWriteTicks();
+
+const std::vector<size_t> &simSerialWriteOffsets();
+
+// Idle mode entries and the simulator ticks at which the tick switched back to the full rate
+uint32_t simIdleEntries();
+
+const std::vector<uint32_t> &simIdleExitTicks();
+
+// Ticks the CPU slept through without an interrupt, and the ticks with a tick interrupt
+uint32_t simSleepTicks();
+
+uint32_t simTickInterrupts();
+
+#endif
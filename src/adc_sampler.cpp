@@ -0,0 +1,102 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adc_sampler.h"
+#include "pins.h"
+#include "keyer_config.h"
+
+struct AdcSamplerChannel {
+    uint8_t pin;
+    // Changes smaller than or equal to this many 10-bit steps are ignored
+    uint8_t hysteresis;
+};
+
+const AdcSamplerChannel adcSamplerChannels[ADC_SAMPLER_CHANNEL_COUNT] = {
+    {PIN_ANALOG_KEYER_SPEED, KEYER_SPEED_WPM_MINIMUM_DELTA},
+    {PIN_ANALOG_KEYER_PITCH, KEYER_PITCH_MINIMUM_DELTA},
+};
+
+static_assert((1 << ADC_SAMPLER_OVERSAMPLING_SHIFT) == ADC_SAMPLER_OVERSAMPLING,
+        "ADC_SAMPLER_OVERSAMPLING_SHIFT must match ADC_SAMPLER_OVERSAMPLING");
+static_assert(ADC_SAMPLER_EXTRA_BITS <= ADC_SAMPLER_OVERSAMPLING_SHIFT,
+        "Oversampling cannot add more bits than the oversampling factor allows");
+
+uint8_t adcSamplerChannel = 0;
+uint8_t adcSamplerSampleCount = 0;
+bool adcSamplerPrimed = false;
+uint16_t adcSamplerSums[ADC_SAMPLER_CHANNEL_COUNT];
+
+// Published values in extended resolution, the sequence number changes on every update
+volatile uint16_t adcSamplerValues[ADC_SAMPLER_CHANNEL_COUNT];
+volatile uint8_t adcSamplerSequence = 0;
+
+void adcSamplerInit()
+{
+    halAdcSelectChannel(adcSamplerChannels[adcSamplerChannel].pin);
+    halAdcInit();
+}
+
+HAL_ADC_ISR
+{
+    uint8_t channel = adcSamplerChannel;
+    uint16_t sample = halAdcResult();
+    adcSamplerSums[channel] += sample;
+
+    if (!adcSamplerPrimed) {
+        // The first sample of each channel is published right away, so the values are valid soon after startup
+        adcSamplerValues[channel] = sample << ADC_SAMPLER_EXTRA_BITS;
+        adcSamplerSequence++;
+        adcSamplerPrimed = channel == ADC_SAMPLER_CHANNEL_COUNT - 1;
+    }
+
+    // The next conversion starts at the next Timer4 overflow, so the channel can be switched here
+    adcSamplerChannel = channel + 1 < ADC_SAMPLER_CHANNEL_COUNT ? channel + 1 : 0;
+    halAdcSelectChannel(adcSamplerChannels[adcSamplerChannel].pin);
+
+    if (adcSamplerChannel != 0 || ++adcSamplerSampleCount < ADC_SAMPLER_OVERSAMPLING) {
+        return;
+    }
+    adcSamplerSampleCount = 0;
+
+    for (uint8_t i = 0; i < ADC_SAMPLER_CHANNEL_COUNT; i++) {
+        uint16_t value = adcSamplerSums[i] >> (ADC_SAMPLER_OVERSAMPLING_SHIFT - ADC_SAMPLER_EXTRA_BITS);
+        uint16_t band = (adcSamplerChannels[i].hysteresis << ADC_SAMPLER_EXTRA_BITS)
+                + (1 << (ADC_SAMPLER_EXTRA_BITS - 1));
+        uint16_t published = adcSamplerValues[i];
+
+        if (value > published + band || value + band < published) {
+            adcSamplerValues[i] = value;
+            adcSamplerSequence++;
+        }
+        adcSamplerSums[i] = 0;
+    }
+}
+
+uint16_t adcSamplerRead(uint8_t channel)
+{
+    // The 16-bit value is not read atomically, read again if the interrupt updated the values meanwhile
+    uint8_t sequence;
+    uint16_t value;
+    do {
+        sequence = adcSamplerSequence;
+        value = adcSamplerValues[channel];
+    } while (sequence != adcSamplerSequence);
+
+    // Round to the ADC resolution
+    return (value + (1 << (ADC_SAMPLER_EXTRA_BITS - 1))) >> ADC_SAMPLER_EXTRA_BITS;
+}
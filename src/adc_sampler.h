@@ -0,0 +1,53 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Background sampling of the speed and pitch potentiometers. The ADC conversions are auto-triggered
+ * by the Timer4 overflow, which is at the BOTTOM of the phase-correct PWM counter, so the sample-and-hold
+ * always happens at the same point of the PWM period: 2 ADC clocks and 3 CPU clocks (259 CPU clocks) after
+ * the overflow, with the counter counting down from TOP at 251 of 255 (753 of 765 in high resolution mode).
+ * The PWM output switches where the counter matches the compare value, so only compare values close to TOP,
+ * the peaks of the full amplitude sidetone, switch the output within 1 us of the sample-and-hold. The envelope
+ * scales the sine towards 0, so the output edges move towards BOTTOM and away from it at low amplitude and
+ * the output does not switch at all when the sidetone is off (see --sidetone-quality of the simulator).
+ * This way the potentiometers can be read while the sidetone is on.
+ *
+ * The ADC interrupt alternates between the channels and sums ADC_SAMPLER_OVERSAMPLING samples of
+ * each channel. The sum is decimated to ADC_SAMPLER_EXTRA_BITS bits more than the ADC resolution and
+ * a new value is published only when it moves outside the hysteresis band of the channel,
+ * so adcSamplerRead() returns a stable value without any conversion work in the main loop.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_ADC_SAMPLER_H
+#define WRC_MORSE_KEY_ADAPTER_ADC_SAMPLER_H
+
+#include "hal.h"
+
+#define ADC_SAMPLER_CHANNEL_SPEED 0
+#define ADC_SAMPLER_CHANNEL_PITCH 1
+#define ADC_SAMPLER_CHANNEL_COUNT 2
+
+// Samples summed per published value, must be a power of two and the sum of 10-bit samples must fit in 16 bits
+#define ADC_SAMPLER_OVERSAMPLING 64
+#define ADC_SAMPLER_OVERSAMPLING_SHIFT 6
+#define ADC_SAMPLER_EXTRA_BITS 3
+
+void adcSamplerInit();
+
+// Returns the filtered 10-bit value of the channel
+uint16_t adcSamplerRead(uint8_t channel);
+
+#endif
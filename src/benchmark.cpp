@@ -0,0 +1,473 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "hal.h"
+#include "benchmark.h"
+#include "pins.h"
+#include "keyer_config.h"
+#include "keyer_tables.h"
+#include "dds_sine_generator.h"
+#include "keyer_modes.h"
+#include "keyer_queue.h"
+#include "text_keyer.h"
+#include "morse_code.h"
+#include "cw_decoder.h"
+#include "raw_hid_format.h"
+#include "trace_recorder.h"
+#include "timebase_calibration.h"
+
+// About 40000 CPU cycles, fits in the 16-bit cycle counter
+#define BENCHMARK_TICK_WORKLOAD_ITERATIONS 4000
+#define BENCHMARK_TICK_ROUNDS 16
+
+// Start of the element queued for the tick interrupt benchmark, after the end of the benchmark
+#define BENCHMARK_PENDING_ELEMENT_TICKS 0x40000000UL
+
+// Every character of the Morse table
+#define BENCHMARK_TEXT "PARIS CQ DE OH2XYZ 0123456789 .,?'!/()&:;=+-_\"$@ ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+
+#if PWM_HIGH_RESOLUTION == true
+#define BENCHMARK_PWM_RESOLUTION ", high resolution"
+#else
+#define BENCHMARK_PWM_RESOLUTION ""
+#endif
+
+struct BenchmarkResult {
+    uint32_t total;
+    uint16_t max;
+    uint16_t count;
+};
+
+static volatile uint16_t benchmarkInput;
+static volatile uint32_t benchmarkSink[4];
+
+static void benchmarkAdd(BenchmarkResult *result, uint16_t start)
+{
+    uint16_t elapsed = halCycleCounterRead() - start;
+    result->total += elapsed;
+    if (elapsed > result->max) {
+        result->max = elapsed;
+    }
+    result->count++;
+}
+
+static void benchmarkPrint(const char *name, BenchmarkResult *result)
+{
+    char line[80];
+    snprintf(line, sizeof(line), "%s: avg %lu max %u " HAL_CYCLE_COUNTER_UNIT, name,
+            (unsigned long) (result->count > 0 ? result->total / result->count : 0), result->max);
+    halSerialPrintln(line);
+}
+
+// The double-precision speed path used before the timing tables, kept as the reference
+static void benchmarkSpeedReference(uint16_t value)
+{
+    int speedWpm = KEYER_SPEED_WPM_MINIMUM +
+                   ((KEYER_SPEED_WPM_MAXIMUM - KEYER_SPEED_WPM_MINIMUM) / KEYER_SPEED_WPM_MAXIMUM_ANALOG_VALUE) *
+                   (double) value;
+    if (speedWpm > KEYER_SPEED_WPM_MAXIMUM) {
+        speedWpm = KEYER_SPEED_WPM_MAXIMUM;
+    }
+
+    double unitDurationMillis = (60.0 * 20.0) / (double) speedWpm;
+
+    benchmarkSink[0] = millisToPwmTicks(unitDurationMillis);
+    benchmarkSink[1] = millisToPwmTicks(unitDurationMillis * 3.0);
+    benchmarkSink[2] = millisToPwmTicks(unitDurationMillis);
+    benchmarkSink[3] = millisToPwmTicks(unitDurationMillis / 10.0);
+}
+
+static void benchmarkSpeedTable(uint16_t value)
+{
+    KeyerTiming timing;
+    keyerTimingForSpeedWpm(keyerSpeedWpmForAnalogValue(value), &timing);
+
+    benchmarkSink[0] = timing.ditDurationTicks;
+    benchmarkSink[1] = timing.dahDurationTicks;
+    benchmarkSink[2] = timing.pauseDurationTicks;
+    benchmarkSink[3] = timing.scheduleAheadTicks;
+}
+
+// The double-precision pitch path used before the tuning word table, kept as the reference
+static void benchmarkPitchReference(uint16_t value)
+{
+    double pitch =
+            KEYER_PITCH_MINIMUM +
+            ((KEYER_PITCH_MAXIMUM - KEYER_PITCH_MINIMUM) / KEYER_PITCH_MAXIMUM_ANALOG_VALUE) * (double) value;
+    if (pitch > KEYER_PITCH_MAXIMUM) {
+        pitch = KEYER_PITCH_MAXIMUM;
+    }
+
+    benchmarkSink[0] = pow(2, 32) * pitch / REFCLK;
+}
+
+static void benchmarkPitchTable(uint16_t value)
+{
+    benchmarkSink[0] = keyerTuningWordForAnalogValue(value);
+}
+
+static void benchmarkTimingTables()
+{
+    BenchmarkResult speedReference = {0, 0, 0};
+    BenchmarkResult speedTable = {0, 0, 0};
+    BenchmarkResult pitchReference = {0, 0, 0};
+    BenchmarkResult pitchTable = {0, 0, 0};
+    uint16_t mismatches = 0;
+
+    for (uint16_t value = 0; value < KEYER_ANALOG_TABLE_SIZE; value++) {
+        benchmarkInput = value;
+
+        uint16_t start = halCycleCounterRead();
+        benchmarkSpeedReference(benchmarkInput);
+        benchmarkAdd(&speedReference, start);
+        uint32_t expected[4] = {benchmarkSink[0], benchmarkSink[1], benchmarkSink[2], benchmarkSink[3]};
+
+        start = halCycleCounterRead();
+        benchmarkSpeedTable(benchmarkInput);
+        benchmarkAdd(&speedTable, start);
+        for (int i = 0; i < 4; i++) {
+            if (benchmarkSink[i] != expected[i]) {
+                mismatches++;
+            }
+        }
+
+        start = halCycleCounterRead();
+        benchmarkPitchReference(benchmarkInput);
+        benchmarkAdd(&pitchReference, start);
+        expected[0] = benchmarkSink[0];
+
+        start = halCycleCounterRead();
+        benchmarkPitchTable(benchmarkInput);
+        benchmarkAdd(&pitchTable, start);
+        if (benchmarkSink[0] != expected[0]) {
+            mismatches++;
+        }
+    }
+
+    benchmarkPrint("Speed change, double", &speedReference);
+    benchmarkPrint("Speed change, table", &speedTable);
+    benchmarkPrint("Pitch change, double", &pitchReference);
+    benchmarkPrint("Pitch change, table", &pitchTable);
+
+    char line[48];
+    snprintf(line, sizeof(line), "Table mismatches: %u", mismatches);
+    halSerialPrintln(line);
+}
+
+#if TIMEBASE_CALIBRATION_ENABLED == true
+// The table lookups corrected by the timebase calibration, as done on a potentiometer change
+static void benchmarkTimebaseCalibration()
+{
+    BenchmarkResult speed = {0, 0, 0};
+    BenchmarkResult pitch = {0, 0, 0};
+    KeyerTiming timing;
+
+    timebaseCalibrationInit();
+    for (uint16_t value = 0; value < KEYER_ANALOG_TABLE_SIZE; value++) {
+        benchmarkInput = value;
+
+        uint16_t start = halCycleCounterRead();
+        keyerTimingForSpeedWpm(keyerSpeedWpmForAnalogValue(benchmarkInput), &timing);
+        timebaseCalibrateTiming(&timing);
+        benchmarkSink[0] = timing.ditDurationTicks;
+        benchmarkAdd(&speed, start);
+
+        start = halCycleCounterRead();
+        benchmarkSink[0] = timebaseCalibrateTuningWord(keyerTuningWordForAnalogValue(benchmarkInput));
+        benchmarkAdd(&pitch, start);
+    }
+
+    benchmarkPrint("Speed change, calibrated", &speed);
+    benchmarkPrint("Pitch change, calibrated", &pitch);
+}
+#endif
+
+#ifdef ARDUINO
+// Runs a fixed workload with the tick interrupt disabled and enabled: the difference is the time
+// spent in the interrupt, including the interrupt entry, prologue and epilogue
+static uint16_t benchmarkTickWorkload(bool interruptEnabled, uint32_t *ticks)
+{
+    halPwmTickInterruptSetEnabled(interruptEnabled);
+
+    uint32_t startTicks = getPwmTicks();
+    uint16_t start = halCycleCounterRead();
+    for (volatile uint16_t i = 0; i < BENCHMARK_TICK_WORKLOAD_ITERATIONS; i++) {
+    }
+    uint16_t elapsed = halCycleCounterRead() - start;
+    *ticks = getPwmTicks() - startTicks;
+
+    halPwmTickInterruptSetEnabled(true);
+
+    return elapsed;
+}
+#endif
+
+// Measures the tick interrupt right after the sidetone is switched, during the envelope ramp,
+// or after the ramp has ended
+static void benchmarkTickInterruptRounds(const char *name, bool ramping)
+{
+    BenchmarkResult result = {0, 0, 0};
+
+    for (uint8_t round = 0; round < BENCHMARK_TICK_ROUNDS; round++) {
+        pwmSetEnabled(round & 1);
+        pwmRefillSamples();
+        while (!ramping && pwmIsEnvelopeRamping()) {
+#ifndef ARDUINO
+            halPwmTickIsr();
+#endif
+            pwmRefillSamples();
+        }
+
+#ifdef ARDUINO
+        uint32_t ticks;
+        uint16_t withoutInterrupt = benchmarkTickWorkload(false, &ticks);
+        uint16_t withInterrupt = benchmarkTickWorkload(true, &ticks);
+        if (ticks == 0 || withInterrupt < withoutInterrupt) {
+            continue;
+        }
+        uint16_t elapsed = (withInterrupt - withoutInterrupt) / ticks;
+#else
+        // The simulator calls the tick interrupt handler synchronously
+        uint16_t start = halCycleCounterRead();
+        for (uint16_t i = 0; i < PWM_SAMPLE_RING_SIZE / 2; i++) {
+            halPwmTickIsr();
+        }
+        uint16_t elapsed = (uint16_t) (halCycleCounterRead() - start) / (PWM_SAMPLE_RING_SIZE / 2);
+#endif
+
+        result.total += elapsed;
+        if (elapsed > result.max) {
+            result.max = elapsed;
+        }
+        result.count++;
+    }
+    pwmSetEnabled(false);
+
+    benchmarkPrint(name, &result);
+}
+
+static void benchmarkTickInterrupt()
+{
+    // The longest ramp keeps the interrupt in the ramp for the whole workload
+    pwmSetEnvelopeDuration(PWM_ENVELOPE_MILLIS_MAXIMUM);
+
+    benchmarkTickInterruptRounds(PWM_SAMPLE_RING == true ? "Tick interrupt, sample ring" BENCHMARK_PWM_RESOLUTION
+            : "Tick interrupt, direct" BENCHMARK_PWM_RESOLUTION, false);
+    benchmarkTickInterruptRounds(PWM_SAMPLE_RING == true ? "Tick interrupt, sample ring" BENCHMARK_PWM_RESOLUTION
+            ", envelope ramp" : "Tick interrupt, direct" BENCHMARK_PWM_RESOLUTION ", envelope ramp", true);
+
+    pwmSetEnvelopeDuration(PWM_ENVELOPE_MILLIS);
+
+    // With an element in the keyer queue the interrupt compares the tick with its start on every tick. The element
+    // starts long after the benchmark, so it is never keyed and is removed again afterwards.
+    uint32_t startTicks = getPwmTicks() + BENCHMARK_PENDING_ELEMENT_TICKS;
+    keyerQueuePush(startTicks, startTicks + 1, KEYER_ACTION_DIT);
+    benchmarkTickInterruptRounds(PWM_SAMPLE_RING == true ? "Tick interrupt, sample ring" BENCHMARK_PWM_RESOLUTION
+            ", element pending" : "Tick interrupt, direct" BENCHMARK_PWM_RESOLUTION ", element pending", false);
+    keyerQueuePop();
+
+    BenchmarkResult refill = {0, 0, 0};
+    for (uint8_t round = 0; round < BENCHMARK_TICK_ROUNDS; round++) {
+        uint16_t start = halCycleCounterRead();
+        pwmRefillSamples();
+        benchmarkAdd(&refill, start);
+    }
+    benchmarkPrint("Sample ring refill", &refill);
+}
+
+// Reads the key pin as the pin change handlers do and the mode switches as the main loop does, each through
+// digitalRead() as before the pin map and directly from the port
+static void benchmarkPinReads()
+{
+    BenchmarkResult pinReference = {0, 0, 0};
+    BenchmarkResult pinDirect = {0, 0, 0};
+    BenchmarkResult switchesReference = {0, 0, 0};
+    BenchmarkResult switchesPort = {0, 0, 0};
+    uint16_t mismatches = 0;
+
+    for (uint8_t round = 0; round < BENCHMARK_TICK_ROUNDS; round++) {
+        uint16_t start = halCycleCounterRead();
+        benchmarkSink[0] = halDigitalRead(PIN_KEY_TIP);
+        benchmarkAdd(&pinReference, start);
+        uint32_t expected = benchmarkSink[0];
+
+        start = halCycleCounterRead();
+        benchmarkSink[0] = pinRead<PIN_KEY_TIP>();
+        benchmarkAdd(&pinDirect, start);
+        if (benchmarkSink[0] != expected) {
+            mismatches++;
+        }
+
+        start = halCycleCounterRead();
+        benchmarkSink[0] = halDigitalRead(PIN_KEY_AUTOMATIC_MODE);
+        benchmarkSink[1] = halDigitalRead(PIN_KEY_IAMBIC);
+        benchmarkSink[2] = halDigitalRead(PIN_KEY_INVERTED);
+        benchmarkAdd(&switchesReference, start);
+        uint32_t expectedSwitches[3] = {benchmarkSink[0], benchmarkSink[1], benchmarkSink[2]};
+
+        start = halCycleCounterRead();
+        uint8_t levels = halPortRead(PIN_SWITCH_PORT);
+        benchmarkSink[0] = pinLevel(PIN_KEY_AUTOMATIC_MODE, levels);
+        benchmarkSink[1] = pinLevel(PIN_KEY_IAMBIC, levels);
+        benchmarkSink[2] = pinLevel(PIN_KEY_INVERTED, levels);
+        benchmarkAdd(&switchesPort, start);
+        for (int i = 0; i < 3; i++) {
+            if (benchmarkSink[i] != expectedSwitches[i]) {
+                mismatches++;
+            }
+        }
+    }
+
+    benchmarkPrint("Pin read, digitalRead", &pinReference);
+    benchmarkPrint("Pin read, port", &pinDirect);
+    benchmarkPrint("Switch read, digitalRead", &switchesReference);
+    benchmarkPrint("Switch read, port snapshot", &switchesPort);
+
+    char line[48];
+    snprintf(line, sizeof(line), "Pin read mismatches: %u", mismatches);
+    halSerialPrintln(line);
+}
+
+// Buffers the text and takes all of its elements, which is the work of the main loop per keyed character
+static void benchmarkTextEncode()
+{
+    BenchmarkResult encode = {0, 0, 0};
+    const char *text = BENCHMARK_TEXT;
+    uint16_t elements = 0;
+
+    textKeyerCancel();
+    for (uint8_t i = 0; text[i] != '\0'; i++) {
+        uint16_t start = halCycleCounterRead();
+        textKeyerWrite(text[i]);
+        uint8_t spaceUnits;
+        while (textKeyerPeek(&spaceUnits) != KEYER_ACTION_NONE) {
+            textKeyerPop();
+            elements++;
+        }
+        benchmarkAdd(&encode, start);
+    }
+
+    benchmarkPrint("Text encode, per character", &encode);
+
+    char line[48];
+    snprintf(line, sizeof(line), "Text elements: %u", elements);
+    halSerialPrintln(line);
+}
+
+// Compares the decoded characters with the text from the given position
+static uint16_t benchmarkDecoderCompare(const char *text, uint8_t *position)
+{
+    uint16_t mismatches = 0;
+    uint8_t character;
+    while (cwDecoderRead(&character)) {
+        if (text[*position] == '\0') {
+            mismatches++;
+        } else if (character != text[(*position)++]) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// Decodes the benchmark text keyed with exact timing, each edge is measured including the character lookup
+// at the first edge after a character
+static void benchmarkDecoderEdge()
+{
+    BenchmarkResult edge = {0, 0, 0};
+    const char *text = BENCHMARK_TEXT;
+    KeyerTiming timing;
+    keyerTimingForSpeedWpm(KEYER_SPEED_WPM_DEFAULT, &timing);
+
+    cwDecoderReset(timing.ditDurationTicks);
+    uint32_t ticks = 0;
+    uint8_t decoded = 0;
+    uint16_t mismatches = 0;
+    for (uint8_t i = 0; text[i] != '\0'; i++) {
+        uint8_t code = morseCodeForCharacter(text[i]);
+        ticks += 2 * timing.ditDurationTicks;
+        if (code == MORSE_CODE_WORD_SPACE) {
+            ticks += 4 * timing.ditDurationTicks;
+        }
+        for (; code > MORSE_CODE_WORD_SPACE; code >>= 1) {
+            uint16_t start = halCycleCounterRead();
+            cwDecoderRecordEdge(true, ticks);
+            benchmarkAdd(&edge, start);
+            ticks += (code & 1) ? timing.dahDurationTicks : timing.ditDurationTicks;
+
+            start = halCycleCounterRead();
+            cwDecoderRecordEdge(false, ticks);
+            benchmarkAdd(&edge, start);
+            ticks += timing.pauseDurationTicks;
+        }
+
+        // The previous character has been decoded at the first edge of this one
+        mismatches += benchmarkDecoderCompare(text, &decoded);
+    }
+
+    // A character space ends the last character
+    cwDecoderUpdate(ticks + 2 * timing.ditDurationTicks);
+    mismatches += benchmarkDecoderCompare(text, &decoded);
+    if (text[decoded] != '\0') {
+        mismatches++;
+    }
+    cwDecoderReset(timing.ditDurationTicks);
+
+    benchmarkPrint("Decoder edge", &edge);
+
+    char line[48];
+    snprintf(line, sizeof(line), "Decoder mismatches: %u", mismatches);
+    halSerialPrintln(line);
+}
+
+// Records output edges of dits at 25 WPM, twice the ring size to include the records folded into the start state
+static void benchmarkTraceRecord()
+{
+    BenchmarkResult record = {0, 0, 0};
+    KeyerTiming timing;
+    keyerTimingForSpeedWpm(KEYER_SPEED_WPM_DEFAULT, &timing);
+
+    uint32_t ticks = 0;
+    traceRecorderInit(ticks);
+    for (uint16_t i = 0; i < 2 * TRACE_RECORDER_SIZE; i++) {
+        ticks += timing.ditDurationTicks;
+        uint16_t start = halCycleCounterRead();
+        traceRecord(TRACE_EVENT_OUTPUT | RAW_HID_OUTPUT_KEY | ((i & 1) ? 0 : TRACE_ON), ticks);
+        benchmarkAdd(&record, start);
+    }
+
+    benchmarkPrint("Trace record", &record);
+}
+
+void benchmarkRun()
+{
+    halCycleCounterInit();
+
+    benchmarkTimingTables();
+#if TIMEBASE_CALIBRATION_ENABLED == true
+    benchmarkTimebaseCalibration();
+#endif
+    benchmarkPinReads();
+    benchmarkTextEncode();
+    benchmarkDecoderEdge();
+    benchmarkTraceRecord();
+
+    pwmInit(KEYER_PITCH_DEFAULT);
+    benchmarkTickInterrupt();
+}
@@ -0,0 +1,30 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Benchmarks measuring hot path costs with the HAL cycle counter. The results are printed
+ * to the serial port: in CPU cycles on the ATmega32U4 and in nanoseconds in the simulator.
+ *
+ * Build the firmware with -D ENABLE_BENCHMARKS to run the benchmarks at startup and
+ * run the simulator with option --benchmark to run them on the host.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_BENCHMARK_H
+#define WRC_MORSE_KEY_ADAPTER_BENCHMARK_H
+
+void benchmarkRun();
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cw_decoder.h"
+#include "morse_code.h"
+
+static uint16_t cwDecoderDitAverage;
+static uint16_t cwDecoderDahAverage;
+
+static bool cwDecoderKeyOn = false;
+static uint32_t cwDecoderEdgeTicks = 0;
+
+// Marks of the character in progress, a count over MORSE_CODE_MAXIMUM_ELEMENTS is a character without a code
+static uint16_t cwDecoderMarks[MORSE_CODE_MAXIMUM_ELEMENTS];
+static uint8_t cwDecoderMarkCount = 0;
+
+// A word space follows a decoded character
+static bool cwDecoderWordSpacePending = false;
+
+static uint8_t cwDecoderOutputBuffer[CW_DECODER_OUTPUT_BUFFER_SIZE];
+static uint8_t cwDecoderOutputHead = 0;
+static uint8_t cwDecoderOutputTail = 0;
+
+void cwDecoderReset(uint16_t ditTicks)
+{
+    cwDecoderSetDitTicks(ditTicks);
+    cwDecoderKeyOn = false;
+    cwDecoderMarkCount = 0;
+    cwDecoderWordSpacePending = false;
+    cwDecoderOutputTail = cwDecoderOutputHead;
+}
+
+void cwDecoderSetDitTicks(uint16_t ditTicks)
+{
+    cwDecoderDitAverage = ditTicks;
+    cwDecoderDahAverage = 3 * ditTicks;
+}
+
+static void cwDecoderOutput(uint8_t character)
+{
+    // The oldest characters are kept if the output does not keep up
+    if ((uint8_t) (cwDecoderOutputHead - cwDecoderOutputTail) < CW_DECODER_OUTPUT_BUFFER_SIZE) {
+        cwDecoderOutputBuffer[cwDecoderOutputHead & (CW_DECODER_OUTPUT_BUFFER_SIZE - 1)] = character;
+        cwDecoderOutputHead++;
+    }
+}
+
+static uint16_t cwDecoderAverage(uint16_t average, uint16_t sample)
+{
+    return (uint16_t) (average + (((int32_t) sample - average) >> CW_DECODER_AVERAGE_SHIFT));
+}
+
+// Keeps the dah average between 2 and 4 dits: the dit average follows the dah average and the dah average
+// follows the dit average
+static void cwDecoderLimitAverages(bool ditUpdated)
+{
+    if (!ditUpdated) {
+        if (cwDecoderDitAverage > cwDecoderDahAverage / 2) {
+            cwDecoderDitAverage = cwDecoderDahAverage / 2;
+        } else if (cwDecoderDitAverage < cwDecoderDahAverage / 4) {
+            cwDecoderDitAverage = cwDecoderDahAverage / 4;
+        }
+    }
+
+    if (cwDecoderDitAverage < CW_DECODER_DIT_TICKS_MINIMUM) {
+        cwDecoderDitAverage = CW_DECODER_DIT_TICKS_MINIMUM;
+    } else if (cwDecoderDitAverage > CW_DECODER_DIT_TICKS_MAXIMUM) {
+        cwDecoderDitAverage = CW_DECODER_DIT_TICKS_MAXIMUM;
+    }
+
+    if (cwDecoderDahAverage < 2 * cwDecoderDitAverage) {
+        cwDecoderDahAverage = 2 * cwDecoderDitAverage;
+    } else if (cwDecoderDahAverage > 4 * cwDecoderDitAverage) {
+        cwDecoderDahAverage = 4 * cwDecoderDitAverage;
+    }
+}
+
+static void cwDecoderRecordMark(uint16_t markTicks)
+{
+    if (cwDecoderMarkCount < MORSE_CODE_MAXIMUM_ELEMENTS) {
+        cwDecoderMarks[cwDecoderMarkCount] = markTicks;
+    }
+    if (cwDecoderMarkCount <= MORSE_CODE_MAXIMUM_ELEMENTS) {
+        cwDecoderMarkCount++;
+    }
+
+    // The averages follow each mark, so that the spaces are measured with the current speed
+    bool dah = markTicks >= ((uint32_t) cwDecoderDitAverage + cwDecoderDahAverage) / 2;
+    if (dah) {
+        cwDecoderDahAverage = cwDecoderAverage(cwDecoderDahAverage, markTicks);
+    } else {
+        cwDecoderDitAverage = cwDecoderAverage(cwDecoderDitAverage, markTicks);
+    }
+    cwDecoderLimitAverages(!dah);
+}
+
+// Classifies the marks of a character: a character with both dits and dahs has marks at least twice as long
+// as the others, which separates them better than the averages while the speed is changing. The averages
+// classify the characters with only dits or only dahs.
+static uint8_t cwDecoderDecodeCharacter()
+{
+    if (cwDecoderMarkCount > MORSE_CODE_MAXIMUM_ELEMENTS) {
+        return CW_DECODER_UNKNOWN_CHARACTER;
+    }
+
+    uint16_t shortest = 0xFFFF;
+    uint16_t longest = 0;
+    for (uint8_t i = 0; i < cwDecoderMarkCount; i++) {
+        if (cwDecoderMarks[i] < shortest) {
+            shortest = cwDecoderMarks[i];
+        }
+        if (cwDecoderMarks[i] > longest) {
+            longest = cwDecoderMarks[i];
+        }
+    }
+    uint16_t threshold = longest >= 2 * (uint32_t) shortest ? ((uint32_t) shortest + longest) / 2
+            : ((uint32_t) cwDecoderDitAverage + cwDecoderDahAverage) / 2;
+
+    uint8_t code = MORSE_CODE_WORD_SPACE << cwDecoderMarkCount;
+    for (uint8_t i = 0; i < cwDecoderMarkCount; i++) {
+        if (cwDecoderMarks[i] >= threshold) {
+            code |= 1 << i;
+        }
+    }
+
+    uint8_t character = morseCharacterForCode(code);
+    return character != 0 ? character : CW_DECODER_UNKNOWN_CHARACTER;
+}
+
+// Ends the character and the word at the spaces of 2 and 5 units, returns true if the space is within a character
+static bool cwDecoderRecordSpace(uint32_t spaceTicks)
+{
+    uint32_t unitTicks = ((uint32_t) cwDecoderDitAverage + cwDecoderDahAverage) / 4;
+
+    if (cwDecoderMarkCount > 0) {
+        if (spaceTicks < 2 * unitTicks) {
+            return true;
+        }
+
+        cwDecoderOutput(cwDecoderDecodeCharacter());
+        cwDecoderMarkCount = 0;
+        cwDecoderWordSpacePending = true;
+    }
+
+    if (cwDecoderWordSpacePending && spaceTicks >= 5 * unitTicks) {
+        cwDecoderOutput(' ');
+        cwDecoderWordSpacePending = false;
+    }
+
+    return false;
+}
+
+void cwDecoderRecordEdge(bool on, uint32_t ticks)
+{
+    if (on == cwDecoderKeyOn) {
+        return;
+    }
+    cwDecoderKeyOn = on;
+
+    // Marks and spaces longer than 2 s are all the same to the decoder
+    uint32_t durationTicks = ticks - cwDecoderEdgeTicks;
+    cwDecoderEdgeTicks = ticks;
+    if (durationTicks > 0xFFFF) {
+        durationTicks = 0xFFFF;
+    }
+
+    if (!on) {
+        cwDecoderRecordMark((uint16_t) durationTicks);
+    } else if (cwDecoderRecordSpace(durationTicks)) {
+        // The space between the elements of a character is a dit long
+        cwDecoderDitAverage = cwDecoderAverage(cwDecoderDitAverage, (uint16_t) durationTicks);
+        cwDecoderLimitAverages(true);
+    }
+}
+
+void cwDecoderUpdate(uint32_t ticks)
+{
+    if (!cwDecoderKeyOn) {
+        cwDecoderRecordSpace(ticks - cwDecoderEdgeTicks);
+    }
+}
+
+bool cwDecoderRead(uint8_t *character)
+{
+    if (cwDecoderOutputTail == cwDecoderOutputHead) {
+        return false;
+    }
+    *character = cwDecoderOutputBuffer[cwDecoderOutputTail & (CW_DECODER_OUTPUT_BUFFER_SIZE - 1)];
+    cwDecoderOutputTail++;
+    return true;
+}
+
+uint16_t cwDecoderDitTicks()
+{
+    return cwDecoderDitAverage;
+}
@@ -0,0 +1,82 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Adaptive Morse decoder of the keyed elements. The decoder takes the tick-timestamped key edges of the
+ * straight key and the keyer output and classifies each mark as a dit or a dah against the running averages
+ * of both, so it follows the speed and the weighting of the operator. The spaces are measured in units of
+ * a quarter of the dit and dah averages: a space of 2 units ends a character and 5 units a word.
+ *
+ * The decoder uses constant memory and a constant time per edge, except for the table lookup of a decoded
+ * character. It is built in with CW_DECODER_ENABLED and the decoded characters are written to the outputs
+ * selected with CW_DECODER_OUTPUT.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_CW_DECODER_H
+#define WRC_MORSE_KEY_ADAPTER_CW_DECODER_H
+
+#include "hal.h"
+#include "dds_sine_generator.h"
+
+// Set to true to decode the keyed Morse code on the device
+#ifndef CW_DECODER_ENABLED
+#define CW_DECODER_ENABLED false
+#endif
+
+// Outputs of the decoded characters, CW_DECODER_OUTPUT is a combination of these. The keyboard output types the
+// characters in the US layout, the shifted ones with shift, and the letters in lowercase.
+#define CW_DECODER_OUTPUT_SERIAL 1
+#define CW_DECODER_OUTPUT_KEYBOARD 2
+
+#ifndef CW_DECODER_OUTPUT
+#define CW_DECODER_OUTPUT CW_DECODER_OUTPUT_SERIAL
+#endif
+
+// Character of a code that is not in the Morse table
+#define CW_DECODER_UNKNOWN_CHARACTER '*'
+
+// Character typed by the keyboard output in place of the characters on the keys used for keying (, . / and ?),
+// which the host would take for key presses
+#define CW_DECODER_KEYBOARD_MARKER '#'
+
+// Decoded characters waiting for the output, must be a power of two
+#define CW_DECODER_OUTPUT_BUFFER_SIZE 8
+
+// A mark moves its element average by 1 / 2^CW_DECODER_AVERAGE_SHIFT of the difference
+#define CW_DECODER_AVERAGE_SHIFT 1
+
+// Range of the dit average, 60 to 5 WPM
+#define CW_DECODER_DIT_TICKS_MINIMUM millisToPwmTicks(1200.0 / 60)
+#define CW_DECODER_DIT_TICKS_MAXIMUM millisToPwmTicks(1200.0 / 5)
+
+// Starts decoding with the given dit duration and no character in progress
+void cwDecoderReset(uint16_t ditTicks);
+
+void cwDecoderRecordEdge(bool on, uint32_t ticks);
+
+// Ends the character and the word in progress once the key has been up long enough
+void cwDecoderUpdate(uint32_t ticks);
+
+// Sets the dit duration and the dah duration of 3 dits the averages start from
+void cwDecoderSetDitTicks(uint16_t ditTicks);
+
+// Takes the next decoded character, returns false if there is none
+bool cwDecoderRead(uint8_t *character);
+
+// Current estimate of the dit duration
+uint16_t cwDecoderDitTicks();
+
+#endif
@@ -26,34 +26,15 @@
  * Academy of Media Arts Cologne
  */
 
-#include <Arduino.h>
-#include <avr/pgmspace.h>
-
-// The code uses pin 6 for PWM output by default, which is present on both Arduino Micro and Arduino Pro Micro.
-// It is also possible to use pin 13 in Arduino Micro by setting USE_PIN_13 to true.
-#define USE_PIN_13 false
-
-#if USE_PIN_13 == true
-#define REG_OCR OCR4A
-#define PIN_PWM 13
-#else
-#define REG_OCR OCR4D
-#define PIN_PWM 6
-#endif
-
-#ifndef cbi
-#define cbi(sfr, bit) (_SFR_BYTE(sfr) &= ~_BV(bit))
-#endif
-
-#ifndef sbi
-#define sbi(sfr, bit) (_SFR_BYTE(sfr) |= _BV(bit))
-#endif
-
-// REFCLK=16MHz / 510
-// #define REFCLK 31372.549
-// Measured REFCLK
-#define REFCLK 31376.6
+#include "hal.h"
+#include "dds_sine_generator.h"
+#include "keyer_output.h"
+#include "keyer_parameters.h"
+#include "sidetone_envelope.h"
+#include "instrumentation.h"
+#include "idle_mode.h"
 
+#if PWM_HIGH_RESOLUTION != true
 // Table of 256 sine values, one sine period, stored in flash memory
 PROGMEM const uint8_t sine256[] = {
         127, 130, 133, 136, 139, 143, 146, 149, 152, 155, 158, 161, 164, 167, 170, 173, 176, 178, 181, 184, 187, 190,
@@ -71,111 +52,401 @@ PROGMEM const uint8_t sine256[] = {
         33, 35, 37, 39, 42, 44, 46, 49, 51, 54, 56, 59, 62, 64, 67, 70, 73, 76, 78, 81, 84, 87, 90, 93, 96, 99, 102,
         105, 108, 111, 115, 118, 121, 124
 };
+#else
+// Quarter of a sine period scaled to the high resolution PWM amplitude: round(382 * sin(pi / 2 * i / 64)).
+// The table ends with the peak and the entry after it, so the interpolation can always read index + 1.
+#define PWM_SINE_QUARTER_SIZE 64
+#define PWM_SINE_HIGH_RESOLUTION_MIDDLE 382
+
+PROGMEM const uint16_t sineQuarter[PWM_SINE_QUARTER_SIZE + 2] = {
+        0, 9, 19, 28, 37, 47, 56, 65, 75, 84, 93, 102, 111, 120, 129, 137,
+        146, 155, 163, 172, 180, 188, 196, 204, 212, 220, 228, 235, 242, 250, 257, 263,
+        270, 277, 283, 289, 295, 301, 307, 312, 318, 323, 328, 332, 337, 341, 345, 349,
+        353, 356, 360, 363, 366, 368, 371, 373, 375, 376, 378, 379, 380, 381, 382, 382,
+        382, 382
+};
+
+// Envelope level amplitudes for the high resolution mode: round(256 * sin^2(pi * level / 32))
+PROGMEM const uint8_t sineEnvelopeGain[PWM_ENVELOPE_LEVELS] = {
+        0, 2, 10, 22, 37, 57, 79, 103, 128, 153, 177, 199, 219, 234, 246, 254
+};
+#endif
+
+// The envelope position is the ramp progress in 1/65536ths, the amplitude level is its top bits
+#define PWM_ENVELOPE_POSITION_MAX 0xFFFF
+#define PWM_ENVELOPE_LEVEL_SHIFT 12
+
+static_assert((PWM_ENVELOPE_POSITION_MAX + 1) >> PWM_ENVELOPE_LEVEL_SHIFT == PWM_ENVELOPE_LEVELS,
+        "Envelope level shift must match the number of levels");
+
+constexpr uint16_t pwmEnvelopeRateForMillis(uint8_t milliseconds)
+{
+    return milliseconds == 0 ? PWM_ENVELOPE_POSITION_MAX : PWM_ENVELOPE_POSITION_MAX / millisToPwmTicks(milliseconds);
+}
 
 volatile bool pwmEnabled = false;
 volatile uint32_t pwmInterruptCounter = 0;
 volatile unsigned long phaseAccumulator;
-volatile unsigned long ddsTuningWord;
+volatile uint16_t pwmEnvelopePosition = 0;
+volatile uint16_t pwmEnvelopeRate = pwmEnvelopeRateForMillis(PWM_ENVELOPE_MILLIS);
+
+#if IDLE_MODE_ENABLED == true
+// The tick interrupt switches the timer to the idle rate at the start of a timer period when requested
+volatile bool pwmIdle = false;
+volatile bool pwmIdleRequested = false;
+#endif
+
+#if PWM_SAMPLE_RING == true
+PwmSample pwmSampleRing[PWM_SAMPLE_RING_SIZE];
+// Free-running sample counters, the ring index is the counter modulo PWM_SAMPLE_RING_SIZE
+volatile uint8_t pwmSampleRingRead = 0;
+uint8_t pwmSampleRingWrite = 0;
+uint32_t pwmSampleRingUnderruns = 0;
+// Keyer queue head at the last refill, the queued samples are recomputed when an element is added
+uint8_t pwmSampleRingQueueHead = 0;
+#endif
 
-uint32_t millisToPwmTicks(double milliseconds)
+// The tick interrupt may increment the counter between the byte reads of a multi-byte read,
+// so the counter is read until two consecutive reads agree
+uint32_t getPwmTicks()
 {
-    return milliseconds * 125.0 / 4.0;
+#if IDLE_MODE_ENABLED == true
+    // At the idle rate the ticks since the last interrupt are read from the timer
+    uint8_t state = halInterruptsDisable();
+    uint32_t ticks = pwmInterruptCounter;
+    if (pwmIdle) {
+        ticks += halPwmTickIdleElapsed();
+    }
+    halInterruptsRestore(state);
+#else
+    uint32_t ticks;
+    do {
+        ticks = pwmInterruptCounter;
+    } while (ticks != pwmInterruptCounter);
+#endif
+
+    return ticks;
 }
 
-uint32_t getPwmTicks()
+void pwmSetFrequency(double frequency)
 {
-    return pwmInterruptCounter;
+    pwmSetTuningWord(pwmFrequencyToTuningWord(frequency));
 }
 
-// Timer setup
-// Set prescaler to 1, PWM mode to phase correct PWM, 16000000/510 = 31372.55 Hz clock
-void pwmInitTimer()
+// The pitch can change while the sidetone is on, the tick interrupt reads the tuning word from the published
+// parameter block, so it never sees a partially written value
+void pwmSetTuningWord(uint32_t tuningWord)
 {
-    // Timer Clock Prescaler to : 1
-    sbi(TCCR4B, CS40);
-    cbi(TCCR4B, CS41);
-    cbi(TCCR4B, CS42);
-    cbi(TCCR4B, CS43);
+    KeyerParameters *parameters = keyerParametersEdit();
+    parameters->tuningWord = tuningWord;
+    keyerParametersPublish();
+}
 
-    // Timer PWM Mode set to Phase Correct PWM
-    // Clear Compare Match
-    if (USE_PIN_13) {
-        cbi(TCCR4A, COM4A0);
-        sbi(TCCR4A, COM4A1);
+void pwmSetEnvelopeDuration(uint8_t milliseconds)
+{
+    if (milliseconds != 0 && milliseconds < PWM_ENVELOPE_MILLIS_MINIMUM) {
+        milliseconds = PWM_ENVELOPE_MILLIS_MINIMUM;
+    } else if (milliseconds > PWM_ENVELOPE_MILLIS_MAXIMUM) {
+        milliseconds = PWM_ENVELOPE_MILLIS_MAXIMUM;
+    }
 
-        sbi(TCCR4A, PWM4A);
-    } else {
-        cbi(TCCR4C, COM4D0);
-        sbi(TCCR4C, COM4D1);
+    uint16_t rate = pwmEnvelopeRateForMillis(milliseconds);
+    halPwmTickInterruptSetEnabled(false);
+    pwmEnvelopeRate = rate;
+    halPwmTickInterruptSetEnabled(true);
+}
+
+bool pwmIsEnvelopeRamping()
+{
+    halPwmTickInterruptSetEnabled(false);
+    uint16_t position = pwmEnvelopePosition;
+    halPwmTickInterruptSetEnabled(true);
+
+    return position != 0 && position != PWM_ENVELOPE_POSITION_MAX;
+}
 
-        sbi(TCCR4C, PWM4D);
+#if PWM_HIGH_RESOLUTION == true
+// The top 16 bits of the phase are the quadrant (2 bits), the quarter table index (6 bits) and
+// the interpolation fraction (8 bits). The difference of adjacent entries fits in 8 bits,
+// so the interpolation is a single 8x8 multiplication.
+inline uint16_t pwmSine(uint32_t phase)
+{
+    uint16_t phaseHigh = phase >> 16;
+    uint16_t position = phaseHigh & 0x3FFF;
+    if (phaseHigh & 0x4000) {
+        position = 0x4000 - position;
     }
 
-    // Mode 1  / Phase Correct PWM
-    sbi(TCCR4D, WGM40);
-    cbi(TCCR4D, WGM41);
+    uint8_t index = position >> 8;
+    uint8_t fraction = position;
+    uint16_t value = pgm_read_word_near(sineQuarter + index);
+    uint8_t delta = pgm_read_word_near(sineQuarter + index + 1) - value;
+    value += (uint16_t) ((uint16_t) delta * fraction + 128) >> 8;
+
+    return phaseHigh & 0x8000 ? PWM_SINE_HIGH_RESOLUTION_MIDDLE - value : PWM_SINE_HIGH_RESOLUTION_MIDDLE + value;
 }
 
-void pwmSetFrequency(double frequency)
+// During the envelope ramps the interpolated sample is scaled by the gain of the level
+inline uint16_t pwmSineAtLevel(uint32_t phase, uint8_t level)
+{
+    return ((uint32_t) pwmSine(phase) * pgm_read_byte_near(sineEnvelopeGain + level)) >> 8;
+}
+#else
+// Use upper 8 bits of phase accumulator as frequency information
+inline uint8_t pwmSine(uint32_t phase)
 {
-    ddsTuningWord = pow(2, 32) * frequency / REFCLK;
+    return pgm_read_byte_near(sine256 + (uint8_t) (phase >> 24));
+}
+
+inline uint8_t pwmSineAtLevel(uint32_t phase, uint8_t level)
+{
+    return pgm_read_byte_near(&sineEnvelope[level - 1][(uint8_t) (phase >> 25)]);
+}
+#endif
+
+// Moves the envelope one sample towards the keyed state and returns the sine sample scaled by it.
+// Outside the ramps this is a single comparison, during a ramp an addition and a lookup from the scaled tables
+// (a multiplication by the level gain in high resolution mode).
+inline PwmSample pwmEnvelopeSample(bool on, uint32_t phase)
+{
+    uint16_t position = pwmEnvelopePosition;
+    uint16_t rate = pwmEnvelopeRate;
+
+    if (on) {
+        if (position == PWM_ENVELOPE_POSITION_MAX) {
+            return pwmSine(phase);
+        }
+        position = position > PWM_ENVELOPE_POSITION_MAX - rate ? PWM_ENVELOPE_POSITION_MAX : position + rate;
+    } else {
+        if (position == 0) {
+            return 0;
+        }
+        position = position < rate ? 0 : position - rate;
+    }
+    pwmEnvelopePosition = position;
+
+    uint8_t level = position >> PWM_ENVELOPE_LEVEL_SHIFT;
+    if (position == PWM_ENVELOPE_POSITION_MAX) {
+        return pwmSine(phase);
+    }
+    if (level == 0) {
+        return 0;
+    }
+    return pwmSineAtLevel(phase, level);
+}
+
+inline void pwmWriteSample(PwmSample sample)
+{
+#if PWM_HIGH_RESOLUTION == true
+    halPwmWriteHighResolution(sample);
+#else
+    halPwmWrite(sample);
+#endif
 }
 
 void pwmInit(double frequency)
 {
-    // PWM frequency output
-    pinMode(PIN_PWM, OUTPUT);
+    pwmSetFrequency(frequency);
+    pwmRefillSamples();
+
+    halPwmInit();
+}
+
+#if PWM_SAMPLE_RING == true
+// The sample is keyed by the scheduled elements at the tick it is output at, the same tick the interrupt
+// keys the elements at
+inline PwmSample pwmNextSample(uint32_t ticks)
+{
+    // Soft DDS, use phase accumulator with 32 bits
+    phaseAccumulator = phaseAccumulator + keyerParameters()->tuningWord;
 
-    // Pin 7 can be used to debug timing
-    // pinMode(7, OUTPUT);
+    return pwmEnvelopeSample(pwmEnabled || keyerOutputIsKeyedAt(ticks), phaseAccumulator);
+}
 
-    pwmInitTimer();
+// Drops the queued samples except for the next PWM_SAMPLE_RING_LEAD ones, which the interrupt may be
+// reading right now, and rewinds the phase accumulator so that the recomputed samples continue the phase.
+// The envelope is not rewound: the keying changes at most every dit (24 ms at 50 WPM), so the envelope
+// has reached its end state well before the dropped samples.
+void pwmRewindSamples()
+{
+    uint8_t queued = pwmSampleRingWrite - pwmSampleRingRead;
+    if (queued <= PWM_SAMPLE_RING_LEAD || queued >= PWM_SAMPLE_RING_SIZE) {
+        return;
+    }
 
-    // Disable interrupts to avoid timing distortion
-    // Disable Timer0 -- delay() is now not available
-    cbi(TIMSK0, TOIE0);
+    uint8_t dropped = queued - PWM_SAMPLE_RING_LEAD;
+    pwmSampleRingWrite -= dropped;
+    phaseAccumulator = phaseAccumulator - dropped * keyerParameters()->tuningWord;
+}
+#endif
 
-    // Enable timer interrupt
-    sbi(TIMSK4, TOIE4);
+void pwmRefillSamples()
+{
+#if PWM_SAMPLE_RING == true
+    // The interrupt outputs the sample at the read position at the current tick
+    uint8_t state = halInterruptsDisable();
+    uint32_t ticks = pwmInterruptCounter;
+    uint8_t read = pwmSampleRingRead;
+    halInterruptsRestore(state);
 
-    // Disable timer interrupt
-    //cbi(TIMSK4, TOIE4);
+    // The samples computed before an element was added are recomputed if it starts before the last of them.
+    // The elements are usually added well ahead of the ring, and a rewind keeps the envelope as it is,
+    // which is silent then: the previous element ended at least a dit earlier.
+    uint8_t queued = pwmSampleRingWrite - read;
+    for (uint8_t head = keyerQueueHead; pwmSampleRingQueueHead != head; pwmSampleRingQueueHead++) {
+        const KeyerElement *element = &keyerQueueElements[pwmSampleRingQueueHead & (KEYER_QUEUE_SIZE - 1)];
+        if (!ticksReached(element->startTicks, ticks + queued)) {
+            pwmRewindSamples();
+            queued = pwmSampleRingWrite - read;
+        }
+    }
 
-    pwmSetFrequency(frequency);
+    if (queued >= PWM_SAMPLE_RING_SIZE) {
+        // The interrupt has consumed samples that were never written, restart from the current position
+        pwmSampleRingUnderruns++;
+        pwmSampleRingWrite = read;
+        queued = 0;
+    }
+
+    for (; queued < PWM_SAMPLE_RING_SIZE - 1; queued++) {
+        pwmSampleRing[pwmSampleRingWrite & (PWM_SAMPLE_RING_SIZE - 1)] = pwmNextSample(ticks + queued);
+        pwmSampleRingWrite++;
+    }
+#endif
+}
+
+uint32_t pwmGetSampleRingUnderruns()
+{
+#if PWM_SAMPLE_RING == true
+    return pwmSampleRingUnderruns;
+#else
+    return 0;
+#endif
 }
 
 void pwmSetEnabled(bool enabled)
 {
+    if (pwmEnabled == enabled) {
+        return;
+    }
+
     pwmEnabled = enabled;
+
+#if PWM_SAMPLE_RING == true
+    pwmRewindSamples();
+    pwmRefillSamples();
+#endif
 }
 
 bool pwmIsEnabled()
 {
-    return pwmEnabled;
+    return pwmEnabled || keyerOutputOn;
 }
 
+void pwmSetIdle(bool idle)
+{
+#if IDLE_MODE_ENABLED == true
+    uint8_t state = halInterruptsDisable();
+    pwmIdleRequested = idle;
+    if (!idle && pwmIdle) {
+        // The ticks of the partial idle period are counted before the timer restarts at the tick rate
+        pwmInterruptCounter += halPwmTickIdleElapsed();
+        halPwmTickSetIdle(false);
+        pwmIdle = false;
+    }
+    halInterruptsRestore(state);
+#endif
+}
+
+bool pwmIsIdle()
+{
+#if IDLE_MODE_ENABLED == true
+    return pwmIdle;
+#else
+    return false;
+#endif
+}
+
+#if IDLE_MODE_ENABLED == true
+// Called at the end of the tick interrupt: the slow idle interrupt only counts the ticks
+inline void pwmApplyIdleRequest()
+{
+    if (pwmIdleRequested) {
+        pwmIdle = true;
+        halPwmTickSetIdle(true);
+    }
+}
+#else
+inline void pwmApplyIdleRequest()
+{
+}
+#endif
+
+#if PWM_SAMPLE_RING == true
+// Timer4 Interrupt Service at 31372,550 KHz = 32uSec
+// Sample ring mode: output the next precomputed sample, key the scheduled elements and count the tick.
+// While the keyer queue holds an element, keying loads the 32-bit tick counter and compares it with the start
+// or end tick of the element, and an edge also writes the edge history and pops the queue. The tick counter is
+// incremented one byte at a time so that the carry is propagated only when the low byte wraps.
+// Runtime: not measured on the board yet, the 2 microsecond target of the mode is unverified. The benchmarks
+// print it with an empty keyer queue, during the envelope ramp and with an element pending.
+HAL_PWM_TICK_ISR
+{
+#if IDLE_MODE_ENABLED == true
+    if (pwmIdle) {
+        pwmInterruptCounter += HAL_PWM_IDLE_TICKS;
+        return;
+    }
+#endif
+    uint16_t instrumentationStart = instrumentationTickStart();
+
+    uint8_t read = pwmSampleRingRead;
+    pwmWriteSample(pwmSampleRing[read & (PWM_SAMPLE_RING_SIZE - 1)]);
+    pwmSampleRingRead = read + 1;
+
+    // Key the scheduled keyer elements exactly at their start and end ticks, the samples were keyed for the same ticks
+    keyerOutputTick(pwmInterruptCounter);
+
+    // The counter is little-endian on both AVR and the simulator hosts
+    volatile uint8_t *counter = (volatile uint8_t *) &pwmInterruptCounter;
+    if (++counter[0] == 0 && ++counter[1] == 0 && ++counter[2] == 0) {
+        ++counter[3];
+    }
+    pwmApplyIdleRequest();
+
+    instrumentationTickEnd(instrumentationStart);
+}
+#else
 // Timer4 Interrupt Service at 31372,550 KHz = 32uSec
 // This is the timebase REFCLOCK for the DDS generator
 // FOUT = (M (REFCLK)) / (2 exp 32)
-// Runtime: 8 microseconds (including push and pop)
-ISR(TIMER4_OVF_vect)
+// Runtime: 8 microseconds (including push and pop), the envelope ramps add a table lookup
+HAL_PWM_TICK_ISR
 {
+#if IDLE_MODE_ENABLED == true
+    if (pwmIdle) {
+        pwmInterruptCounter += HAL_PWM_IDLE_TICKS;
+        return;
+    }
+#endif
     // Toggle PORTD, pin 7 to observe timing with a scope
     // sbi(PORTD, 7);
+    uint16_t instrumentationStart = instrumentationTickStart();
 
     // Soft DDS, use phase accumulator with 32 bits
-    phaseAccumulator = phaseAccumulator + ddsTuningWord;
-    // Use upper 8 bits of phase accumulator as frequency information
-    byte pwmSineIndex = phaseAccumulator >> 24;
+    unsigned long phase = phaseAccumulator + keyerParameters()->tuningWord;
+    phaseAccumulator = phase;
 
-    if (pwmEnabled) {
-        // Read value from sine table and send to PWM DAC
-        REG_OCR = pgm_read_byte_near(sine256 + pwmSineIndex);
-    } else {
-        REG_OCR = 0;
-    }
+    // Key the scheduled keyer elements exactly at their start and end ticks
+    bool keyed = keyerOutputTick(pwmInterruptCounter);
+
+    // Read value from sine table shaped by the envelope and send to PWM DAC
+    pwmWriteSample(pwmEnvelopeSample(pwmEnabled || keyed, phase));
 
     pwmInterruptCounter++;
+    pwmApplyIdleRequest();
 
+    instrumentationTickEnd(instrumentationStart);
     // cbi(PORTD, 7);
 }
+#endif
@@ -19,9 +19,62 @@
 #ifndef WRC_MORSE_KEY_ADAPTER_DDS_SINE_GENERATOR_H
 #define WRC_MORSE_KEY_ADAPTER_DDS_SINE_GENERATOR_H
 
-#include <Arduino.h>
+#include "hal.h"
 
-uint32_t millisToPwmTicks(double milliseconds);
+// In sample ring mode the main loop precomputes PWM output values into a ring buffer with pwmRefillSamples()
+// and the tick interrupt only writes the next value to the PWM output register, keys the scheduled elements
+// and counts the tick.
+// The ring holds up to PWM_SAMPLE_RING_SIZE - 1 samples (~2 ms), so the main loop must call pwmRefillSamples()
+// more often than that or the output repeats stale samples.
+#ifndef PWM_SAMPLE_RING
+#define PWM_SAMPLE_RING false
+#endif
+
+// In high resolution mode the sine is interpolated from a quarter-wave table using 16 bits of the phase
+// accumulator and written to the 10-bit PWM registers of Timer4 with values up to PWM_HIGH_RESOLUTION_TOP
+// instead of 255. The timer runs from the 48 MHz USB PLL to keep the same tick rate.
+#ifndef PWM_HIGH_RESOLUTION
+#define PWM_HIGH_RESOLUTION false
+#endif
+
+#define PWM_HIGH_RESOLUTION_TOP 765
+
+#if PWM_HIGH_RESOLUTION == true
+typedef uint16_t PwmSample;
+#else
+typedef uint8_t PwmSample;
+#endif
+
+// Must be a power of two, at most 128
+#define PWM_SAMPLE_RING_SIZE 64
+
+// Number of queued samples kept when the sidetone is switched on or off, the rest are recomputed
+#define PWM_SAMPLE_RING_LEAD 4
+
+// Duration of the raised-cosine attack and decay of the sidetone in milliseconds (see sidetone_envelope.h),
+// 0 switches the sidetone on and off instantly
+#ifndef PWM_ENVELOPE_MILLIS
+#define PWM_ENVELOPE_MILLIS 5
+#endif
+
+#define PWM_ENVELOPE_MILLIS_MINIMUM 2
+#define PWM_ENVELOPE_MILLIS_MAXIMUM 8
+
+// REFCLK=16MHz / 510
+// #define REFCLK 31372.549
+// Measured REFCLK
+#define REFCLK 31376.6
+
+constexpr uint32_t millisToPwmTicks(double milliseconds)
+{
+    return milliseconds * 125.0 / 4.0;
+}
+
+// Tuning word for the 32-bit phase accumulator: FOUT = (M (REFCLK)) / (2 exp 32)
+constexpr uint32_t pwmFrequencyToTuningWord(double frequency)
+{
+    return 4294967296.0 * frequency / REFCLK;
+}
 
 uint32_t getPwmTicks();
 
@@ -31,6 +84,22 @@ void pwmSetEnabled(bool enabled);
 
 bool pwmIsEnabled();
 
+void pwmSetEnvelopeDuration(uint8_t milliseconds);
+
+bool pwmIsEnvelopeRamping();
+
 void pwmSetFrequency(double frequency);
 
+void pwmSetTuningWord(uint32_t tuningWord);
+
+void pwmRefillSamples();
+
+uint32_t pwmGetSampleRingUnderruns();
+
+// Slows the tick interrupt down to the idle rate from the next timer period, or switches back to the tick rate
+// at once. The tick counter stays continuous, see idle_mode.h.
+void pwmSetIdle(bool idle);
+
+bool pwmIsIdle();
+
 #endif
@@ -0,0 +1,48 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "debounce.h"
+
+int debounceInput(DebouncedInput *input, uint8_t onState, uint32_t ticks)
+{
+    // The interrupt may record an edge while the state is read, read again until consistent
+    uint8_t edgeCount;
+    uint8_t rawState;
+    uint32_t edgeTicks;
+    do {
+        edgeCount = input->edgeCount;
+        rawState = input->rawState;
+        edgeTicks = input->edgeTicks;
+    } while (edgeCount != input->edgeCount);
+
+    if (rawState == input->state) {
+        return input->state == onState ? INPUT_STATE_ON : INPUT_STATE_OFF;
+    }
+
+    if (ticks - input->changeTicks < input->windowTicks) {
+        // Bounce within the window after the previous change
+        return INPUT_STATE_IGNORE;
+    }
+
+    input->state = rawState;
+    // Measure the window from the edge itself rather than from the time the main loop saw it,
+    // unless the edge was a bounce within the previous window
+    input->changeTicks = edgeTicks - input->changeTicks >= input->windowTicks ? edgeTicks : ticks;
+
+    return rawState == onState ? INPUT_STATE_ON_CHANGED : INPUT_STATE_OFF_CHANGED;
+}
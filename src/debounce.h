@@ -0,0 +1,72 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Time-window debouncing of the key and PTT inputs. The pin change interrupts record the pin state
+ * and the tick of every edge, and debounceInput() evaluates the recorded state from the main loop
+ * without blocking: a change is accepted immediately if the debounced state has been stable for
+ * the debounce window, and edges within the window after an accepted change are ignored as bounces.
+ * After the window the debounced state follows the pin state again.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_DEBOUNCE_H
+#define WRC_MORSE_KEY_ADAPTER_DEBOUNCE_H
+
+#include "hal.h"
+#include "dds_sine_generator.h"
+
+#define INPUT_STATE_ON_CHANGED 3
+#define INPUT_STATE_OFF_CHANGED 2
+#define INPUT_STATE_ON 1
+#define INPUT_STATE_OFF 0
+#define INPUT_STATE_IGNORE -1
+
+// Debounce windows in ticks
+#define DEBOUNCE_PADDLE_TICKS millisToPwmTicks(3)
+#define DEBOUNCE_STRAIGHT_KEY_TICKS millisToPwmTicks(3)
+#define DEBOUNCE_PTT_TICKS millisToPwmTicks(20)
+
+struct DebouncedInput {
+    // Written by the pin change interrupt
+    volatile uint8_t rawState;
+    volatile uint8_t edgeCount;
+    volatile uint32_t edgeTicks;
+
+    // Debounced state, only used by the main loop
+    uint8_t state;
+    uint32_t changeTicks;
+    uint16_t windowTicks;
+};
+
+#define DEBOUNCED_INPUT(windowTicks) { HIGH, 0, 0, HIGH, 0, (uint16_t) (windowTicks) }
+
+// Called from the pin change interrupt
+inline void debounceRecordEdge(DebouncedInput *input, uint8_t state, uint32_t ticks)
+{
+    input->rawState = state;
+    input->edgeTicks = ticks;
+    input->edgeCount++;
+}
+
+int debounceInput(DebouncedInput *input, uint8_t onState, uint32_t ticks);
+
+// Tick of the edge that caused the last accepted change
+inline uint32_t debounceChangeTicks(DebouncedInput *input)
+{
+    return input->changeTicks;
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "debug_log.h"
+#include "trace_recorder.h"
+#include "instrumentation.h"
+
+#if DEBUG_LOG_ENABLED == true
+DebugLogRecord debugLogRecords[DEBUG_LOG_SIZE];
+// Free-running record counters, the head is written with the interrupts disabled as the interrupt handlers
+// also log
+volatile uint8_t debugLogHead = 0;
+volatile uint8_t debugLogTail = 0;
+
+// Dropped records not logged yet and in total
+uint16_t debugLogPendingDroppedCount = 0;
+uint32_t debugLogDroppedCount = 0;
+
+static void debugLogStore(uint8_t message, uint32_t ticks, uint32_t argument1, uint32_t argument2,
+        uint32_t argument3)
+{
+    uint8_t head = debugLogHead;
+    DebugLogRecord *record = &debugLogRecords[head & (DEBUG_LOG_SIZE - 1)];
+    record->message = message;
+    record->ticks = ticks;
+    record->arguments[0] = argument1;
+    record->arguments[1] = argument2;
+    record->arguments[2] = argument3;
+    debugLogHead = head + 1;
+}
+#endif
+
+void debugLog(uint8_t message, uint32_t ticks, uint32_t argument1, uint32_t argument2, uint32_t argument3)
+{
+#if DEBUG_LOG_ENABLED == true
+    uint8_t state = halInterruptsDisable();
+
+    // The count of the dropped records is logged in their place, once there is space for it and the record
+    uint8_t free = DEBUG_LOG_SIZE - (uint8_t) (debugLogHead - debugLogTail);
+    if (free < (debugLogPendingDroppedCount > 0 ? 2 : 1)) {
+        if (debugLogPendingDroppedCount < 0xFFFF) {
+            debugLogPendingDroppedCount++;
+        }
+        debugLogDroppedCount++;
+    } else {
+        if (debugLogPendingDroppedCount > 0) {
+            debugLogStore(DEBUG_LOG_MESSAGE_DROPPED, ticks, debugLogPendingDroppedCount, 0, 0);
+            debugLogPendingDroppedCount = 0;
+        }
+        debugLogStore(message, ticks, argument1, argument2, argument3);
+    }
+
+    halInterruptsRestore(state);
+#endif
+}
+
+#if DEBUG_LOG_ENABLED == true
+static uint8_t debugLogWriteValue(uint8_t *frame, uint32_t value)
+{
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        frame[i] = value >> (8 * i);
+        sum += frame[i];
+    }
+    return sum;
+}
+
+static void debugLogWriteFrame(const DebugLogRecord *record)
+{
+    uint8_t frame[DEBUG_LOG_FRAME_SIZE];
+    frame[0] = DEBUG_LOG_FRAME_SYNC;
+    frame[1] = record->message;
+    uint8_t checksum = record->message + debugLogWriteValue(&frame[2], record->ticks);
+    for (uint8_t i = 0; i < DEBUG_LOG_ARGUMENTS; i++) {
+        checksum += debugLogWriteValue(&frame[6 + 4 * i], record->arguments[i]);
+    }
+    frame[DEBUG_LOG_FRAME_SIZE - 1] = checksum;
+
+    halSerialWrite(frame, sizeof(frame));
+}
+#endif
+
+void debugLogDrain(bool idle)
+{
+#if DEBUG_LOG_ENABLED == true
+    // The other serial output is not interleaved with a trace dump or instrumentation readout either
+    if (!idle || traceRecorderDumping() || instrumentationReadingOut()) {
+        return;
+    }
+
+    while (debugLogTail != debugLogHead && halSerialAvailableForWrite() >= DEBUG_LOG_FRAME_SIZE) {
+        debugLogWriteFrame(&debugLogRecords[debugLogTail & (DEBUG_LOG_SIZE - 1)]);
+        debugLogTail++;
+    }
+#endif
+}
+
+uint32_t debugLogDroppedRecords()
+{
+#if DEBUG_LOG_ENABLED == true
+    uint8_t state = halInterruptsDisable();
+    uint32_t droppedCount = debugLogDroppedCount;
+    halInterruptsRestore(state);
+    return droppedCount;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,69 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Deferred binary debug log. The debug messages are recorded as fixed-size records of a message identifier,
+ * the tick and raw integer arguments (see debug_log_format.h) into a ring buffer, and the main loop writes
+ * them to the CDC serial port only while the keyer is idle and the serial port has space. Nothing is
+ * formatted on the adapter and the keyer never waits for the host, so the logging does not change
+ * the keyer timing. When the ring buffer is full the new records are dropped and counted, and the count
+ * is logged before the next record. The host-side formatter is in host/debug_log_decoder.h.
+ *
+ * The messages are enabled by category with the DEBUG_ defines below, or the same build flags.
+ * The log is left out of the build when no category is enabled.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_DEBUG_LOG_H
+#define WRC_MORSE_KEY_ADAPTER_DEBUG_LOG_H
+
+#include "hal.h"
+#include "debug_log_format.h"
+
+// Uncomment to enable serial port debugging
+// #define DEBUG_INTERRUPTS
+// #define DEBUG_TIMING
+// #define DEBUG_SCHEDULING
+// #define DEBUG_KEY
+// #define DEBUG_CONTROLS
+// #define DEBUG_PTT
+
+#if defined(DEBUG_INTERRUPTS) || defined(DEBUG_TIMING) || defined(DEBUG_SCHEDULING) || defined(DEBUG_KEY) \
+        || defined(DEBUG_CONTROLS) || defined(DEBUG_PTT)
+#define DEBUG_LOG_ENABLED true
+#else
+#define DEBUG_LOG_ENABLED false
+#endif
+
+// Records in the ring buffer, 17 bytes each, must be a power of two
+#ifndef DEBUG_LOG_SIZE
+#define DEBUG_LOG_SIZE 16
+#endif
+
+struct DebugLogRecord {
+    uint8_t message;
+    uint32_t ticks;
+    uint32_t arguments[DEBUG_LOG_ARGUMENTS];
+};
+
+// Records a message, also from interrupt handlers
+void debugLog(uint8_t message, uint32_t ticks, uint32_t argument1, uint32_t argument2, uint32_t argument3);
+
+// Writes the records to the serial port while the keyer is idle, called from the main loop
+void debugLogDrain(bool idle);
+
+uint32_t debugLogDroppedRecords();
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Binary debug log format, shared by the firmware and the host-side formatter.
+ *
+ * Each log record is sent over the CDC serial port as a frame of its own:
+ *
+ *   DEBUG_LOG_FRAME_SYNC, message, ticks, argument 1, argument 2, argument 3, checksum
+ *
+ * The message is one of the DEBUG_LOG_MESSAGE_ identifiers below, the tick and the arguments are 32-bit
+ * little-endian values and the checksum is the 8-bit sum of the bytes between the sync byte and the checksum.
+ * The arguments of each message are listed with it, unused arguments are 0.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_DEBUG_LOG_FORMAT_H
+#define WRC_MORSE_KEY_ADAPTER_DEBUG_LOG_FORMAT_H
+
+#define DEBUG_LOG_FRAME_SYNC 0xA7
+
+#define DEBUG_LOG_ARGUMENTS 3
+#define DEBUG_LOG_FRAME_SIZE (2 + 4 + DEBUG_LOG_ARGUMENTS * 4 + 1)
+
+// Records dropped because the log was full: count
+#define DEBUG_LOG_MESSAGE_DROPPED 1
+// Pin change interrupt: pin (DEBUG_LOG_PIN_), pin state
+#define DEBUG_LOG_MESSAGE_INTERRUPT 2
+// Keyer timing: speed in WPM, dit and dah durations (low and high 16 bits), pause and schedule-ahead durations
+#define DEBUG_LOG_MESSAGE_TIMING 3
+// Scheduled keyer element: start tick, end tick, action
+#define DEBUG_LOG_MESSAGE_SCHEDULE 4
+// Keyer mode: mode
+#define DEBUG_LOG_MESSAGE_KEYER_MODE 5
+// Key edge sent by the keyer: key, on
+#define DEBUG_LOG_MESSAGE_KEY 6
+// Speed potentiometer change: raw value, speed in WPM
+#define DEBUG_LOG_MESSAGE_SPEED 7
+// Pitch potentiometer change: raw value, tuning word
+#define DEBUG_LOG_MESSAGE_PITCH 8
+// PTT edge: on
+#define DEBUG_LOG_MESSAGE_PTT 9
+#define DEBUG_LOG_MESSAGE_COUNT 10
+
+#define DEBUG_LOG_PIN_RING 0
+#define DEBUG_LOG_PIN_TIP 1
+#define DEBUG_LOG_PIN_PTT 2
+
+#endif
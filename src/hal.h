@@ -0,0 +1,71 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Thin hardware abstraction layer. The keyer and the DDS generator only access hardware
+ * through the hal* functions, so that the same code runs on the ATmega32U4 and in the
+ * host-native simulator (see the sim directory and the native PlatformIO environment).
+ *
+ * The functions are:
+ *
+ * halPinModeInput(pin), halPinModeInputPullup(pin), halPinModeOutput(pin)
+ * halDigitalRead(pin), halPortRead(port) (the input levels of a port, see pinRead() in pins.h)
+ * halAdcInit(), halAdcSelectChannel(pin), halAdcResult()
+ * halAttachPinChangeInterrupt(pin, handler)
+ * halKeyboardBegin(), halHidReady(), halHidSendReport(id, data, length)
+ * halSerialBegin(baud), halSerialConnected(), halSerialPrintln(text)
+ * halSerialAvailable(), halSerialPeek(), halSerialRead()
+ * halSerialAvailableForWrite(), halSerialWrite(data, length)
+ * halPwmInit(), halPwmWrite(value), halPwmWriteHighResolution(value), halPwmTickInterruptSetEnabled(enabled)
+ * halPwmTickSetIdle(idle), halPwmTickIdleElapsed() (the slow tick interrupt of idle mode, see src/idle_mode.h)
+ * halCpuSleep() (sleeps until the next interrupt, called with interrupts disabled)
+ * halCycleCounterInit(), halCycleCounterRead() (16-bit counter in HAL_CYCLE_COUNTER_UNIT units)
+ * halInterruptsDisable(), halInterruptsRestore(state) (a critical section, restores the state before it)
+ * halMemoryBarrier() (a compiler barrier: the memory writes before it are not moved after it, used before
+ *                    publishing data shared with an interrupt through a volatile index)
+ * halUsbFrameNumber() (the 11-bit number of the last USB start of frame, one per millisecond)
+ * halEepromRead(address, data, length)
+ * halEepromReady(), halEepromWriteByte(address, value) (starts writing a changed byte without waiting for it,
+ *                                                    called only when ready)
+ * halPreemptionPoint() (a point where an interrupt may preempt the main loop, the simulator checks
+ *                      the data shared with the interrupts there)
+ *
+ * HAL_PWM_TICK_ISR declares the PWM timer tick interrupt handler, which is the timebase
+ * of the DDS generator and the keyer. HAL_ADC_ISR declares the ADC conversion complete interrupt
+ * handler, the conversions are triggered by the PWM timer tick.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_HAL_H
+#define WRC_MORSE_KEY_ADAPTER_HAL_H
+
+// Ports of the ATmega32U4 for halPortRead()
+#define HAL_PORT_NONE 0
+#define HAL_PORT_B 1
+#define HAL_PORT_C 2
+#define HAL_PORT_D 3
+#define HAL_PORT_E 4
+#define HAL_PORT_F 5
+
+// Ticks per tick interrupt while the PWM timer runs at the idle rate
+#define HAL_PWM_IDLE_TICKS 64
+
+#ifdef ARDUINO
+#include "hal_avr.h"
+#else
+#include "hal_native.h"
+#endif
+
+#endif
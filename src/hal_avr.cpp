@@ -0,0 +1,180 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "hal_avr.h"
+#include "raw_hid.h"
+#include "dds_sine_generator.h"
+
+// Timer setup
+// Set prescaler to 1, PWM mode to phase correct PWM, 16000000/510 = 31372.55 Hz clock
+// In high resolution mode the timer runs from the 48 MHz USB PLL and counts up to PWM_HIGH_RESOLUTION_TOP
+// with the 10-bit registers: 48000000/(2 * 765) = 31372.55 Hz, the same clock
+void halPwmInitTimer()
+{
+#if PWM_HIGH_RESOLUTION == true
+    // PLL postscaler factor 1 for the high speed timer clock, the Arduino core runs the PLL at 48 MHz for USB
+    PLLFRQ = (PLLFRQ & ~(_BV(PLLTM1) | _BV(PLLTM0))) | _BV(PLLTM0);
+
+    TC4H = PWM_HIGH_RESOLUTION_TOP >> 8;
+    OCR4C = PWM_HIGH_RESOLUTION_TOP & 0xFF;
+#endif
+
+    // Timer Clock Prescaler to : 1
+    sbi(TCCR4B, CS40);
+    cbi(TCCR4B, CS41);
+    cbi(TCCR4B, CS42);
+    cbi(TCCR4B, CS43);
+
+    // Timer PWM Mode set to Phase Correct PWM
+    // Clear Compare Match
+    if (USE_PIN_13) {
+        cbi(TCCR4A, COM4A0);
+        sbi(TCCR4A, COM4A1);
+
+        sbi(TCCR4A, PWM4A);
+    } else {
+        cbi(TCCR4C, COM4D0);
+        sbi(TCCR4C, COM4D1);
+
+        sbi(TCCR4C, PWM4D);
+    }
+
+    // Mode 1  / Phase Correct PWM
+    sbi(TCCR4D, WGM40);
+    cbi(TCCR4D, WGM41);
+}
+
+void halPwmInit()
+{
+    // PWM frequency output
+    pinMode(PIN_PWM, OUTPUT);
+
+    // Pin 7 can be used to debug timing
+    // pinMode(7, OUTPUT);
+
+    halPwmInitTimer();
+
+    // Disable interrupts to avoid timing distortion
+    // Disable Timer0 -- delay() is now not available
+    cbi(TIMSK0, TOIE0);
+
+    // Enable timer interrupt
+    sbi(TIMSK4, TOIE4);
+
+    // Disable timer interrupt
+    //cbi(TIMSK4, TOIE4);
+}
+
+#if PWM_HIGH_RESOLUTION == true
+#define HAL_PWM_TIMER_TOP PWM_HIGH_RESOLUTION_TOP
+#else
+#define HAL_PWM_TIMER_TOP 255
+#endif
+
+#define HAL_PWM_CLOCK_SELECT_MASK (_BV(CS43) | _BV(CS42) | _BV(CS41) | _BV(CS40))
+
+// At the idle rate the timer runs in fast PWM mode from 0 to TOP - 1 at CK/128: TOP timer clocks of 128 cycles
+// are 64 ticks of 2 * TOP cycles. The count only goes up, so the ticks since the overflow can be read from it.
+static_assert(HAL_PWM_IDLE_TICKS == 64, "The idle rate prescaler is CK/128");
+
+static void halPwmSetTop(uint16_t top)
+{
+    TC4H = top >> 8;
+    OCR4C = top & 0xFF;
+}
+
+void halPwmTickSetIdle(bool idle)
+{
+    if (idle) {
+        // The output pin is disconnected from the timer and stays low, the sidetone is off in idle mode
+        if (USE_PIN_13) {
+            cbi(TCCR4A, COM4A1);
+        } else {
+            cbi(TCCR4C, COM4D1);
+        }
+        halPwmSetTop(HAL_PWM_TIMER_TOP - 1);
+        cbi(TCCR4D, WGM40);
+        TCCR4B = (TCCR4B & ~HAL_PWM_CLOCK_SELECT_MASK) | _BV(PSR4) | _BV(CS43);
+    } else {
+        halPwmSetTop(HAL_PWM_TIMER_TOP);
+        sbi(TCCR4D, WGM40);
+        TCCR4B = (TCCR4B & ~HAL_PWM_CLOCK_SELECT_MASK) | _BV(PSR4) | _BV(CS40);
+        if (USE_PIN_13) {
+            sbi(TCCR4A, COM4A1);
+        } else {
+            sbi(TCCR4C, COM4D1);
+        }
+    }
+
+    // Both rates start from BOTTOM, the 8-bit compare writes of the tick rate need TC4H cleared
+    TC4H = 0;
+    TCNT4 = 0;
+    TIFR4 = _BV(TOV4);
+}
+
+static uint16_t halPwmReadCount()
+{
+    uint8_t low = TCNT4;
+    return (uint16_t) TC4H << 8 | low;
+}
+
+// The overflow flag is set when the count reaches TOP - 1. If it is pending, the count is read again,
+// so that it is not from before the overflow.
+uint8_t halPwmTickIdleElapsed()
+{
+    uint16_t count = halPwmReadCount();
+    uint8_t pending = 0;
+    if (TIFR4 & _BV(TOV4)) {
+        count = halPwmReadCount();
+        pending = HAL_PWM_IDLE_TICKS;
+    }
+
+    uint16_t position = count + 1 >= HAL_PWM_TIMER_TOP ? 0 : count + 1;
+    return pending + (uint8_t) ((uint32_t) position * HAL_PWM_IDLE_TICKS / HAL_PWM_TIMER_TOP);
+}
+
+#if RAW_HID_ENABLED == true
+
+static const uint8_t halRawHidReportDescriptor[] PROGMEM = {
+    0x06, RAW_HID_USAGE_PAGE & 0xFF, RAW_HID_USAGE_PAGE >> 8, // Usage Page (Vendor Defined)
+    0x09, RAW_HID_USAGE,                                      // Usage
+    0xA1, 0x01,                                               // Collection (Application)
+    0x85, RAW_HID_REPORT_ID,                                  //   Report ID
+    0x09, RAW_HID_USAGE,                                      //   Usage
+    0x15, 0x00,                                               //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,                                         //   Logical Maximum (255)
+    0x75, 0x08,                                               //   Report Size (8)
+    0x95, RAW_HID_REPORT_SIZE,                                //   Report Count
+    0x81, 0x02,                                               //   Input (Data, Variable, Absolute)
+    0xC0                                                      // End Collection
+};
+
+static HIDSubDescriptor halRawHidDescriptor(halRawHidReportDescriptor, sizeof(halRawHidReportDescriptor));
+
+// The descriptor has to be appended before USB enumeration starts, which is before setup() is called,
+// so it is done by a static constructor the same way as the Keyboard library does
+struct HalRawHidRegistration {
+    HalRawHidRegistration()
+    {
+        HID().AppendDescriptor(&halRawHidDescriptor);
+    }
+};
+
+static HalRawHidRegistration halRawHidRegistration;
+
+#endif
@@ -0,0 +1,279 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_HAL_AVR_H
+#define WRC_MORSE_KEY_ADAPTER_HAL_AVR_H
+
+#include <Arduino.h>
+#include <Keyboard.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+
+// The code uses pin 6 for PWM output by default, which is present on both Arduino Micro and Arduino Pro Micro.
+// It is also possible to use pin 13 in Arduino Micro by setting USE_PIN_13 to true.
+#define USE_PIN_13 false
+
+#if USE_PIN_13 == true
+#define REG_OCR OCR4A
+#define PIN_PWM 13
+#else
+#define REG_OCR OCR4D
+#define PIN_PWM 6
+#endif
+
+#ifndef cbi
+#define cbi(sfr, bit) (_SFR_BYTE(sfr) &= ~_BV(bit))
+#endif
+
+#ifndef sbi
+#define sbi(sfr, bit) (_SFR_BYTE(sfr) |= _BV(bit))
+#endif
+
+// Timer4 overflow interrupt drives the PWM tick
+#define HAL_PWM_TICK_ISR ISR(TIMER4_OVF_vect)
+
+inline void halPinModeInput(uint8_t pin)
+{
+    pinMode(pin, INPUT);
+}
+
+inline void halPinModeInputPullup(uint8_t pin)
+{
+    pinMode(pin, INPUT_PULLUP);
+}
+
+inline void halPinModeOutput(uint8_t pin)
+{
+    pinMode(pin, OUTPUT);
+}
+
+inline int halDigitalRead(uint8_t pin)
+{
+    return digitalRead(pin);
+}
+
+// With a constant port this is a single IN instruction, digitalRead() looks the port and the bit up from the
+// PROGMEM pin tables of the Arduino core and checks for a PWM timer on every call
+inline uint8_t halPortRead(uint8_t port)
+{
+    return port == HAL_PORT_B ? PINB : port == HAL_PORT_C ? PINC : port == HAL_PORT_D ? PIND
+            : port == HAL_PORT_E ? PINE : PINF;
+}
+
+// The ADC conversions are auto-triggered by the Timer4 overflow at BOTTOM (ADTS = 1000), using AVcc as
+// the reference and the ADC clock prescaler of 128 like analogRead(), which samples 259 CPU clocks later
+inline void halAdcInit()
+{
+    ADCSRB = (ADCSRB & ~(_BV(ADTS2) | _BV(ADTS1) | _BV(ADTS0))) | _BV(ADTS3);
+    ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+// Selects the analog pin of the next conversion
+inline void halAdcSelectChannel(uint8_t pin)
+{
+    uint8_t channel = analogPinToChannel(pin - A0);
+    ADMUX = _BV(REFS0) | (channel & 0x07);
+    if (channel & 0x08) {
+        sbi(ADCSRB, MUX5);
+    } else {
+        cbi(ADCSRB, MUX5);
+    }
+}
+
+inline uint16_t halAdcResult()
+{
+    return ADC;
+}
+
+#define HAL_ADC_ISR ISR(ADC_vect)
+
+inline void halAttachPinChangeInterrupt(uint8_t pin, void (*handler)())
+{
+    attachInterrupt(digitalPinToInterrupt(pin), handler, CHANGE);
+}
+
+inline void halKeyboardBegin()
+{
+    Keyboard.begin();
+}
+
+// HID is the first pluggable USB module, so its endpoint follows the CDC serial port endpoints
+#define HAL_HID_ENDPOINT (CDC_FIRST_ENDPOINT + CDC_ENPOINT_COUNT)
+
+// True if the HID endpoint bank is empty, so that sending a report does not wait for the host to poll
+inline bool halHidReady()
+{
+    return USBDevice.configured() && USB_SendSpace(HAL_HID_ENDPOINT) == USB_EP_SIZE;
+}
+
+inline void halHidSendReport(uint8_t id, const uint8_t *data, uint8_t length)
+{
+    HID().SendReport(id, data, length);
+}
+
+inline void halSerialBegin(unsigned long baud)
+{
+    Serial.begin(baud);
+}
+
+inline bool halSerialConnected()
+{
+    return Serial;
+}
+
+inline void halSerialPrintln(const char *text)
+{
+    Serial.println(text);
+}
+
+inline int halSerialAvailable()
+{
+    return Serial.available();
+}
+
+inline int halSerialPeek()
+{
+    return Serial.peek();
+}
+
+inline int halSerialRead()
+{
+    return Serial.read();
+}
+
+inline int halSerialAvailableForWrite()
+{
+    return Serial.availableForWrite();
+}
+
+inline void halSerialWrite(const uint8_t *data, size_t length)
+{
+    Serial.write(data, length);
+}
+
+void halPwmInit();
+
+// Switches Timer4 between the tick rate and one overflow per HAL_PWM_IDLE_TICKS ticks with the PWM output off.
+// Called with interrupts disabled, the idle rate from the tick interrupt at the start of a timer period.
+void halPwmTickSetIdle(bool idle);
+
+// Ticks since the last tick interrupt at the idle rate, including an overflow whose interrupt is pending.
+// Called with interrupts disabled.
+uint8_t halPwmTickIdleElapsed();
+
+// The idle sleep mode keeps the timers, the ADC and USB running, any interrupt wakes the CPU. The interrupts
+// are enabled by the instruction before the sleep, so an interrupt after the caller checked for work wakes it.
+inline void halCpuSleep()
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
+
+// Timer1 is not used otherwise, so it runs free at the CPU clock to count cycles for benchmarks
+#define HAL_CYCLE_COUNTER_UNIT "cycles"
+
+// The counter wraps after 65536 cycles, 4.1 ms
+#define HAL_CYCLE_COUNTER_WRAP_TICKS 128
+
+inline void halCycleCounterInit()
+{
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+}
+
+inline uint16_t halCycleCounterRead()
+{
+    return TCNT1;
+}
+
+inline void halPwmWrite(uint8_t value)
+{
+    REG_OCR = value;
+}
+
+// The high byte of the 10-bit compare register is written through TC4H before the low byte
+inline void halPwmWriteHighResolution(uint16_t value)
+{
+    TC4H = value >> 8;
+    REG_OCR = value;
+}
+
+inline uint8_t halInterruptsDisable()
+{
+    uint8_t state = SREG;
+    cli();
+    return state;
+}
+
+inline void halInterruptsRestore(uint8_t state)
+{
+    SREG = state;
+}
+
+// The frame number is read high byte first, again if a frame started between the reads
+inline uint16_t halUsbFrameNumber()
+{
+    uint8_t high;
+    uint8_t low;
+    do {
+        high = UDFNUMH;
+        low = UDFNUML;
+    } while (high != UDFNUMH);
+    return ((uint16_t) high << 8 | low) & 0x7FF;
+}
+
+inline void halEepromRead(uint16_t address, void *data, uint8_t length)
+{
+    eeprom_read_block(data, (const void *) address, length);
+}
+
+// A byte write takes 3.4 ms, the EEPROM is not ready until it has completed
+inline bool halEepromReady()
+{
+    return eeprom_is_ready();
+}
+
+// eeprom_update_byte() waits only for a previous write, so it returns at once when the EEPROM is ready
+inline void halEepromWriteByte(uint16_t address, uint8_t value)
+{
+    eeprom_update_byte((uint8_t *) address, value);
+}
+
+inline void halMemoryBarrier()
+{
+    __asm__ __volatile__("" ::: "memory");
+}
+
+inline void halPreemptionPoint()
+{
+}
+
+inline void halPwmTickInterruptSetEnabled(bool enabled)
+{
+    if (enabled) {
+        sbi(TIMSK4, TOIE4);
+    } else {
+        cbi(TIMSK4, TOIE4);
+    }
+}
+
+#endif
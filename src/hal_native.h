@@ -0,0 +1,145 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Host-native HAL definitions. The functions are implemented by the simulator in sim/simulator.cpp.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_HAL_NATIVE_H
+#define WRC_MORSE_KEY_ADAPTER_HAL_NATIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <string.h>
+
+#define HIGH 1
+#define LOW 0
+
+// Analog pin numbers of the ATmega32U4 Arduino variants
+#define A0 18
+#define A1 19
+
+#define KEY_LEFT_SHIFT 0x81
+#define KEY_LEFT_ALT 0x82
+
+#define PROGMEM
+#define pgm_read_byte_near(address) (*(const uint8_t *) (address))
+#define pgm_read_word_near(address) (*(const uint16_t *) (address))
+#define pgm_read_dword_near(address) (*(const uint32_t *) (address))
+#define memcpy_P(destination, source, size) memcpy(destination, source, size)
+
+typedef uint8_t byte;
+
+// The simulator calls the PWM timer tick handler once per simulated tick
+#define HAL_PWM_TICK_ISR void halPwmTickIsr()
+
+void halPwmTickIsr();
+
+// The simulator calls the ADC conversion complete handler when a triggered conversion completes
+#define HAL_ADC_ISR void halAdcIsr()
+
+void halAdcIsr();
+
+void halPinModeInput(uint8_t pin);
+
+void halPinModeInputPullup(uint8_t pin);
+
+void halPinModeOutput(uint8_t pin);
+
+int halDigitalRead(uint8_t pin);
+
+uint8_t halPortRead(uint8_t port);
+
+void halAdcInit();
+
+void halAdcSelectChannel(uint8_t pin);
+
+uint16_t halAdcResult();
+
+void halAttachPinChangeInterrupt(uint8_t pin, void (*handler)());
+
+void halKeyboardBegin();
+
+bool halHidReady();
+
+void halHidSendReport(uint8_t id, const uint8_t *data, uint8_t length);
+
+void halSerialBegin(unsigned long baud);
+
+bool halSerialConnected();
+
+void halSerialPrintln(const char *text);
+
+int halSerialAvailable();
+
+int halSerialPeek();
+
+int halSerialRead();
+
+int halSerialAvailableForWrite();
+
+void halSerialWrite(const uint8_t *data, size_t length);
+
+void halPwmInit();
+
+// The simulator counts host nanoseconds instead of CPU cycles
+#define HAL_CYCLE_COUNTER_UNIT "ns"
+
+// The counter wraps after 65.5 us, about two ticks
+#define HAL_CYCLE_COUNTER_WRAP_TICKS 2
+
+void halCycleCounterInit();
+
+uint16_t halCycleCounterRead();
+
+void halPwmWrite(uint8_t value);
+
+void halPwmWriteHighResolution(uint16_t value);
+
+void halPwmTickInterruptSetEnabled(bool enabled);
+
+// The simulator calls the tick interrupt handler once per HAL_PWM_IDLE_TICKS ticks at the idle rate
+void halPwmTickSetIdle(bool idle);
+
+uint8_t halPwmTickIdleElapsed();
+
+// The simulator runs the main loop again after the next interrupt, USB start of frame or serial input
+void halCpuSleep();
+
+// The simulator runs the interrupt handlers between the main loop iterations
+uint8_t halInterruptsDisable();
+
+void halInterruptsRestore(uint8_t state);
+
+// The simulated host sends a start of frame every millisecond of the simulated clock
+uint16_t halUsbFrameNumber();
+
+void halEepromRead(uint16_t address, void *data, uint8_t length);
+
+// The simulated EEPROM is busy for 3.4 ms of the simulated clock after a changed byte is written
+bool halEepromReady();
+
+void halEepromWriteByte(uint16_t address, uint8_t value);
+
+inline void halMemoryBarrier()
+{
+    __asm__ __volatile__("" ::: "memory");
+}
+
+void halPreemptionPoint();
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "hid_report_queue.h"
+
+HidKeyboardReport hidReportQueueReports[HID_REPORT_QUEUE_SIZE];
+uint8_t hidReportQueueHead = 0;
+uint8_t hidReportQueueTail = 0;
+
+// State after all queued reports and the last report sent
+HidKeyboardReport hidReportQueueState;
+HidKeyboardReport hidReportQueueSentState;
+
+uint32_t hidReportQueueHeadTicks = 0;
+bool hidReportQueueHeadTimedOut = false;
+
+uint8_t hidReportQueueHighWaterMarkValue = 0;
+uint32_t hidReportQueueCoalescedReportCount = 0;
+uint32_t hidReportQueueOverflowCount = 0;
+uint32_t hidReportQueueSendTimeoutCount = 0;
+
+static bool hidReportHasKey(const HidKeyboardReport *report, uint8_t usage)
+{
+    if (usage >= HID_USAGE_MODIFIER_FIRST) {
+        return (report->modifiers & (1 << (usage - HID_USAGE_MODIFIER_FIRST))) != 0;
+    }
+
+    for (uint8_t i = 0; i < HID_KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i] == usage) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns false if the report did not change, a press is ignored when all key slots are in use
+static bool hidReportSetKey(HidKeyboardReport *report, uint8_t usage, bool pressed)
+{
+    if (hidReportHasKey(report, usage) == pressed) {
+        return false;
+    }
+
+    if (usage >= HID_USAGE_MODIFIER_FIRST) {
+        report->modifiers ^= 1 << (usage - HID_USAGE_MODIFIER_FIRST);
+        return true;
+    }
+
+    for (uint8_t i = 0; i < HID_KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i] == (pressed ? 0 : usage)) {
+            report->keys[i] = pressed ? usage : 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static HidKeyboardReport *hidReportQueueAt(uint8_t index)
+{
+    return &hidReportQueueReports[index & (HID_REPORT_QUEUE_SIZE - 1)];
+}
+
+static void hidReportQueueChange(uint8_t key, bool pressed)
+{
+    uint8_t usage = hidUsageForKey(key);
+    if (usage == 0 || !hidReportSetKey(&hidReportQueueState, usage, pressed)) {
+        return;
+    }
+
+    uint8_t depth = hidReportQueueDepth();
+    if (depth > 0) {
+        HidKeyboardReport *last = hidReportQueueAt(hidReportQueueTail - 1);
+        const HidKeyboardReport *previous = depth > 1 ? hidReportQueueAt(hidReportQueueTail - 2)
+                : &hidReportQueueSentState;
+
+        if (hidReportHasKey(last, usage) == hidReportHasKey(previous, usage)) {
+            *last = hidReportQueueState;
+            hidReportQueueCoalescedReportCount++;
+            return;
+        }
+        if (depth == HID_REPORT_QUEUE_SIZE) {
+            // The intermediate state is lost, but the host still ends up with the right keys pressed
+            *last = hidReportQueueState;
+            hidReportQueueOverflowCount++;
+            return;
+        }
+    }
+
+    *hidReportQueueAt(hidReportQueueTail) = hidReportQueueState;
+    hidReportQueueTail++;
+
+    if (depth + 1 > hidReportQueueHighWaterMarkValue) {
+        hidReportQueueHighWaterMarkValue = depth + 1;
+    }
+}
+
+void hidReportQueuePress(uint8_t key)
+{
+    hidReportQueueChange(key, true);
+}
+
+void hidReportQueueRelease(uint8_t key)
+{
+    hidReportQueueChange(key, false);
+}
+
+void hidReportQueueReleaseAll()
+{
+    HidKeyboardReport empty;
+    memset(&empty, 0, sizeof(empty));
+    if (memcmp(&hidReportQueueState, &empty, sizeof(empty)) == 0) {
+        return;
+    }
+
+    if (hidReportQueueDepth() == HID_REPORT_QUEUE_SIZE) {
+        *hidReportQueueAt(hidReportQueueTail - 1) = empty;
+        hidReportQueueOverflowCount++;
+    } else {
+        *hidReportQueueAt(hidReportQueueTail) = empty;
+        hidReportQueueTail++;
+    }
+    hidReportQueueState = empty;
+}
+
+// Sends at most one report per call and only when the endpoint is free, so this never waits for the host
+void hidReportQueueDrain(uint32_t ticks)
+{
+    if (hidReportQueueHead == hidReportQueueTail) {
+        hidReportQueueHeadTicks = ticks;
+        return;
+    }
+
+    if (!halHidReady()) {
+        if (!hidReportQueueHeadTimedOut && ticks - hidReportQueueHeadTicks >= HID_REPORT_QUEUE_SEND_TIMEOUT_TICKS) {
+            hidReportQueueSendTimeoutCount++;
+            hidReportQueueHeadTimedOut = true;
+        }
+        return;
+    }
+
+    HidKeyboardReport *report = hidReportQueueAt(hidReportQueueHead);
+    halHidSendReport(HID_KEYBOARD_REPORT_ID, (const uint8_t *) report, sizeof(*report));
+    hidReportQueueSentState = *report;
+    hidReportQueueHead++;
+
+    hidReportQueueHeadTicks = ticks;
+    hidReportQueueHeadTimedOut = false;
+}
+
+uint8_t hidReportQueueDepth()
+{
+    return hidReportQueueTail - hidReportQueueHead;
+}
+
+uint8_t hidReportQueueQueuedCount()
+{
+    return hidReportQueueTail;
+}
+
+uint8_t hidReportQueueSentCount()
+{
+    return hidReportQueueHead;
+}
+
+uint8_t hidReportQueueHighWaterMark()
+{
+    return hidReportQueueHighWaterMarkValue;
+}
+
+uint32_t hidReportQueueCoalescedReports()
+{
+    return hidReportQueueCoalescedReportCount;
+}
+
+uint32_t hidReportQueueOverflows()
+{
+    return hidReportQueueOverflowCount;
+}
+
+uint32_t hidReportQueueSendTimeouts()
+{
+    return hidReportQueueSendTimeoutCount;
+}
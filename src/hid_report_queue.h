@@ -0,0 +1,132 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Outbound keyboard report queue between the keyer/PTT logic and the USB HID endpoint.
+ *
+ * Key presses and releases change the queued keyboard state and the reports are sent by
+ * hidReportQueueDrain() from the main loop only when the endpoint can take a report without
+ * waiting, so a host that is slow to poll never stalls the loop. A change is merged into the
+ * last queued report when that report does not already change the same key, so a modifier and
+ * a key pressed together take a single report, while a key pressed and released again always
+ * takes two reports and no keyed element is lost. When the queue is full, changes are merged
+ * into the last report regardless, which keeps the final state correct.
+ *
+ * The keys are given as in the Arduino Keyboard library: lowercase US layout ASCII characters
+ * or KEY_LEFT_CTRL..KEY_RIGHT_GUI for the modifiers.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_HID_REPORT_QUEUE_H
+#define WRC_MORSE_KEY_ADAPTER_HID_REPORT_QUEUE_H
+
+#include "hal.h"
+#include "dds_sine_generator.h"
+
+// Report ID of the Arduino Keyboard library report descriptor
+#define HID_KEYBOARD_REPORT_ID 2
+#define HID_KEYBOARD_REPORT_KEYS 6
+
+#define HID_KEYBOARD_MODIFIER_FIRST 0x80
+#define HID_KEYBOARD_MODIFIER_LAST 0x87
+#define HID_USAGE_MODIFIER_FIRST 0xE0
+
+// Must be a power of two
+#define HID_REPORT_QUEUE_SIZE 8
+
+// A report not taken by the host within this time is counted as a send timeout
+#define HID_REPORT_QUEUE_SEND_TIMEOUT_TICKS millisToPwmTicks(50)
+
+struct HidKeyboardReport {
+    uint8_t modifiers;
+    uint8_t reserved;
+    uint8_t keys[HID_KEYBOARD_REPORT_KEYS];
+};
+
+// HID usage of a key, 0 for characters without a key
+constexpr uint8_t hidUsageForKey(uint8_t key)
+{
+    return (key >= HID_KEYBOARD_MODIFIER_FIRST && key <= HID_KEYBOARD_MODIFIER_LAST)
+            ? HID_USAGE_MODIFIER_FIRST + key - HID_KEYBOARD_MODIFIER_FIRST
+            : (key >= 'a' && key <= 'z') ? 0x04 + key - 'a'
+            : (key >= '1' && key <= '9') ? 0x1E + key - '1'
+            : key == '0' ? 0x27
+            : key == ' ' ? 0x2C
+            : key == '-' ? 0x2D
+            : key == '=' ? 0x2E
+            : key == '[' ? 0x2F
+            : key == ']' ? 0x30
+            : key == '\\' ? 0x31
+            : key == ';' ? 0x33
+            : key == '\'' ? 0x34
+            : key == '`' ? 0x35
+            : key == ',' ? 0x36
+            : key == '.' ? 0x37
+            : key == '/' ? 0x38
+            : 0;
+}
+
+// Key of a US layout character typed with shift, the character itself for the other characters. The uppercase
+// letters are not mapped, they are typed as the lowercase ones.
+constexpr uint8_t hidUnshiftedKey(uint8_t character)
+{
+    return character == '!' ? '1'
+            : character == '@' ? '2'
+            : character == '#' ? '3'
+            : character == '$' ? '4'
+            : character == '%' ? '5'
+            : character == '^' ? '6'
+            : character == '&' ? '7'
+            : character == '*' ? '8'
+            : character == '(' ? '9'
+            : character == ')' ? '0'
+            : character == '_' ? '-'
+            : character == '+' ? '='
+            : character == '{' ? '['
+            : character == '}' ? ']'
+            : character == '|' ? '\\'
+            : character == ':' ? ';'
+            : character == '"' ? '\''
+            : character == '~' ? '`'
+            : character == '<' ? ','
+            : character == '>' ? '.'
+            : character == '?' ? '/'
+            : character;
+}
+
+void hidReportQueuePress(uint8_t key);
+
+void hidReportQueueRelease(uint8_t key);
+
+void hidReportQueueReleaseAll();
+
+void hidReportQueueDrain(uint32_t ticks);
+
+uint8_t hidReportQueueDepth();
+
+// Free-running counters of the reports queued and sent
+uint8_t hidReportQueueQueuedCount();
+
+uint8_t hidReportQueueSentCount();
+
+uint8_t hidReportQueueHighWaterMark();
+
+uint32_t hidReportQueueCoalescedReports();
+
+uint32_t hidReportQueueOverflows();
+
+uint32_t hidReportQueueSendTimeouts();
+
+#endif
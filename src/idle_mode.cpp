@@ -0,0 +1,71 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "idle_mode.h"
+
+#if IDLE_MODE_ENABLED == true
+
+#include "ticks.h"
+
+uint32_t idleModeActivityTicks = 0;
+bool idleModeEntered = false;
+uint32_t idleModeEntryCount = 0;
+
+// Set by the pin change interrupts, a bounce that has ended by the next main loop pass is activity too
+volatile bool idleModeWoken = false;
+
+void idleModeUpdate(bool active, uint32_t ticks)
+{
+    if (active || idleModeWoken) {
+        idleModeWoken = false;
+        idleModeActivityTicks = ticks;
+        if (idleModeEntered) {
+            idleModeEntered = false;
+            pwmSetIdle(false);
+        }
+        return;
+    }
+
+    if (!idleModeEntered && ticksOlderThan(idleModeActivityTicks, ticks, IDLE_MODE_TIMEOUT_TICKS)) {
+        idleModeEntered = true;
+        idleModeEntryCount++;
+        pwmSetIdle(true);
+    }
+}
+
+void idleModeWake()
+{
+    idleModeWoken = true;
+    pwmSetIdle(false);
+}
+
+void idleModeSleep()
+{
+    uint8_t state = halInterruptsDisable();
+    if (pwmIsIdle() && !idleModeWoken) {
+        halCpuSleep();
+    }
+    halInterruptsRestore(state);
+}
+
+uint32_t idleModeEntries()
+{
+    return idleModeEntryCount;
+}
+
+#endif
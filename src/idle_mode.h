@@ -0,0 +1,83 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Optional idle mode, built in with IDLE_MODE_ENABLED. When the key and PTT inputs have been released and
+ * the keyer has had nothing to key for IDLE_MODE_TIMEOUT_MILLIS, the tick interrupt is slowed down to one per
+ * HAL_PWM_IDLE_TICKS ticks (2 ms) with the sidetone output off, and the main loop sleeps between the interrupts.
+ * The ADC conversions are triggered by the timer overflow, so the potentiometers are also sampled at the slow
+ * rate. The tick counter advances by HAL_PWM_IDLE_TICKS per interrupt and getPwmTicks() adds the ticks since
+ * the interrupt from the timer count, so the timebase stays continuous.
+ *
+ * A key or PTT pin change interrupt wakes the CPU and switches the tick back to the full rate before it records
+ * the edge, so the first element is keyed at the same tick as without idle mode. Serial input wakes the CPU
+ * and the main loop leaves idle mode when the text keyer has text. The USB start of frame interrupt wakes
+ * the CPU every millisecond for a main loop pass.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_IDLE_MODE_H
+#define WRC_MORSE_KEY_ADAPTER_IDLE_MODE_H
+
+#include "hal.h"
+#include "dds_sine_generator.h"
+
+// Set to true to build in the idle mode
+#ifndef IDLE_MODE_ENABLED
+#define IDLE_MODE_ENABLED false
+#endif
+
+// Time without key, PTT or keyer activity before the idle mode is entered
+#ifndef IDLE_MODE_TIMEOUT_MILLIS
+#define IDLE_MODE_TIMEOUT_MILLIS 2000
+#endif
+
+#define IDLE_MODE_TIMEOUT_TICKS millisToPwmTicks(IDLE_MODE_TIMEOUT_MILLIS)
+
+#if IDLE_MODE_ENABLED == true
+
+// Called by the main loop with the keyer activity: enters the idle mode after the timeout, leaves it on activity
+void idleModeUpdate(bool active, uint32_t ticks);
+
+// Called first by the pin change interrupts, leaves the idle mode at once
+void idleModeWake();
+
+// Called at the end of the main loop, sleeps until the next interrupt in idle mode
+void idleModeSleep();
+
+uint32_t idleModeEntries();
+
+#else
+
+inline void idleModeUpdate(bool active, uint32_t ticks)
+{
+}
+
+inline void idleModeWake()
+{
+}
+
+inline void idleModeSleep()
+{
+}
+
+inline uint32_t idleModeEntries()
+{
+    return 0;
+}
+
+#endif
+
+#endif
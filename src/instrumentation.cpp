@@ -0,0 +1,270 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "instrumentation.h"
+
+#if INSTRUMENTATION_ENABLED == true
+
+#include "key_stream_format.h"
+#include "hid_report_queue.h"
+#include "raw_hid.h"
+#include "trace_recorder.h"
+
+// The line and its CR LF line end
+#define INSTRUMENTATION_LINE_SIZE 128
+#define INSTRUMENTATION_LINE_TEXT_SIZE (INSTRUMENTATION_LINE_SIZE - 2)
+
+volatile uint16_t instrumentationTickCycleSum = 0;
+volatile uint8_t instrumentationTickCount = 0;
+volatile uint16_t instrumentationTickCycleAverage = 0;
+volatile uint16_t instrumentationTickCycleMax = 0;
+volatile bool instrumentationTickReset = false;
+
+uint16_t instrumentationLoopStart = 0;
+uint32_t instrumentationLoopStartTicks = 0;
+uint32_t instrumentationLoopCycleSum = 0;
+uint8_t instrumentationLoopCount = 0;
+uint16_t instrumentationLoopCycleAverage = 0;
+uint16_t instrumentationLoopCycleMax = 0;
+
+uint8_t instrumentationEdgeCounts[KEY_STREAM_INPUT_MASK + 1];
+uint16_t instrumentationDebounceEdges = 0;
+uint16_t instrumentationDebounceChanges = 0;
+uint16_t instrumentationScheduleMisses = 0;
+uint16_t instrumentationTapsDropped = 0;
+
+uint16_t instrumentationLatency[2][INSTRUMENTATION_LATENCY_BUCKETS];
+
+// Edges waiting for their report: the tick, the histogram and the report or raw HID edge counter value
+// the report has been sent at
+uint32_t instrumentationPendingTicks[INSTRUMENTATION_PENDING_EDGES];
+uint8_t instrumentationPendingSent[INSTRUMENTATION_PENDING_EDGES];
+uint8_t instrumentationPendingLatency = 0;
+uint8_t instrumentationPendingRawHid = 0;
+uint8_t instrumentationPendingHead = 0;
+uint8_t instrumentationPendingTail = 0;
+
+// Line being written and the next line, 0 when there is no readout
+char instrumentationLine[INSTRUMENTATION_LINE_SIZE];
+uint8_t instrumentationLineLength = 0;
+uint8_t instrumentationLinePosition = 0;
+uint8_t instrumentationReadoutLine = 0;
+
+static void instrumentationCount(uint16_t *counter, uint16_t count)
+{
+    *counter = (uint16_t) (*counter + count) < *counter ? 0xFFFF : *counter + count;
+}
+
+void instrumentationInit()
+{
+    halCycleCounterInit();
+    instrumentationLoopStart = halCycleCounterRead();
+}
+
+void instrumentationRecordLoop(uint32_t ticks)
+{
+    uint16_t now = halCycleCounterRead();
+    // The cycle counter has wrapped if the iteration took longer than it can count
+    uint16_t cycles = ticks - instrumentationLoopStartTicks >= HAL_CYCLE_COUNTER_WRAP_TICKS ? 0xFFFF
+            : now - instrumentationLoopStart;
+    instrumentationLoopStart = now;
+    instrumentationLoopStartTicks = ticks;
+
+    if (cycles > instrumentationLoopCycleMax) {
+        instrumentationLoopCycleMax = cycles;
+    }
+    instrumentationLoopCycleSum += cycles;
+    if (++instrumentationLoopCount == INSTRUMENTATION_AVERAGE_WINDOW) {
+        instrumentationLoopCycleAverage = instrumentationLoopCycleSum / INSTRUMENTATION_AVERAGE_WINDOW;
+        instrumentationLoopCycleSum = 0;
+        instrumentationLoopCount = 0;
+    }
+}
+
+void instrumentationRecordDebounce(uint8_t input, uint8_t edgeCount, bool changed)
+{
+    uint8_t *lastEdgeCount = &instrumentationEdgeCounts[input & KEY_STREAM_INPUT_MASK];
+    instrumentationCount(&instrumentationDebounceEdges, (uint8_t) (edgeCount - *lastEdgeCount));
+    *lastEdgeCount = edgeCount;
+    if (changed) {
+        instrumentationCount(&instrumentationDebounceChanges, 1);
+    }
+}
+
+void instrumentationRecordScheduleMiss()
+{
+    instrumentationCount(&instrumentationScheduleMisses, 1);
+}
+
+void instrumentationRecordTapDropped()
+{
+    instrumentationCount(&instrumentationTapsDropped, 1);
+}
+
+void instrumentationRecordOutputEdge(uint8_t latency, uint32_t ticks)
+{
+    if ((uint8_t) (instrumentationPendingHead - instrumentationPendingTail) == INSTRUMENTATION_PENDING_EDGES) {
+        // Not measured, the reports are already late by several edges
+        return;
+    }
+
+    uint8_t index = instrumentationPendingHead & (INSTRUMENTATION_PENDING_EDGES - 1);
+    uint8_t bit = 1 << index;
+    bool rawHid = rawHidIsEnabled();
+    instrumentationPendingTicks[index] = ticks;
+    instrumentationPendingSent[index] = rawHid ? rawHidQueuedEdgeCount() : hidReportQueueQueuedCount();
+    instrumentationPendingLatency = latency == INSTRUMENTATION_LATENCY_PTT ? instrumentationPendingLatency | bit
+            : instrumentationPendingLatency & ~bit;
+    instrumentationPendingRawHid = rawHid ? instrumentationPendingRawHid | bit : instrumentationPendingRawHid & ~bit;
+    instrumentationPendingHead++;
+}
+
+static uint8_t instrumentationLatencyBucket(uint32_t ticks)
+{
+    uint8_t bucket = 0;
+    for (; ticks > 0 && bucket < INSTRUMENTATION_LATENCY_BUCKETS - 1; ticks >>= 1) {
+        bucket++;
+    }
+    return bucket;
+}
+
+void instrumentationUpdateLatency(uint32_t ticks)
+{
+    for (; instrumentationPendingTail != instrumentationPendingHead; instrumentationPendingTail++) {
+        uint8_t index = instrumentationPendingTail & (INSTRUMENTATION_PENDING_EDGES - 1);
+        uint8_t bit = 1 << index;
+        uint8_t sent = (instrumentationPendingRawHid & bit) ? rawHidSentEdgeCount() : hidReportQueueSentCount();
+        if ((int8_t) (sent - instrumentationPendingSent[index]) < 0) {
+            return;
+        }
+        uint16_t *histogram = instrumentationLatency[(instrumentationPendingLatency & bit) ? 1 : 0];
+        instrumentationCount(&histogram[instrumentationLatencyBucket(ticks - instrumentationPendingTicks[index])], 1);
+    }
+}
+
+void instrumentationStartReadout()
+{
+    if (instrumentationReadoutLine == 0) {
+        instrumentationReadoutLine = 1;
+    }
+}
+
+bool instrumentationReadingOut()
+{
+    return instrumentationReadoutLine != 0;
+}
+
+// The interrupt may update the value between the byte reads, so it is read until two reads agree
+static uint16_t instrumentationReadTickValue(volatile uint16_t *value)
+{
+    uint16_t result;
+    do {
+        result = *value;
+    } while (result != *value);
+    return result;
+}
+
+static uint8_t instrumentationFormatLatency(const char *name, uint16_t *histogram)
+{
+    uint8_t length = snprintf(instrumentationLine, INSTRUMENTATION_LINE_TEXT_SIZE, "%s latency:", name);
+    for (uint8_t i = 0; i < INSTRUMENTATION_LATENCY_BUCKETS; i++) {
+        length += snprintf(&instrumentationLine[length], INSTRUMENTATION_LINE_TEXT_SIZE - length, " %u:%u",
+                i == 0 ? 0 : 1U << (i - 1), histogram[i]);
+        histogram[i] = 0;
+    }
+    length += snprintf(&instrumentationLine[length], INSTRUMENTATION_LINE_TEXT_SIZE - length, " ticks");
+    return length;
+}
+
+// Formats a readout line and resets its values, returns the length or 0 after the last line. The line buffer
+// keeps space for the line end.
+static uint8_t instrumentationFormatLine(uint8_t line)
+{
+    int length;
+    switch (line) {
+        case 1:
+            length = snprintf(instrumentationLine, INSTRUMENTATION_LINE_TEXT_SIZE, "Loop: avg %u max %u "
+                    HAL_CYCLE_COUNTER_UNIT, instrumentationLoopCycleAverage, instrumentationLoopCycleMax);
+            instrumentationLoopCycleMax = 0;
+            return length;
+        case 2:
+            length = snprintf(instrumentationLine, INSTRUMENTATION_LINE_TEXT_SIZE, "Tick interrupt: avg %u max %u "
+                    HAL_CYCLE_COUNTER_UNIT, instrumentationReadTickValue(&instrumentationTickCycleAverage),
+                    instrumentationReadTickValue(&instrumentationTickCycleMax));
+            instrumentationTickReset = true;
+            return length;
+        case 3:
+            // An edge counted before the previous readout may be accepted after it
+            length = snprintf(instrumentationLine, INSTRUMENTATION_LINE_TEXT_SIZE, "Debounce: edges %u rejected %u",
+                    instrumentationDebounceEdges, instrumentationDebounceEdges > instrumentationDebounceChanges
+                    ? instrumentationDebounceEdges - instrumentationDebounceChanges : 0);
+            instrumentationDebounceEdges = 0;
+            instrumentationDebounceChanges = 0;
+            return length;
+        case 4:
+            length = snprintf(instrumentationLine, INSTRUMENTATION_LINE_TEXT_SIZE,
+                    "Scheduler misses: %u taps dropped %u", instrumentationScheduleMisses, instrumentationTapsDropped);
+            instrumentationScheduleMisses = 0;
+            instrumentationTapsDropped = 0;
+            return length;
+        case 5:
+            return instrumentationFormatLatency("Key", instrumentationLatency[INSTRUMENTATION_LATENCY_KEY]);
+        case 6:
+            return instrumentationFormatLatency("PTT", instrumentationLatency[INSTRUMENTATION_LATENCY_PTT]);
+        default:
+            return 0;
+    }
+}
+
+void instrumentationReadout()
+{
+    // The readout waits while the trace is dumped to the serial port
+    if (instrumentationReadoutLine == 0 || traceRecorderDumping()) {
+        return;
+    }
+
+    if (instrumentationLinePosition == instrumentationLineLength) {
+        uint8_t length = instrumentationFormatLine(instrumentationReadoutLine);
+        if (length == 0) {
+            instrumentationReadoutLine = 0;
+            instrumentationLineLength = 0;
+            instrumentationLinePosition = 0;
+            return;
+        }
+        instrumentationLine[length++] = '\r';
+        instrumentationLine[length++] = '\n';
+        instrumentationLineLength = length;
+        instrumentationLinePosition = 0;
+        instrumentationReadoutLine++;
+    }
+
+    int available = halSerialAvailableForWrite();
+    if (available <= 0) {
+        return;
+    }
+    uint8_t count = instrumentationLineLength - instrumentationLinePosition;
+    if (count > available) {
+        count = available;
+    }
+    halSerialWrite((const uint8_t *) &instrumentationLine[instrumentationLinePosition], count);
+    instrumentationLinePosition += count;
+}
+
+#endif
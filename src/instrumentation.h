@@ -0,0 +1,176 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Optional instrumentation of the hot paths, built in with INSTRUMENTATION_ENABLED: the main loop iteration time
+ * and the tick interrupt time in cycle counter units, the ticks from a key or PTT edge to the report that carries it
+ * to the host as histograms, the pin edges the debouncer rejects, the keyer elements scheduled too late to follow
+ * the previous element and the paddle taps dropped because the paddle memory was full. The values are kept in
+ * fixed-size counters and averaged over fixed windows, so they take constant memory and a few cycles per event.
+ * When disabled, the hooks are empty inline functions and compile out.
+ *
+ * Sending INSTRUMENTATION_SERIAL_COMMAND_READ to the CDC serial port prints the values as text lines, written as
+ * the serial port has space, and resets them: the values cover the time since the previous readout.
+ * The cycle counter is Timer1, which is shared with the benchmarks.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_INSTRUMENTATION_H
+#define WRC_MORSE_KEY_ADAPTER_INSTRUMENTATION_H
+
+#include "hal.h"
+
+// Set to true to build in the instrumentation
+#ifndef INSTRUMENTATION_ENABLED
+#define INSTRUMENTATION_ENABLED false
+#endif
+
+// ASCII DC4 control character
+#define INSTRUMENTATION_SERIAL_COMMAND_READ 0x14
+
+// Tick interrupts and loop iterations per average, must be a power of two. The interrupt cycles of a window
+// are summed in 16 bits.
+#define INSTRUMENTATION_AVERAGE_WINDOW 32
+
+// Latency histogram buckets: 0 ticks, then 1, 2-3, 4-7 ticks and so on, the last bucket counts 256 ticks and over
+#define INSTRUMENTATION_LATENCY_BUCKETS 10
+
+// Edges waiting for their report, must be a power of two
+#define INSTRUMENTATION_PENDING_EDGES 8
+
+#define INSTRUMENTATION_LATENCY_KEY 0
+#define INSTRUMENTATION_LATENCY_PTT 1
+
+#if INSTRUMENTATION_ENABLED == true
+
+// Written by the tick interrupt
+extern volatile uint16_t instrumentationTickCycleSum;
+extern volatile uint8_t instrumentationTickCount;
+extern volatile uint16_t instrumentationTickCycleAverage;
+extern volatile uint16_t instrumentationTickCycleMax;
+extern volatile bool instrumentationTickReset;
+
+// Called at the start of the tick interrupt, returns the start time for instrumentationTickEnd()
+inline uint16_t instrumentationTickStart()
+{
+    return halCycleCounterRead();
+}
+
+// Called at the end of the tick interrupt, the interrupt entry and exit are not included
+inline void instrumentationTickEnd(uint16_t start)
+{
+    uint16_t cycles = halCycleCounterRead() - start;
+
+    if (instrumentationTickReset) {
+        instrumentationTickReset = false;
+        instrumentationTickCycleMax = 0;
+    }
+    if (cycles > instrumentationTickCycleMax) {
+        instrumentationTickCycleMax = cycles;
+    }
+
+    uint16_t sum = instrumentationTickCycleSum + cycles;
+    uint8_t count = instrumentationTickCount + 1;
+    if (count == INSTRUMENTATION_AVERAGE_WINDOW) {
+        instrumentationTickCycleAverage = sum / INSTRUMENTATION_AVERAGE_WINDOW;
+        sum = 0;
+        count = 0;
+    }
+    instrumentationTickCycleSum = sum;
+    instrumentationTickCount = count;
+}
+
+void instrumentationInit();
+
+// Called at the start of every main loop iteration
+void instrumentationRecordLoop(uint32_t ticks);
+
+// Called with the edge count of an input (see debounce.h) after it has been debounced
+void instrumentationRecordDebounce(uint8_t input, uint8_t edgeCount, bool changed);
+
+// Called when an element following another one is scheduled after it should have started
+void instrumentationRecordScheduleMiss();
+
+// Called when a paddle tap is dropped because the paddle memory is full
+void instrumentationRecordTapDropped();
+
+// Called after the report of a key or PTT edge has been queued, the latency is measured until it is sent
+void instrumentationRecordOutputEdge(uint8_t latency, uint32_t ticks);
+
+// Measures the latency of the edges whose reports have been sent
+void instrumentationUpdateLatency(uint32_t ticks);
+
+void instrumentationStartReadout();
+
+bool instrumentationReadingOut();
+
+// Writes the readout as the serial port has space, called from the main loop
+void instrumentationReadout();
+
+#else
+
+inline uint16_t instrumentationTickStart()
+{
+    return 0;
+}
+
+inline void instrumentationTickEnd(uint16_t start)
+{
+}
+
+inline void instrumentationInit()
+{
+}
+
+inline void instrumentationRecordLoop(uint32_t ticks)
+{
+}
+
+inline void instrumentationRecordDebounce(uint8_t input, uint8_t edgeCount, bool changed)
+{
+}
+
+inline void instrumentationRecordScheduleMiss()
+{
+}
+
+inline void instrumentationRecordTapDropped()
+{
+}
+
+inline void instrumentationRecordOutputEdge(uint8_t latency, uint32_t ticks)
+{
+}
+
+inline void instrumentationUpdateLatency(uint32_t ticks)
+{
+}
+
+inline void instrumentationStartReadout()
+{
+}
+
+inline bool instrumentationReadingOut()
+{
+    return false;
+}
+
+inline void instrumentationReadout()
+{
+}
+
+#endif
+
+#endif
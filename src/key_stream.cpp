@@ -0,0 +1,80 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "key_stream.h"
+#include "trace_recorder.h"
+#include "instrumentation.h"
+
+uint8_t keyStreamFrame[KEY_STREAM_FRAME_OVERHEAD + KEY_STREAM_FRAME_MAX_RECORDS * KEY_STREAM_RECORD_SIZE];
+uint8_t keyStreamRecordCount = 0;
+uint32_t keyStreamDroppedRecordCount = 0;
+
+void keyStreamRecord(uint8_t input, bool on, uint32_t ticks)
+{
+#if KEY_STREAM_OUTPUT == true
+    if (keyStreamRecordCount == KEY_STREAM_FRAME_MAX_RECORDS) {
+        keyStreamFlush();
+        if (keyStreamRecordCount == KEY_STREAM_FRAME_MAX_RECORDS) {
+            keyStreamDroppedRecordCount++;
+            return;
+        }
+    }
+
+    uint8_t *record = &keyStreamFrame[2 + keyStreamRecordCount * KEY_STREAM_RECORD_SIZE];
+    record[0] = (input & KEY_STREAM_INPUT_MASK) | (on ? KEY_STREAM_RECORD_ON : 0);
+    record[1] = ticks;
+    record[2] = ticks >> 8;
+    record[3] = ticks >> 16;
+    record[4] = ticks >> 24;
+
+    keyStreamRecordCount++;
+#endif
+}
+
+void keyStreamFlush()
+{
+#if KEY_STREAM_OUTPUT == true
+    if (keyStreamRecordCount == 0) {
+        return;
+    }
+
+    uint8_t length = KEY_STREAM_FRAME_OVERHEAD + keyStreamRecordCount * KEY_STREAM_RECORD_SIZE;
+    if (halSerialAvailableForWrite() < length || traceRecorderDumping() || instrumentationReadingOut()) {
+        // The previous packet has not been sent yet or a trace dump or readout is being written, keep collecting
+        // records
+        return;
+    }
+
+    keyStreamFrame[0] = KEY_STREAM_FRAME_SYNC;
+    keyStreamFrame[1] = keyStreamRecordCount;
+
+    uint8_t checksum = 0;
+    for (uint8_t i = 1; i < length - 1; i++) {
+        checksum += keyStreamFrame[i];
+    }
+    keyStreamFrame[length - 1] = checksum;
+
+    halSerialWrite(keyStreamFrame, length);
+    keyStreamRecordCount = 0;
+#endif
+}
+
+uint32_t keyStreamDroppedRecords()
+{
+    return keyStreamDroppedRecordCount;
+}
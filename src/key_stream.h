@@ -0,0 +1,41 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Optional output of the debounced key and PTT edges to the USB CDC serial port as a binary
+ * stream of tick-timestamped records (see key_stream_format.h). The records are collected
+ * into a frame until the serial port can take a full frame without blocking, so edges that
+ * occur while the previous USB packet is still pending are batched into the next one.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEY_STREAM_H
+#define WRC_MORSE_KEY_ADAPTER_KEY_STREAM_H
+
+#include "hal.h"
+#include "key_stream_format.h"
+
+// Set to true to enable the key edge stream output
+#ifndef KEY_STREAM_OUTPUT
+#define KEY_STREAM_OUTPUT false
+#endif
+
+void keyStreamRecord(uint8_t input, bool on, uint32_t ticks);
+
+void keyStreamFlush();
+
+uint32_t keyStreamDroppedRecords();
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Binary key edge stream format, shared by the firmware and the host-side decoder.
+ *
+ * The stream consists of frames, each carrying one or more edge records:
+ *
+ *   KEY_STREAM_FRAME_SYNC, record count, records..., checksum
+ *
+ * Each record is KEY_STREAM_RECORD_SIZE bytes: the input identifier in the lower bits of the first byte
+ * with KEY_STREAM_RECORD_ON set for an on edge, followed by the tick of the edge as a 32-bit
+ * little-endian value. Ticks are the 31376.6 Hz (~32 us) PWM tick count of the adapter.
+ * The checksum is the 8-bit sum of the record count and the record bytes.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEY_STREAM_FORMAT_H
+#define WRC_MORSE_KEY_ADAPTER_KEY_STREAM_FORMAT_H
+
+#define KEY_STREAM_FRAME_SYNC 0xA5
+
+#define KEY_STREAM_INPUT_STRAIGHT 0
+#define KEY_STREAM_INPUT_DIT 1
+#define KEY_STREAM_INPUT_DAH 2
+#define KEY_STREAM_INPUT_PTT 3
+#define KEY_STREAM_INPUT_MASK 0x07
+
+#define KEY_STREAM_RECORD_ON 0x80
+
+#define KEY_STREAM_RECORD_SIZE 5
+
+// A frame fits in a single 64-byte USB CDC packet
+#define KEY_STREAM_FRAME_MAX_RECORDS 12
+#define KEY_STREAM_FRAME_OVERHEAD 3
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEYBOARD_DEFINITIONS_H
+#define WRC_MORSE_KEY_ADAPTER_KEYBOARD_DEFINITIONS_H
+
+#include "hal.h"
+
+// Keyboard definitions
+
+#define KEYBOARD_KEY_MODIFIER_PTT KEY_LEFT_ALT
+#define KEYBOARD_KEY_PTT_ON 'i'
+#define KEYBOARD_KEY_PTT_OFF 'o'
+
+#define KEYBOARD_KEY_STRAIGHT ','
+#define KEYBOARD_KEY_PASS_THROUGH_DIT '.'
+#define KEYBOARD_KEY_PASS_THROUGH_DAH '/'
+
+#endif
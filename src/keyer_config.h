@@ -0,0 +1,58 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEYER_CONFIG_H
+#define WRC_MORSE_KEY_ADAPTER_KEYER_CONFIG_H
+
+// Automatic keyer definitions
+
+#define KEYER_SYSTEM_VOLTAGE 5.00
+#define KEYER_ANALOG_INPUT_REFERENCE_VOLTAGE 3.20
+#define KEYER_ANALOG_INPUT_REFERENCE_MULTIPLIER (KEYER_ANALOG_INPUT_REFERENCE_VOLTAGE / KEYER_SYSTEM_VOLTAGE)
+
+#define KEYER_SPEED_WPM_MINIMUM 5
+#define KEYER_SPEED_WPM_MAXIMUM 50
+
+#define KEYER_SPEED_WPM_MINIMUM_DELTA 1
+#define KEYER_SPEED_WPM_MAXIMUM_ANALOG_VALUE (1023.0 * KEYER_ANALOG_INPUT_REFERENCE_MULTIPLIER)
+
+#define KEYER_PITCH_MINIMUM 300
+#define KEYER_PITCH_MAXIMUM 1200
+
+#define KEYER_PITCH_MINIMUM_DELTA 1
+#define KEYER_PITCH_MAXIMUM_ANALOG_VALUE (1023.0 * KEYER_ANALOG_INPUT_REFERENCE_MULTIPLIER)
+
+// Keyer modes selected by the iambic switch (see keyer_modes.h)
+
+#ifndef KEYER_MODE_SWITCH_ON
+#define KEYER_MODE_SWITCH_ON KEYER_MODE_IAMBIC_B
+#endif
+
+#ifndef KEYER_MODE_SWITCH_OFF
+#define KEYER_MODE_SWITCH_OFF KEYER_MODE_ULTIMATIC
+#endif
+
+// Maximum number of paddle taps remembered ahead of the element being keyed
+#define KEYER_TYPEAHEAD_ELEMENTS 2
+
+// Defaults
+
+#define KEYER_PITCH_DEFAULT 750.0
+#define KEYER_SPEED_WPM_DEFAULT 20
+
+#endif
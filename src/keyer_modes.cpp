@@ -0,0 +1,52 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "keyer_modes.h"
+
+#define N KEYER_ACTION_NONE
+#define I KEYER_ACTION_DIT
+#define A KEYER_ACTION_DAH
+
+// Each row lists the next action for paddles (dit, dah): none, dah, dit, both, for dit or dah pressed last
+
+PROGMEM const uint8_t keyerModeTransitionsIambic[KEYER_MODE_TRANSITION_COUNT] = {
+    // After no element: a squeeze started within a single loop pass starts with a dit
+    N, N,  A, A,  I, I,  I, I,
+    // After a dit: a squeeze alternates to a dah
+    N, N,  A, A,  I, I,  A, A,
+    // After a dah: a squeeze alternates to a dit
+    N, N,  A, A,  I, I,  I, I,
+};
+
+PROGMEM const uint8_t keyerModeTransitionsUltimatic[KEYER_MODE_TRANSITION_COUNT] = {
+    // A squeeze always sends the element of the paddle pressed last
+    N, N,  A, A,  I, I,  I, A,
+    N, N,  A, A,  I, I,  I, A,
+    N, N,  A, A,  I, I,  I, A,
+};
+
+PROGMEM const uint8_t keyerModeTransitionsBug[KEYER_MODE_TRANSITION_COUNT] = {
+    // Only the dit paddle is automatic, the dah paddle keys manually
+    N, N,  N, N,  I, I,  I, I,
+    N, N,  N, N,  I, I,  I, I,
+    N, N,  N, N,  I, I,  I, I,
+};
+
+#undef N
+#undef I
+#undef A
@@ -0,0 +1,102 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Keyer modes. Each mode is a table-driven state machine that decides the next element
+ * when the previous element and the following space are about to end:
+ *
+ * - Iambic A: squeezing the paddles sends alternating elements, releasing them stops the keyer after the
+ *   element being sent.
+ * - Iambic B: like Iambic A, but the opposite paddle held at any time during an element is remembered,
+ *   so releasing a squeeze sends one more alternating element.
+ * - Ultimatic: squeezing the paddles repeats the element of the paddle pressed last.
+ * - Bug: the dit paddle sends automatic dits and the dah paddle keys manually like a straight key.
+ *
+ * In all modes a paddle pressed while an element is being sent is remembered (paddle memory) and its element
+ * is sent next. Up to KEYER_TYPEAHEAD_ELEMENTS taps are remembered and sent in the order they were made,
+further taps are dropped and counted.
+ * The transition tables are indexed by keyerModeTransitionIndex() and the constant
+ * properties of each mode are given by KeyerModeTraits, so the keyer code is specialized for each mode
+ * at compile time.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEYER_MODES_H
+#define WRC_MORSE_KEY_ADAPTER_KEYER_MODES_H
+
+#include "hal.h"
+
+#define KEYER_MODE_IAMBIC_A 0
+#define KEYER_MODE_IAMBIC_B 1
+#define KEYER_MODE_ULTIMATIC 2
+#define KEYER_MODE_BUG 3
+#define KEYER_MODE_COUNT 4
+
+#define KEYER_ACTION_NONE 0
+#define KEYER_ACTION_DIT 1
+#define KEYER_ACTION_DAH 2
+
+// Previous action (3) * dit active (2) * dah active (2) * dah pressed last (2)
+#define KEYER_MODE_TRANSITION_COUNT 24
+
+constexpr uint8_t keyerModeTransitionIndex(uint8_t previousAction, bool ditActive, bool dahActive, bool dahPressedLast)
+{
+    return (previousAction << 3) | (ditActive << 2) | (dahActive << 1) | dahPressedLast;
+}
+
+extern const uint8_t keyerModeTransitionsIambic[KEYER_MODE_TRANSITION_COUNT] PROGMEM;
+extern const uint8_t keyerModeTransitionsUltimatic[KEYER_MODE_TRANSITION_COUNT] PROGMEM;
+extern const uint8_t keyerModeTransitionsBug[KEYER_MODE_TRANSITION_COUNT] PROGMEM;
+
+template <uint8_t Mode>
+struct KeyerModeTraits;
+
+template <>
+struct KeyerModeTraits<KEYER_MODE_IAMBIC_A> {
+    static const uint8_t *transitions() { return keyerModeTransitionsIambic; }
+    static constexpr bool squeezeMemory = false;
+    static constexpr bool manualDah = false;
+};
+
+template <>
+struct KeyerModeTraits<KEYER_MODE_IAMBIC_B> {
+    static const uint8_t *transitions() { return keyerModeTransitionsIambic; }
+    static constexpr bool squeezeMemory = true;
+    static constexpr bool manualDah = false;
+};
+
+template <>
+struct KeyerModeTraits<KEYER_MODE_ULTIMATIC> {
+    static const uint8_t *transitions() { return keyerModeTransitionsUltimatic; }
+    static constexpr bool squeezeMemory = false;
+    static constexpr bool manualDah = false;
+};
+
+template <>
+struct KeyerModeTraits<KEYER_MODE_BUG> {
+    static const uint8_t *transitions() { return keyerModeTransitionsBug; }
+    static constexpr bool squeezeMemory = false;
+    static constexpr bool manualDah = true;
+};
+
+// Returns the next action for the given transition table
+inline uint8_t keyerModeNextAction(const uint8_t *transitions, uint8_t previousAction, bool ditActive,
+        bool dahActive, bool dahPressedLast)
+{
+    return pgm_read_byte_near(transitions
+            + keyerModeTransitionIndex(previousAction, ditActive, dahActive, dahPressedLast));
+}
+
+#endif
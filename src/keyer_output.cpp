@@ -0,0 +1,43 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "keyer_output.h"
+
+volatile bool keyerOutputOn = false;
+volatile uint8_t keyerOutputEdgeCount = 0;
+volatile uint32_t keyerOutputEdgeTicks[KEYER_OUTPUT_EDGE_HISTORY];
+
+uint8_t keyerOutputReportedEdgeCount = 0;
+bool keyerOutputReportedOn = false;
+
+// Returns the next key edge not reported yet. Every edge is returned, even if an element
+// started and ended during a single loop pass. The edge tick is valid as long as the loop
+// falls behind by less than KEYER_OUTPUT_EDGE_HISTORY edges.
+bool keyerOutputPollEdge(bool *on, uint32_t *ticks)
+{
+    if (keyerOutputReportedEdgeCount == keyerOutputEdgeCount) {
+        return false;
+    }
+
+    keyerOutputReportedOn = !keyerOutputReportedOn;
+    *ticks = keyerOutputEdgeTicks[keyerOutputReportedEdgeCount & (KEYER_OUTPUT_EDGE_HISTORY - 1)];
+    keyerOutputReportedEdgeCount++;
+
+    *on = keyerOutputReportedOn;
+    return true;
+}
@@ -0,0 +1,85 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Keying output of the scheduled keyer elements. keyerOutputTick() consumes the keyer queue:
+ * it is called from the tick interrupt, so the sidetone is switched on and off exactly at
+ * the scheduled ticks. The key edges are counted and the main loop polls them with
+ * keyerOutputPollEdge() to send the matching HID key reports. The ticks of the most recent
+ * edges are kept, so the reports can carry the exact time the key was switched.
+ *
+ * In sample ring mode (see dds_sine_generator.h) the tick interrupt keys the elements the same way and
+ * pwmRefillSamples() keys the precomputed sidetone samples with keyerOutputIsKeyedAt() for the ticks
+ * they will be output at.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEYER_OUTPUT_H
+#define WRC_MORSE_KEY_ADAPTER_KEYER_OUTPUT_H
+
+#include "hal.h"
+#include "keyer_queue.h"
+#include "ticks.h"
+
+// Number of edge ticks kept for the main loop, must be a power of two
+#define KEYER_OUTPUT_EDGE_HISTORY 4
+
+extern volatile bool keyerOutputOn;
+extern volatile uint8_t keyerOutputEdgeCount;
+extern volatile uint32_t keyerOutputEdgeTicks[KEYER_OUTPUT_EDGE_HISTORY];
+
+// Returns true if a scheduled element is keyed at the given tick
+inline bool keyerOutputTick(uint32_t ticks)
+{
+    KeyerElement *element = keyerQueuePeek();
+    if (element == NULL) {
+        return false;
+    }
+
+    if (keyerOutputOn) {
+        if (ticksReached(ticks, element->endTicks)) {
+            keyerOutputOn = false;
+            keyerOutputEdgeTicks[keyerOutputEdgeCount & (KEYER_OUTPUT_EDGE_HISTORY - 1)] = ticks;
+            keyerOutputEdgeCount++;
+            keyerQueuePop();
+        }
+    } else if (ticksReached(ticks, element->startTicks)) {
+        keyerOutputOn = true;
+        keyerOutputEdgeTicks[keyerOutputEdgeCount & (KEYER_OUTPUT_EDGE_HISTORY - 1)] = ticks;
+        keyerOutputEdgeCount++;
+    }
+
+    return keyerOutputOn;
+}
+
+// Returns true if a queued element is keyed at the given tick, which must not be earlier than the current tick.
+// The queue is not consumed, so this can be called from the main loop while the tick interrupt keys the elements.
+inline bool keyerOutputIsKeyedAt(uint32_t ticks)
+{
+    for (uint8_t i = keyerQueueTail; i != keyerQueueHead; i++) {
+        const KeyerElement *element = &keyerQueueElements[i & (KEYER_QUEUE_SIZE - 1)];
+        if (!ticksReached(ticks, element->startTicks)) {
+            return false;
+        }
+        if (!ticksReached(ticks, element->endTicks)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool keyerOutputPollEdge(bool *on, uint32_t *ticks);
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "keyer_parameters.h"
+
+KeyerParameters keyerParameterBlocks[2];
+volatile uint8_t keyerParametersActive = 0;
+
+KeyerParameters *keyerParametersEdit()
+{
+    uint8_t active = keyerParametersActive;
+    KeyerParameters *parameters = &keyerParameterBlocks[active ^ 1];
+    *parameters = keyerParameterBlocks[active];
+
+    halPreemptionPoint();
+
+    return parameters;
+}
+
+void keyerParametersPublish()
+{
+    halPreemptionPoint();
+
+    // The edited block is not volatile, its writes must not be moved after the switch
+    halMemoryBarrier();
+    keyerParametersActive ^= 1;
+
+    halPreemptionPoint();
+}
@@ -0,0 +1,51 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Keyer parameter block shared by the main loop and the tick interrupt: the DDS tuning word of the
+ * sidetone pitch and the element timing of the keyer speed. The block is double-buffered. The main loop
+ * is the only writer: keyerParametersEdit() copies the published block to the other buffer for editing
+ * and keyerParametersPublish() publishes it by switching the one-byte active index. A reader always sees
+ * the parameters of a single update without masking interrupts: the tick interrupt cannot be preempted
+ * by the main loop, and the main loop only reads between its own updates.
+ *
+ * A pointer returned by keyerParameters() must not be kept across an edit.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEYER_PARAMETERS_H
+#define WRC_MORSE_KEY_ADAPTER_KEYER_PARAMETERS_H
+
+#include "hal.h"
+#include "keyer_tables.h"
+
+struct KeyerParameters {
+    uint32_t tuningWord;
+    KeyerTiming timing;
+};
+
+extern KeyerParameters keyerParameterBlocks[2];
+extern volatile uint8_t keyerParametersActive;
+
+inline const KeyerParameters *keyerParameters()
+{
+    return &keyerParameterBlocks[keyerParametersActive];
+}
+
+KeyerParameters *keyerParametersEdit();
+
+void keyerParametersPublish();
+
+#endif
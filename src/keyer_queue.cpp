@@ -0,0 +1,68 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "keyer_queue.h"
+
+KeyerElement keyerQueueElements[KEYER_QUEUE_SIZE];
+
+volatile uint8_t keyerQueueHead = 0;
+volatile uint8_t keyerQueueTail = 0;
+
+uint8_t keyerQueueMaximumDepth = 0;
+uint32_t keyerQueueOverflowCount = 0;
+
+bool keyerQueuePush(uint32_t startTicks, uint32_t endTicks, char action)
+{
+    uint8_t head = keyerQueueHead;
+    uint8_t depth = head - keyerQueueTail;
+
+    if (depth >= KEYER_QUEUE_SIZE) {
+        keyerQueueOverflowCount++;
+        return false;
+    }
+
+    KeyerElement *element = &keyerQueueElements[head & (KEYER_QUEUE_SIZE - 1)];
+    element->startTicks = startTicks;
+    element->endTicks = endTicks;
+    element->action = action;
+
+    // Publish the element only after it has been written, the element array is not volatile
+    halMemoryBarrier();
+    keyerQueueHead = head + 1;
+
+    if (depth + 1 > keyerQueueMaximumDepth) {
+        keyerQueueMaximumDepth = depth + 1;
+    }
+
+    return true;
+}
+
+uint8_t keyerQueueDepth()
+{
+    return (uint8_t) (keyerQueueHead - keyerQueueTail);
+}
+
+uint8_t keyerQueueHighWaterMark()
+{
+    return keyerQueueMaximumDepth;
+}
+
+uint32_t keyerQueueOverflows()
+{
+    return keyerQueueOverflowCount;
+}
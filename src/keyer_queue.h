@@ -0,0 +1,77 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Fixed-capacity queue of scheduled keyer elements. The keyer schedules elements into the queue
+ * and the keying output consumes them. There is a single producer and a single consumer, which
+ * only write their own index, so the queue needs no locking even if the consumer runs in
+ * interrupt context.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEYER_QUEUE_H
+#define WRC_MORSE_KEY_ADAPTER_KEYER_QUEUE_H
+
+#include "hal.h"
+
+// Must be a power of two
+#define KEYER_QUEUE_SIZE 8
+
+struct KeyerElement {
+    uint32_t startTicks;
+    uint32_t endTicks;
+    char action;
+};
+
+extern KeyerElement keyerQueueElements[KEYER_QUEUE_SIZE];
+
+// Free-running element counters, the element index is the counter modulo KEYER_QUEUE_SIZE
+extern volatile uint8_t keyerQueueHead;
+extern volatile uint8_t keyerQueueTail;
+
+// Producer
+
+bool keyerQueuePush(uint32_t startTicks, uint32_t endTicks, char action);
+
+// Consumer, inline so that it can be used in the tick interrupt
+
+inline KeyerElement *keyerQueuePeek()
+{
+    uint8_t tail = keyerQueueTail;
+    if (tail == keyerQueueHead) {
+        return NULL;
+    }
+    return &keyerQueueElements[tail & (KEYER_QUEUE_SIZE - 1)];
+}
+
+inline void keyerQueuePop()
+{
+    uint8_t tail = keyerQueueTail;
+    if (tail != keyerQueueHead) {
+        // The element must have been read before its slot is released to the producer
+        halMemoryBarrier();
+        keyerQueueTail = tail + 1;
+    }
+}
+
+// Statistics
+
+uint8_t keyerQueueDepth();
+
+uint8_t keyerQueueHighWaterMark();
+
+uint32_t keyerQueueOverflows();
+
+#endif
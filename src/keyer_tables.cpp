@@ -0,0 +1,109 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "keyer_tables.h"
+#include "keyer_config.h"
+#include "dds_sine_generator.h"
+
+// Table initializer expansion: TABLE_n(f, i) expands to f(i), f(i + 1), ..., f(i + n - 1)
+#define TABLE_4(f, i) f(i), f((i) + 1), f((i) + 2), f((i) + 3)
+#define TABLE_16(f, i) TABLE_4(f, i), TABLE_4(f, (i) + 4), TABLE_4(f, (i) + 8), TABLE_4(f, (i) + 12)
+#define TABLE_64(f, i) TABLE_16(f, i), TABLE_16(f, (i) + 16), TABLE_16(f, (i) + 32), TABLE_16(f, (i) + 48)
+#define TABLE_256(f, i) TABLE_64(f, i), TABLE_64(f, (i) + 64), TABLE_64(f, (i) + 128), TABLE_64(f, (i) + 192)
+
+#define TABLE_ANALOG(f) TABLE_256(f, 0), TABLE_256(f, 256), TABLE_64(f, 512), TABLE_64(f, 576), TABLE_16(f, 640)
+#define TABLE_SPEED_WPM(f) TABLE_16(f, 5), TABLE_16(f, 21), TABLE_4(f, 37), TABLE_4(f, 41), TABLE_4(f, 45), f(49), f(50)
+
+constexpr double keyerUnitDurationMillis(int wpm)
+{
+    // PARIS: 50 dot durations, 20 WPM -> 60ms per unit
+    // CODEX: 60 dot durations, 20 WPM -> 50ms per unit
+    return (60.0 * 20.0) / (double) wpm; // Use PARIS
+}
+
+constexpr int keyerSpeedWpmUnclamped(int value)
+{
+    return KEYER_SPEED_WPM_MINIMUM +
+           ((KEYER_SPEED_WPM_MAXIMUM - KEYER_SPEED_WPM_MINIMUM) / KEYER_SPEED_WPM_MAXIMUM_ANALOG_VALUE) *
+           (double) value;
+}
+
+constexpr double keyerPitchUnclamped(int value)
+{
+    return KEYER_PITCH_MINIMUM +
+           ((KEYER_PITCH_MAXIMUM - KEYER_PITCH_MINIMUM) / KEYER_PITCH_MAXIMUM_ANALOG_VALUE) * (double) value;
+}
+
+#define SPEED_WPM_ENTRY(value) \
+    ((uint8_t) (keyerSpeedWpmUnclamped(value) > KEYER_SPEED_WPM_MAXIMUM \
+            ? KEYER_SPEED_WPM_MAXIMUM : keyerSpeedWpmUnclamped(value)))
+
+#define TIMING_ENTRY(wpm) { \
+    (uint16_t) millisToPwmTicks(keyerUnitDurationMillis(wpm)), \
+    (uint16_t) millisToPwmTicks(keyerUnitDurationMillis(wpm) * 3.0), \
+    (uint16_t) millisToPwmTicks(keyerUnitDurationMillis(wpm)), \
+    (uint16_t) millisToPwmTicks(keyerUnitDurationMillis(wpm) / 10.0) }
+
+#define TUNING_WORD_ENTRY(value) \
+    pwmFrequencyToTuningWord(keyerPitchUnclamped(value) > KEYER_PITCH_MAXIMUM \
+            ? KEYER_PITCH_MAXIMUM : keyerPitchUnclamped(value))
+
+PROGMEM const uint8_t keyerSpeedWpmTable[] = {
+        TABLE_ANALOG(SPEED_WPM_ENTRY)
+};
+
+PROGMEM const KeyerTiming keyerTimingTable[] = {
+        TABLE_SPEED_WPM(TIMING_ENTRY)
+};
+
+PROGMEM const uint32_t keyerTuningWordTable[] = {
+        TABLE_ANALOG(TUNING_WORD_ENTRY)
+};
+
+static_assert(KEYER_SPEED_WPM_MINIMUM == 5 && KEYER_SPEED_WPM_MAXIMUM == 50, "TABLE_SPEED_WPM must cover the speed range");
+static_assert(sizeof(keyerSpeedWpmTable) == KEYER_ANALOG_TABLE_SIZE, "Invalid speed table size");
+static_assert(sizeof(keyerTimingTable) / sizeof(KeyerTiming) == KEYER_SPEED_WPM_MAXIMUM - KEYER_SPEED_WPM_MINIMUM + 1,
+        "Invalid timing table size");
+static_assert(sizeof(keyerTuningWordTable) / sizeof(uint32_t) == KEYER_ANALOG_TABLE_SIZE,
+        "Invalid tuning word table size");
+
+uint8_t keyerSpeedWpmForAnalogValue(uint16_t value)
+{
+    if (value >= KEYER_ANALOG_TABLE_SIZE) {
+        value = KEYER_ANALOG_TABLE_SIZE - 1;
+    }
+    return pgm_read_byte_near(keyerSpeedWpmTable + value);
+}
+
+void keyerTimingForSpeedWpm(uint8_t wpm, KeyerTiming *timing)
+{
+    if (wpm < KEYER_SPEED_WPM_MINIMUM) {
+        wpm = KEYER_SPEED_WPM_MINIMUM;
+    } else if (wpm > KEYER_SPEED_WPM_MAXIMUM) {
+        wpm = KEYER_SPEED_WPM_MAXIMUM;
+    }
+    memcpy_P(timing, keyerTimingTable + (wpm - KEYER_SPEED_WPM_MINIMUM), sizeof(KeyerTiming));
+}
+
+uint32_t keyerTuningWordForAnalogValue(uint16_t value)
+{
+    if (value >= KEYER_ANALOG_TABLE_SIZE) {
+        value = KEYER_ANALOG_TABLE_SIZE - 1;
+    }
+    return pgm_read_dword_near(keyerTuningWordTable + value);
+}
@@ -0,0 +1,45 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Precomputed keyer timing and DDS tuning word tables. The tables are evaluated at compile time
+ * from the same formulas the keyer used to compute at runtime with (soft-)float arithmetic,
+ * so that a potentiometer change is a constant time integer lookup from flash memory.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_KEYER_TABLES_H
+#define WRC_MORSE_KEY_ADAPTER_KEYER_TABLES_H
+
+#include "hal.h"
+
+// Number of ADC codes covered by the analog value tables: the potentiometers produce values
+// up to 1023 * KEYER_ANALOG_INPUT_REFERENCE_MULTIPLIER = 654.72, larger values are clamped
+#define KEYER_ANALOG_TABLE_SIZE 656
+
+struct KeyerTiming {
+    uint16_t ditDurationTicks;
+    uint16_t dahDurationTicks;
+    uint16_t pauseDurationTicks;
+    uint16_t scheduleAheadTicks;
+};
+
+uint8_t keyerSpeedWpmForAnalogValue(uint16_t value);
+
+void keyerTimingForSpeedWpm(uint8_t wpm, KeyerTiming *timing);
+
+uint32_t keyerTuningWordForAnalogValue(uint16_t value);
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "morse_code.h"
+
+#define C(elements) morseCode(elements)
+
+// Codes of the ASCII characters from the space to the underscore
+#define MORSE_CODE_TABLE_FIRST ' '
+#define MORSE_CODE_TABLE_SIZE 64
+
+PROGMEM const uint8_t morseCodeTable[MORSE_CODE_TABLE_SIZE] = {
+    // Space ! " # $ % & '
+    C(""), C("-.-.--"), C(".-..-."), 0, C("...-..-"), 0, C(".-..."), C(".----."),
+    // ( ) * + , - . /
+    C("-.--."), C("-.--.-"), 0, C(".-.-."), C("--..--"), C("-....-"), C(".-.-.-"), C("-..-."),
+    // 0-7
+    C("-----"), C(".----"), C("..---"), C("...--"), C("....-"), C("....."), C("-...."), C("--..."),
+    // 8 9 : ; < = > ?
+    C("---.."), C("----."), C("---..."), C("-.-.-."), 0, C("-...-"), 0, C("..--.."),
+    // @ A-G
+    C(".--.-."), C(".-"), C("-..."), C("-.-."), C("-.."), C("."), C("..-."), C("--."),
+    // H-O
+    C("...."), C(".."), C(".---"), C("-.-"), C(".-.."), C("--"), C("-."), C("---"),
+    // P-W
+    C(".--."), C("--.-"), C(".-."), C("..."), C("-"), C("..-"), C("...-"), C(".--"),
+    // X Y Z [ \ ] ^ _
+    C("-..-"), C("-.--"), C("--.."), 0, 0, 0, 0, C("..--.-"),
+};
+
+#undef C
+
+uint8_t morseCodeForCharacter(uint8_t character)
+{
+    if (character >= 'a' && character <= 'z') {
+        character -= 'a' - 'A';
+    }
+    if (character < MORSE_CODE_TABLE_FIRST || character >= MORSE_CODE_TABLE_FIRST + MORSE_CODE_TABLE_SIZE) {
+        return MORSE_CODE_NONE;
+    }
+    return pgm_read_byte_near(morseCodeTable + (character - MORSE_CODE_TABLE_FIRST));
+}
+
+uint8_t morseCharacterForCode(uint8_t code)
+{
+    if (code == MORSE_CODE_NONE) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < MORSE_CODE_TABLE_SIZE; i++) {
+        if (pgm_read_byte_near(morseCodeTable + i) == code) {
+            return MORSE_CODE_TABLE_FIRST + i;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Morse code table shared by the text keyer and the decoder. A code is a byte holding the elements from
+ * the first one in the least significant bit, dah = 1, followed by a marker bit: the code of A (.-) is 0b110.
+ * The code without elements (1) is the word space and 0 is no code.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_MORSE_CODE_H
+#define WRC_MORSE_KEY_ADAPTER_MORSE_CODE_H
+
+#include "hal.h"
+
+#define MORSE_CODE_NONE 0
+#define MORSE_CODE_WORD_SPACE 1
+
+// Elements in the longest code that fits in a byte
+#define MORSE_CODE_MAXIMUM_ELEMENTS 7
+
+constexpr uint8_t morseCode(const char *elements)
+{
+    return *elements == '\0' ? MORSE_CODE_WORD_SPACE
+            : (uint8_t) (morseCode(elements + 1) << 1 | (*elements == '-' ? 1 : 0));
+}
+
+// Lowercase letters have the codes of the uppercase letters
+uint8_t morseCodeForCharacter(uint8_t character);
+
+// Uppercase character of a code, 0 if there is none
+uint8_t morseCharacterForCode(uint8_t code);
+
+#endif
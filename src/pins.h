@@ -0,0 +1,83 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_PINS_H
+#define WRC_MORSE_KEY_ADAPTER_PINS_H
+
+#include "hal.h"
+
+// Pin definitions
+
+#define PIN_PTT 0
+
+#define PIN_KEY_RING 2
+#define PIN_KEY_TIP 3
+#define PIN_KEY_AUTOMATIC_MODE 8
+#define PIN_KEY_IAMBIC 9
+#define PIN_KEY_INVERTED 10
+
+#define PIN_ANALOG_KEYER_PITCH A0
+#define PIN_ANALOG_KEYER_SPEED A1
+
+#define PIN_STATE_KEY_ON LOW
+#define PIN_STATE_PTT_ON LOW
+
+// Port and bit of each Arduino pin number of the ATmega32U4. The Arduino Micro and the Pro Micro both use the pin
+// numbering of the Leonardo, so the map is the same for both boards.
+#define PIN_MAP(port, bit) ((port) << 4 | (bit))
+
+constexpr uint8_t pinMap[] = {
+    PIN_MAP(HAL_PORT_D, 2), PIN_MAP(HAL_PORT_D, 3), PIN_MAP(HAL_PORT_D, 1), PIN_MAP(HAL_PORT_D, 0),  // D0-D3
+    PIN_MAP(HAL_PORT_D, 4), PIN_MAP(HAL_PORT_C, 6), PIN_MAP(HAL_PORT_D, 7), PIN_MAP(HAL_PORT_E, 6),  // D4-D7
+    PIN_MAP(HAL_PORT_B, 4), PIN_MAP(HAL_PORT_B, 5), PIN_MAP(HAL_PORT_B, 6), PIN_MAP(HAL_PORT_B, 7),  // D8-D11
+    PIN_MAP(HAL_PORT_D, 6), PIN_MAP(HAL_PORT_C, 7), PIN_MAP(HAL_PORT_B, 3), PIN_MAP(HAL_PORT_B, 1),  // D12-D15
+    PIN_MAP(HAL_PORT_B, 2), PIN_MAP(HAL_PORT_B, 0), PIN_MAP(HAL_PORT_F, 7), PIN_MAP(HAL_PORT_F, 6),  // D16, D17, A0, A1
+    PIN_MAP(HAL_PORT_F, 5), PIN_MAP(HAL_PORT_F, 4), PIN_MAP(HAL_PORT_F, 1), PIN_MAP(HAL_PORT_F, 0),  // A2-A5
+};
+
+constexpr uint8_t pinPort(uint8_t pin)
+{
+    return pin < sizeof(pinMap) ? pinMap[pin] >> 4 : HAL_PORT_NONE;
+}
+
+constexpr uint8_t pinMask(uint8_t pin)
+{
+    return 1 << (pinMap[pin] & 0x07);
+}
+
+// Level of a pin in the input levels of its port
+constexpr int pinLevel(uint8_t pin, uint8_t portLevels)
+{
+    return (portLevels & pinMask(pin)) ? HIGH : LOW;
+}
+
+// Reads a pin directly from its port, resolved at compile time
+template <uint8_t Pin>
+inline int pinRead()
+{
+    static_assert(pinPort(Pin) != HAL_PORT_NONE, "Pin is not in the pin map");
+    return pinLevel(Pin, halPortRead(pinPort(Pin)));
+}
+
+// The mode switches are read from one snapshot of their port per main loop pass
+#define PIN_SWITCH_PORT pinPort(PIN_KEY_AUTOMATIC_MODE)
+
+static_assert(pinPort(PIN_KEY_IAMBIC) == PIN_SWITCH_PORT && pinPort(PIN_KEY_INVERTED) == PIN_SWITCH_PORT,
+        "The mode switches must be on the same port");
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "raw_hid.h"
+
+bool rawHidOutputEnabled = RAW_HID_ENABLED == true && RAW_HID_OUTPUT_DEFAULT == true;
+
+uint8_t rawHidState = 0;
+uint8_t rawHidSequence = 0;
+
+uint8_t rawHidEdgeRecords[RAW_HID_EDGE_BUFFER_SIZE][RAW_HID_RECORD_SIZE];
+uint8_t rawHidEdgeHead = 0;
+uint8_t rawHidEdgeTail = 0;
+
+uint32_t rawHidReportCount = 0;
+uint32_t rawHidDeferredEdgeCount = 0;
+uint32_t rawHidDroppedEdgeCount = 0;
+
+void rawHidSetEnabled(bool enabled)
+{
+#if RAW_HID_ENABLED == true
+    rawHidOutputEnabled = enabled;
+#endif
+}
+
+bool rawHidIsEnabled()
+{
+    return rawHidOutputEnabled;
+}
+
+void rawHidRecord(uint8_t output, bool on, uint32_t ticks)
+{
+    output &= RAW_HID_OUTPUT_MASK;
+    if (on) {
+        rawHidState |= 1 << output;
+    } else {
+        rawHidState &= ~(1 << output);
+    }
+
+    if ((uint8_t) (rawHidEdgeHead - rawHidEdgeTail) == RAW_HID_EDGE_BUFFER_SIZE) {
+        // The state bits of the next report are still correct, only the edge timing is lost
+        rawHidDroppedEdgeCount++;
+        return;
+    }
+
+    uint8_t *record = rawHidEdgeRecords[rawHidEdgeHead & (RAW_HID_EDGE_BUFFER_SIZE - 1)];
+    record[0] = output | (on ? RAW_HID_RECORD_ON : 0);
+    record[1] = ticks;
+    record[2] = ticks >> 8;
+    record[3] = ticks >> 16;
+    record[4] = ticks >> 24;
+
+    rawHidEdgeHead++;
+}
+
+void rawHidFlush()
+{
+#if RAW_HID_ENABLED == true
+    if (rawHidEdgeHead == rawHidEdgeTail) {
+        return;
+    }
+
+    // The host polls the endpoint once per USB frame, until then the edges are collected for the next report
+    if (!halHidReady()) {
+        return;
+    }
+
+    uint8_t report[RAW_HID_REPORT_SIZE];
+    memset(report, 0, sizeof(report));
+
+    uint8_t count = rawHidEdgeHead - rawHidEdgeTail;
+    if (count > RAW_HID_REPORT_MAX_EDGES) {
+        rawHidDeferredEdgeCount += count - RAW_HID_REPORT_MAX_EDGES;
+        count = RAW_HID_REPORT_MAX_EDGES;
+    }
+
+    // The state sent is the current one, deferred edges follow in the next report
+    report[0] = rawHidState;
+    report[1] = rawHidSequence;
+    report[2] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        memcpy(&report[RAW_HID_REPORT_HEADER_SIZE + i * RAW_HID_RECORD_SIZE],
+                rawHidEdgeRecords[(rawHidEdgeTail + i) & (RAW_HID_EDGE_BUFFER_SIZE - 1)], RAW_HID_RECORD_SIZE);
+    }
+
+    halHidSendReport(RAW_HID_REPORT_ID, report, sizeof(report));
+
+    rawHidEdgeTail += count;
+    rawHidSequence++;
+    rawHidReportCount++;
+#endif
+}
+
+uint8_t rawHidQueuedEdgeCount()
+{
+    return rawHidEdgeHead;
+}
+
+uint8_t rawHidSentEdgeCount()
+{
+    return rawHidEdgeTail;
+}
+
+uint32_t rawHidReports()
+{
+    return rawHidReportCount;
+}
+
+uint32_t rawHidDeferredEdges()
+{
+    return rawHidDeferredEdgeCount;
+}
+
+uint32_t rawHidDroppedEdges()
+{
+    return rawHidDroppedEdgeCount;
+}
@@ -0,0 +1,70 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Optional vendor-defined raw HID output (see raw_hid_format.h), an alternative to the keyboard reports.
+ * Instead of translating each edge to key presses (and the PTT to four reports), the output state
+ * is sent as packed bits together with the tick-timestamped edges. Edges are collected while the HID
+ * endpoint is busy, so at most one report is sent per USB frame and a report never waits for the endpoint.
+ *
+ * The interface is built in with RAW_HID_ENABLED. The output mode is selected at run time by sending
+ * RAW_HID_SERIAL_COMMAND_ENABLE or RAW_HID_SERIAL_COMMAND_DISABLE to the CDC serial port, the initial
+ * mode is set with RAW_HID_OUTPUT_DEFAULT.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_RAW_HID_H
+#define WRC_MORSE_KEY_ADAPTER_RAW_HID_H
+
+#include "hal.h"
+#include "raw_hid_format.h"
+
+// Set to true to add the raw HID interface to the USB device
+#ifndef RAW_HID_ENABLED
+#define RAW_HID_ENABLED false
+#endif
+
+// Set to true to start in raw HID output mode
+#ifndef RAW_HID_OUTPUT_DEFAULT
+#define RAW_HID_OUTPUT_DEFAULT false
+#endif
+
+// ASCII DC1 and DC2 control characters
+#define RAW_HID_SERIAL_COMMAND_ENABLE 0x11
+#define RAW_HID_SERIAL_COMMAND_DISABLE 0x12
+
+// Edges waiting for the next report, must be a power of two
+#define RAW_HID_EDGE_BUFFER_SIZE 16
+
+void rawHidSetEnabled(bool enabled);
+
+bool rawHidIsEnabled();
+
+void rawHidRecord(uint8_t output, bool on, uint32_t ticks);
+
+void rawHidFlush();
+
+// Free-running counters of the edges queued and sent
+uint8_t rawHidQueuedEdgeCount();
+
+uint8_t rawHidSentEdgeCount();
+
+uint32_t rawHidReports();
+
+uint32_t rawHidDeferredEdges();
+
+uint32_t rawHidDroppedEdges();
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Vendor-defined raw HID report format, shared by the firmware and the host-side decoder.
+ *
+ * The input report (RAW_HID_REPORT_SIZE bytes after the report ID) carries the current output state and
+ * the edges that led to it since the previous report:
+ *
+ *   state bits, sequence number, edge count, records...
+ *
+ * The state has bit (1 << output) set for each output that is on. The sequence number is incremented
+ * for each report, so the host can detect lost reports. Each record is RAW_HID_RECORD_SIZE bytes:
+ * the output identifier in the lower bits of the first byte with RAW_HID_RECORD_ON set for an on edge,
+ * followed by the tick of the edge as a 32-bit little-endian value. Unused records are zero.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_RAW_HID_FORMAT_H
+#define WRC_MORSE_KEY_ADAPTER_RAW_HID_FORMAT_H
+
+#define RAW_HID_USAGE_PAGE 0xFF00
+#define RAW_HID_USAGE 0x01
+
+// Report IDs 1 and 2 are used by the Arduino Mouse and Keyboard libraries
+#define RAW_HID_REPORT_ID 3
+
+// Outputs matching the keyboard keys sent in keyboard mode (see keyboard_definitions.h)
+#define RAW_HID_OUTPUT_KEY 0
+#define RAW_HID_OUTPUT_PASS_THROUGH_DIT 1
+#define RAW_HID_OUTPUT_PASS_THROUGH_DAH 2
+#define RAW_HID_OUTPUT_PTT 3
+#define RAW_HID_OUTPUT_MASK 0x07
+
+#define RAW_HID_RECORD_ON 0x80
+#define RAW_HID_RECORD_SIZE 5
+
+#define RAW_HID_REPORT_HEADER_SIZE 3
+#define RAW_HID_REPORT_MAX_EDGES 5
+#define RAW_HID_REPORT_SIZE (RAW_HID_REPORT_HEADER_SIZE + RAW_HID_REPORT_MAX_EDGES * RAW_HID_RECORD_SIZE)
+
+#endif
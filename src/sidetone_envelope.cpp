@@ -0,0 +1,172 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sidetone_envelope.h"
+
+PROGMEM const uint8_t sineEnvelope[PWM_ENVELOPE_LEVELS - 1][PWM_ENVELOPE_TABLE_SIZE] = {
+        {
+                1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+                2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+                2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+                2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1,
+                1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+        },
+        {
+                5, 5, 5, 6, 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8,
+                8, 8, 9, 9, 9, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10,
+                10, 10, 10, 10, 10, 10, 9, 9, 9, 9, 9, 9, 9, 9, 9, 8,
+                8, 8, 8, 8, 8, 7, 7, 7, 7, 6, 6, 6, 6, 6, 5, 5,
+                5, 5, 4, 4, 4, 4, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2,
+                1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1,
+                1, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 4, 4, 4, 4, 5
+        },
+        {
+                11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18,
+                18, 19, 19, 19, 20, 20, 20, 20, 21, 21, 21, 21, 21, 21, 21, 21,
+                21, 21, 21, 21, 21, 21, 21, 21, 21, 20, 20, 20, 20, 19, 19, 19,
+                18, 18, 18, 17, 17, 16, 16, 15, 15, 14, 14, 13, 13, 12, 12, 11,
+                11, 10, 10, 9, 9, 8, 8, 7, 7, 6, 6, 5, 5, 4, 4, 4,
+                3, 3, 2, 2, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3,
+                3, 4, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10
+        },
+        {
+                19, 19, 20, 21, 22, 23, 24, 25, 26, 27, 27, 28, 29, 30, 30, 31,
+                32, 32, 33, 34, 34, 35, 35, 35, 36, 36, 36, 37, 37, 37, 37, 37,
+                37, 37, 37, 37, 37, 37, 36, 36, 36, 35, 35, 35, 34, 34, 33, 32,
+                32, 31, 30, 30, 29, 28, 27, 27, 26, 25, 24, 23, 22, 21, 20, 19,
+                19, 18, 17, 16, 15, 14, 13, 12, 11, 11, 10, 9, 8, 7, 7, 6,
+                5, 5, 4, 4, 3, 3, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5,
+                5, 6, 7, 7, 8, 9, 10, 11, 11, 12, 13, 14, 15, 16, 17, 18
+        },
+        {
+                28, 30, 31, 32, 34, 35, 36, 38, 39, 40, 42, 43, 44, 45, 46, 47,
+                48, 49, 50, 51, 52, 52, 53, 54, 54, 55, 55, 56, 56, 56, 56, 56,
+                56, 56, 56, 56, 56, 56, 55, 55, 54, 54, 53, 52, 52, 51, 50, 49,
+                48, 47, 46, 45, 44, 43, 42, 40, 39, 38, 36, 35, 34, 32, 31, 30,
+                28, 27, 26, 24, 23, 21, 20, 19, 17, 16, 15, 14, 12, 11, 10, 9,
+                8, 7, 6, 6, 5, 4, 3, 3, 2, 2, 1, 1, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7,
+                8, 9, 10, 11, 12, 14, 15, 16, 17, 19, 20, 21, 23, 24, 26, 27
+        },
+        {
+                39, 41, 43, 45, 47, 49, 51, 52, 54, 56, 58, 59, 61, 63, 64, 65,
+                67, 68, 69, 71, 72, 73, 74, 75, 75, 76, 77, 77, 78, 78, 78, 78,
+                78, 78, 78, 78, 78, 77, 77, 76, 75, 75, 74, 73, 72, 71, 69, 68,
+                67, 65, 64, 63, 61, 59, 58, 56, 54, 52, 51, 49, 47, 45, 43, 41,
+                39, 37, 35, 33, 31, 30, 28, 26, 24, 23, 21, 19, 17, 16, 14, 13,
+                11, 10, 9, 8, 6, 6, 5, 4, 3, 2, 2, 1, 1, 0, 0, 0,
+                0, 0, 0, 0, 1, 1, 2, 2, 3, 4, 5, 6, 6, 8, 9, 10,
+                11, 13, 14, 16, 17, 19, 21, 23, 24, 26, 28, 30, 31, 33, 35, 37
+        },
+        {
+                51, 54, 56, 59, 61, 64, 66, 68, 71, 73, 75, 77, 80, 82, 84, 85,
+                87, 89, 91, 92, 94, 95, 96, 97, 98, 99, 100, 101, 101, 102, 102, 102,
+                102, 102, 102, 102, 101, 101, 100, 99, 98, 97, 96, 95, 94, 92, 91, 89,
+                87, 85, 84, 82, 80, 77, 75, 73, 71, 68, 66, 64, 61, 59, 56, 54,
+                51, 49, 46, 43, 41, 39, 36, 34, 31, 29, 27, 25, 23, 21, 19, 17,
+                15, 13, 12, 10, 8, 7, 6, 5, 4, 3, 2, 2, 1, 0, 0, 0,
+                0, 0, 0, 0, 1, 2, 2, 3, 4, 5, 6, 7, 8, 10, 12, 13,
+                15, 17, 19, 21, 23, 25, 27, 29, 31, 34, 36, 39, 41, 43, 46, 49
+        },
+        {
+                63, 66, 69, 73, 76, 79, 82, 85, 88, 90, 93, 96, 99, 101, 104, 106,
+                108, 110, 112, 114, 116, 118, 119, 121, 122, 123, 124, 125, 126, 126, 126, 127,
+                127, 127, 126, 126, 126, 125, 124, 123, 122, 121, 119, 118, 116, 114, 112, 110,
+                108, 106, 104, 101, 99, 96, 93, 90, 88, 85, 82, 79, 76, 73, 69, 66,
+                63, 60, 57, 54, 51, 48, 45, 42, 39, 36, 33, 31, 28, 25, 23, 21,
+                18, 16, 14, 12, 10, 9, 7, 6, 5, 3, 2, 2, 1, 0, 0, 0,
+                0, 0, 0, 0, 1, 2, 2, 3, 5, 6, 7, 9, 10, 12, 14, 16,
+                18, 21, 23, 25, 28, 31, 33, 36, 39, 42, 45, 48, 51, 54, 57, 60
+        },
+        {
+                76, 79, 83, 87, 91, 94, 98, 102, 105, 108, 112, 115, 118, 121, 124, 127,
+                130, 132, 134, 137, 139, 141, 143, 145, 146, 148, 149, 149, 151, 151, 151, 152,
+                152, 152, 151, 151, 151, 149, 149, 148, 146, 145, 143, 141, 139, 137, 134, 132,
+                130, 127, 124, 121, 118, 115, 112, 108, 105, 102, 98, 94, 91, 87, 83, 79,
+                76, 72, 69, 65, 61, 57, 54, 50, 47, 44, 40, 37, 33, 30, 27, 25,
+                22, 20, 17, 15, 13, 11, 9, 7, 6, 4, 3, 2, 1, 1, 1, 0,
+                0, 0, 1, 1, 1, 2, 3, 4, 6, 7, 9, 11, 13, 15, 17, 20,
+                22, 25, 27, 30, 33, 37, 40, 44, 47, 50, 54, 57, 61, 65, 69, 72
+        },
+        {
+                88, 92, 96, 101, 105, 109, 113, 118, 122, 125, 129, 133, 137, 140, 144, 147,
+                150, 153, 156, 158, 161, 163, 165, 167, 169, 171, 172, 173, 174, 175, 175, 176,
+                176, 176, 175, 175, 174, 173, 172, 171, 169, 167, 165, 163, 161, 158, 156, 153,
+                150, 147, 144, 140, 137, 133, 129, 125, 122, 118, 113, 109, 105, 101, 96, 92,
+                88, 84, 80, 75, 71, 66, 62, 58, 54, 50, 46, 43, 39, 35, 32, 29,
+                26, 23, 20, 17, 15, 12, 10, 8, 7, 5, 3, 3, 1, 1, 1, 0,
+                0, 0, 1, 1, 1, 3, 3, 5, 7, 8, 10, 12, 15, 17, 20, 23,
+                26, 29, 32, 35, 39, 43, 46, 50, 54, 58, 62, 66, 71, 75, 80, 84
+        },
+        {
+                99, 103, 108, 114, 118, 123, 128, 132, 137, 141, 145, 149, 154, 158, 162, 165,
+                169, 172, 175, 178, 181, 184, 186, 188, 190, 192, 194, 194, 196, 197, 197, 198,
+                198, 198, 197, 197, 196, 194, 194, 192, 190, 188, 186, 184, 181, 178, 175, 172,
+                169, 165, 162, 158, 154, 149, 145, 141, 137, 132, 128, 123, 118, 114, 108, 103,
+                99, 94, 89, 84, 79, 75, 70, 65, 61, 57, 52, 48, 44, 40, 36, 33,
+                29, 26, 23, 19, 16, 14, 12, 9, 8, 5, 4, 3, 2, 1, 1, 0,
+                0, 0, 1, 1, 2, 3, 4, 5, 8, 9, 12, 14, 16, 19, 23, 26,
+                29, 33, 36, 40, 44, 48, 52, 57, 61, 65, 70, 75, 79, 84, 89, 94
+        },
+        {
+                108, 114, 119, 125, 130, 135, 140, 145, 150, 154, 160, 164, 169, 173, 178, 181,
+                185, 189, 192, 195, 199, 201, 204, 207, 208, 211, 213, 213, 215, 216, 216, 217,
+                217, 217, 216, 216, 215, 213, 213, 211, 208, 207, 204, 201, 199, 195, 192, 189,
+                185, 181, 178, 173, 169, 164, 160, 154, 150, 145, 140, 135, 130, 125, 119, 114,
+                108, 103, 98, 92, 87, 82, 77, 72, 67, 62, 57, 53, 48, 44, 39, 36,
+                32, 28, 25, 21, 18, 15, 13, 10, 9, 6, 4, 3, 2, 1, 1, 0,
+                0, 0, 1, 1, 2, 3, 4, 6, 9, 10, 13, 15, 18, 21, 25, 28,
+                32, 36, 39, 44, 48, 53, 57, 62, 67, 72, 77, 82, 87, 92, 98, 103
+        },
+        {
+                116, 122, 127, 134, 139, 145, 150, 156, 161, 166, 171, 176, 181, 186, 190, 194,
+                199, 202, 206, 210, 213, 216, 219, 222, 223, 226, 228, 229, 231, 232, 232, 233,
+                233, 233, 232, 232, 231, 229, 228, 226, 223, 222, 219, 216, 213, 210, 206, 202,
+                199, 194, 190, 186, 181, 176, 171, 166, 161, 156, 150, 145, 139, 134, 127, 122,
+                116, 111, 105, 99, 93, 88, 82, 77, 71, 67, 61, 57, 51, 47, 42, 38,
+                34, 30, 27, 23, 19, 16, 14, 11, 9, 6, 5, 4, 2, 1, 1, 0,
+                0, 0, 1, 1, 2, 4, 5, 6, 9, 11, 14, 16, 19, 23, 27, 30,
+                34, 38, 42, 47, 51, 57, 61, 67, 71, 77, 82, 88, 93, 99, 105, 111
+        },
+        {
+                122, 128, 134, 140, 146, 152, 158, 164, 169, 174, 180, 185, 190, 195, 200, 204,
+                209, 213, 216, 220, 224, 227, 230, 233, 235, 238, 240, 240, 242, 243, 243, 244,
+                244, 244, 243, 243, 242, 240, 240, 238, 235, 233, 230, 227, 224, 220, 216, 213,
+                209, 204, 200, 195, 190, 185, 180, 174, 169, 164, 158, 152, 146, 140, 134, 128,
+                122, 116, 111, 104, 98, 92, 87, 81, 75, 70, 64, 60, 54, 49, 44, 40,
+                36, 32, 28, 24, 20, 17, 14, 12, 10, 7, 5, 4, 2, 1, 1, 0,
+                0, 0, 1, 1, 2, 4, 5, 7, 10, 12, 14, 17, 20, 24, 28, 32,
+                36, 40, 44, 49, 54, 60, 64, 70, 75, 81, 87, 92, 98, 104, 111, 116
+        },
+        {
+                126, 132, 138, 145, 151, 156, 162, 168, 174, 179, 185, 190, 196, 201, 206, 210,
+                215, 219, 223, 227, 231, 234, 237, 240, 242, 245, 247, 248, 250, 251, 251, 252,
+                252, 252, 251, 251, 250, 248, 247, 245, 242, 240, 237, 234, 231, 227, 223, 219,
+                215, 210, 206, 201, 196, 190, 185, 179, 174, 168, 162, 156, 151, 145, 138, 132,
+                126, 120, 114, 107, 101, 95, 89, 83, 77, 72, 66, 61, 55, 51, 46, 42,
+                37, 33, 29, 25, 21, 18, 15, 12, 10, 7, 5, 4, 2, 1, 1, 0,
+                0, 0, 1, 1, 2, 4, 5, 7, 10, 12, 15, 18, 21, 25, 29, 33,
+                37, 42, 46, 51, 55, 61, 66, 72, 77, 83, 89, 95, 101, 107, 114, 120
+        }
+};
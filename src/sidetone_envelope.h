@@ -0,0 +1,38 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Sidetone envelope: the sidetone is switched on and off with a raised-cosine amplitude ramp
+ * to avoid key clicks. The ramp is quantized to PWM_ENVELOPE_LEVELS amplitude levels and each
+ * intermediate level has a precomputed, amplitude-scaled copy of the sine table, so shaping a sample
+ * in the tick interrupt is a table lookup instead of a multiplication.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_SIDETONE_ENVELOPE_H
+#define WRC_MORSE_KEY_ADAPTER_SIDETONE_ENVELOPE_H
+
+#include "hal.h"
+
+// Amplitude levels of the ramp, level 0 is silence and the last level is the full sine table
+#define PWM_ENVELOPE_LEVELS 16
+
+// The scaled tables have half the resolution of the full sine table, the ramp is too short to hear the difference
+#define PWM_ENVELOPE_TABLE_SIZE 128
+
+// Level 1 to PWM_ENVELOPE_LEVELS - 1: round(sin^2(pi * level / 32) * sine256[2 * index])
+extern const uint8_t sineEnvelope[PWM_ENVELOPE_LEVELS - 1][PWM_ENVELOPE_TABLE_SIZE] PROGMEM;
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "text_keyer.h"
+#include "keyer_modes.h"
+#include "morse_code.h"
+
+static uint8_t textKeyerBuffer[TEXT_KEYER_BUFFER_SIZE];
+
+// Free-running character counters, the buffer index is the counter modulo TEXT_KEYER_BUFFER_SIZE
+static uint8_t textKeyerHead = 0;
+static uint8_t textKeyerTail = 0;
+
+// Code of the character being keyed, shifted right by each keyed element, 1 or 0 when it has been keyed
+static uint8_t textKeyerElements = 0;
+static uint8_t textKeyerSpaceUnits = 0;
+
+bool textKeyerWrite(uint8_t character)
+{
+    // Characters without a code are dropped
+    uint8_t code = morseCodeForCharacter(character);
+    if (code == MORSE_CODE_NONE) {
+        return true;
+    }
+
+    if (textKeyerAvailableForWrite() == 0) {
+        return false;
+    }
+    textKeyerBuffer[textKeyerHead & (TEXT_KEYER_BUFFER_SIZE - 1)] = code;
+    textKeyerHead++;
+
+    return true;
+}
+
+uint8_t textKeyerAvailableForWrite()
+{
+    return TEXT_KEYER_BUFFER_SIZE - (uint8_t) (textKeyerHead - textKeyerTail);
+}
+
+void textKeyerCancel()
+{
+    textKeyerTail = textKeyerHead;
+    textKeyerElements = 0;
+    textKeyerSpaceUnits = 0;
+}
+
+uint8_t textKeyerPeek(uint8_t *spaceUnits)
+{
+    while (textKeyerElements <= 1) {
+        if (textKeyerTail == textKeyerHead) {
+            return KEYER_ACTION_NONE;
+        }
+        textKeyerElements = textKeyerBuffer[textKeyerTail & (TEXT_KEYER_BUFFER_SIZE - 1)];
+        textKeyerTail++;
+
+        if (textKeyerElements == MORSE_CODE_WORD_SPACE) {
+            textKeyerSpaceUnits = TEXT_KEYER_WORD_SPACE_UNITS;
+        }
+    }
+
+    *spaceUnits = textKeyerSpaceUnits;
+    return (textKeyerElements & 1) ? KEYER_ACTION_DAH : KEYER_ACTION_DIT;
+}
+
+void textKeyerPop()
+{
+    if (textKeyerElements <= 1) {
+        return;
+    }
+
+    textKeyerElements >>= 1;
+    textKeyerSpaceUnits = textKeyerElements == 1 ? TEXT_KEYER_CHARACTER_SPACE_UNITS : 0;
+}
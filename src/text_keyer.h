@@ -0,0 +1,60 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Streaming text-to-Morse encoder of the text keyer. Characters received from the CDC serial port are
+ * buffered as Morse codes and the keyer takes the elements one at a time, so the text is keyed by the same
+ * scheduler and with the same timing as the paddles. Pressing a paddle cancels the buffered text.
+ *
+ * The text keyer is built in with TEXT_KEYER_ENABLED. Letters, digits and the usual punctuation are keyed,
+ * a space is a word space and other characters are ignored. TEXT_KEYER_SERIAL_COMMAND_CANCEL clears the buffer.
+ * The text is keyed only in automatic key mode, the main loop drops it in the other modes.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_TEXT_KEYER_H
+#define WRC_MORSE_KEY_ADAPTER_TEXT_KEYER_H
+
+#include "hal.h"
+
+// Set to true to key the text received from the serial port in automatic key mode
+#ifndef TEXT_KEYER_ENABLED
+#define TEXT_KEYER_ENABLED false
+#endif
+
+// ASCII CAN control character
+#define TEXT_KEYER_SERIAL_COMMAND_CANCEL 0x18
+
+// Buffered characters, must be a power of two
+#define TEXT_KEYER_BUFFER_SIZE 64
+
+// Spaces in dit durations in addition to the pause between the elements of a character
+#define TEXT_KEYER_CHARACTER_SPACE_UNITS 2
+#define TEXT_KEYER_WORD_SPACE_UNITS 6
+
+// Buffers a character, returns false if the buffer is full
+bool textKeyerWrite(uint8_t character);
+
+uint8_t textKeyerAvailableForWrite();
+
+void textKeyerCancel();
+
+// Next element of the buffered text (KEYER_ACTION_NONE if there is none) and the space before it
+// in dit durations in addition to the pause between elements
+uint8_t textKeyerPeek(uint8_t *spaceUnits);
+
+void textKeyerPop();
+
+#endif
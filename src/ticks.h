@@ -0,0 +1,51 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Wraparound-safe tick arithmetic. The PWM tick counter is 32 bits at 31376.6 Hz, so it wraps
+ * every 38 hours. Ticks are compared by the sign of their difference (serial number arithmetic),
+ * which is correct as long as the compared ticks are less than 2^31 ticks (19 hours) apart.
+ * Ticks stored for a long time, such as the end of the last keyer element, are kept within
+ * TICKS_MAXIMUM_AGE of the current tick with ticksOlderThan().
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_TICKS_H
+#define WRC_MORSE_KEY_ADAPTER_TICKS_H
+
+#include "hal.h"
+
+// Half of the wraparound-safe distance, 9.5 hours
+#define TICKS_MAXIMUM_AGE 0x40000000UL
+
+// Returns true if tick a is before tick b
+inline bool ticksBefore(uint32_t a, uint32_t b)
+{
+    return (int32_t) (a - b) < 0;
+}
+
+// Returns true if the given tick is at or after the deadline
+inline bool ticksReached(uint32_t ticks, uint32_t deadline)
+{
+    return (int32_t) (ticks - deadline) >= 0;
+}
+
+// Returns true if the given past tick is more than age ticks before now
+inline bool ticksOlderThan(uint32_t ticks, uint32_t now, uint32_t age)
+{
+    return (int32_t) (now - ticks) > (int32_t) age;
+}
+
+#endif
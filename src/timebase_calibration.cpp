@@ -0,0 +1,230 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "timebase_calibration.h"
+
+#if TIMEBASE_CALIBRATION_ENABLED == true
+
+#include "dds_sine_generator.h"
+
+// Frame number and tick of the previous poll, and the tick the frame number last changed at
+uint16_t timebaseCalibrationFrame = 0;
+uint32_t timebaseCalibrationPollTicks = 0;
+uint32_t timebaseCalibrationFrameTicks = 0;
+
+// Frame number change the window started at and the frames since it
+bool timebaseCalibrationWindowStarted = false;
+uint32_t timebaseCalibrationWindowTicks = 0;
+uint16_t timebaseCalibrationWindowFrames = 0;
+
+uint16_t timebaseCalibrationWindowCount = 0;
+int32_t timebaseCalibrationEstimatePpm = 0;
+
+// Estimate the timing and tuning word corrections are computed for: the timing correction in ppm relative to
+// the tick rate of millisToPwmTicks() and the tuning word scale as a 1.31 fixed-point value
+int32_t timebaseCalibrationAppliedPpm = 0;
+int32_t timebaseCalibrationTimingPpm = 0;
+uint32_t timebaseCalibrationTuningScale = 0;
+
+#if TIMEBASE_CALIBRATION_EEPROM == true
+bool timebaseCalibrationStored = false;
+int32_t timebaseCalibrationStoredPpm = 0;
+
+// Record being stored and the index of its next byte, the record size when none is
+uint8_t timebaseCalibrationStoreRecord[TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE];
+uint8_t timebaseCalibrationStoreIndex = TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE;
+
+static uint8_t timebaseCalibrationChecksum(const uint8_t *record)
+{
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE - 1; i++) {
+        sum += record[i];
+    }
+    return ~sum;
+}
+#endif
+
+// Computes the corrections once per change, the lookups only multiply
+static void timebaseCalibrationApply(int32_t ppm)
+{
+    double rate = 1.0 + ppm / 1000000.0;
+    double timingScale = rate * REFCLK / millisToPwmTicks(1000);
+    timebaseCalibrationAppliedPpm = ppm;
+    timebaseCalibrationTimingPpm = (int32_t) ((timingScale - 1.0) * 1000000.0 + (timingScale < 1.0 ? -0.5 : 0.5));
+    timebaseCalibrationTuningScale = (uint32_t) (2147483648.0 / rate + 0.5);
+}
+
+void timebaseCalibrationInit()
+{
+    int32_t ppm = 0;
+
+#if TIMEBASE_CALIBRATION_EEPROM == true
+    uint8_t record[TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE];
+    halEepromRead(TIMEBASE_CALIBRATION_EEPROM_ADDRESS, record, sizeof(record));
+    if (record[0] == TIMEBASE_CALIBRATION_EEPROM_MAGIC
+            && record[TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE - 1] == timebaseCalibrationChecksum(record)) {
+        int32_t stored = (int32_t) ((uint32_t) record[1] | (uint32_t) record[2] << 8 | (uint32_t) record[3] << 16
+                | (uint32_t) record[4] << 24);
+        if (stored >= -TIMEBASE_CALIBRATION_PPM_MAXIMUM && stored <= TIMEBASE_CALIBRATION_PPM_MAXIMUM) {
+            ppm = stored;
+            timebaseCalibrationStored = true;
+            timebaseCalibrationStoredPpm = stored;
+        }
+    }
+#endif
+
+    timebaseCalibrationEstimatePpm = ppm;
+    timebaseCalibrationApply(ppm);
+    timebaseCalibrationFrame = halUsbFrameNumber();
+}
+
+// Updates the estimate with a window, returns true if the corrections changed
+static bool timebaseCalibrationMeasure(uint32_t ticks, uint16_t frames)
+{
+    double expectedTicks = frames * (REFCLK / 1000.0);
+    double ppm = (ticks - expectedTicks) * 1000000.0 / expectedTicks;
+    if (ppm < -TIMEBASE_CALIBRATION_PPM_MAXIMUM || ppm > TIMEBASE_CALIBRATION_PPM_MAXIMUM) {
+        return false;
+    }
+    int32_t measured = (int32_t) (ppm + (ppm < 0 ? -0.5 : 0.5));
+
+    int32_t estimate = timebaseCalibrationEstimatePpm;
+    if (timebaseCalibrationWindowCount == 0) {
+        estimate = measured;
+    } else {
+        estimate += (measured - estimate) / (1 << TIMEBASE_CALIBRATION_FILTER_SHIFT);
+    }
+    timebaseCalibrationEstimatePpm = estimate;
+    if (timebaseCalibrationWindowCount < 0xFFFF) {
+        timebaseCalibrationWindowCount++;
+    }
+
+    int32_t change = estimate - timebaseCalibrationAppliedPpm;
+    if (change > -TIMEBASE_CALIBRATION_APPLY_PPM && change < TIMEBASE_CALIBRATION_APPLY_PPM) {
+        return false;
+    }
+    timebaseCalibrationApply(estimate);
+    return true;
+}
+
+bool timebaseCalibrationUpdate(uint32_t ticks)
+{
+    uint16_t frame = halUsbFrameNumber();
+    uint32_t pollTicks = timebaseCalibrationPollTicks;
+    timebaseCalibrationPollTicks = ticks;
+    if (frame == timebaseCalibrationFrame) {
+        if (ticks - timebaseCalibrationFrameTicks > TIMEBASE_CALIBRATION_GAP_TICKS) {
+            timebaseCalibrationWindowStarted = false;
+        }
+        return false;
+    }
+
+    uint16_t frames = (frame - timebaseCalibrationFrame) & 0x7FF;
+    timebaseCalibrationFrame = frame;
+    if (ticks - timebaseCalibrationFrameTicks > TIMEBASE_CALIBRATION_GAP_TICKS) {
+        timebaseCalibrationWindowStarted = false;
+    }
+    timebaseCalibrationFrameTicks = ticks;
+
+    // The frame started between the previous poll and this one
+    bool edge = frames == 1 && ticks - pollTicks <= TIMEBASE_CALIBRATION_EDGE_TICKS;
+
+    bool changed = false;
+    if (timebaseCalibrationWindowStarted) {
+        timebaseCalibrationWindowFrames += frames;
+        if (timebaseCalibrationWindowFrames < TIMEBASE_CALIBRATION_WINDOW_FRAMES || !edge) {
+            return false;
+        }
+        changed = timebaseCalibrationMeasure(ticks - timebaseCalibrationWindowTicks,
+                timebaseCalibrationWindowFrames);
+    }
+
+    // The end of a window starts the next one
+    timebaseCalibrationWindowStarted = edge;
+    timebaseCalibrationWindowTicks = ticks;
+    timebaseCalibrationWindowFrames = 0;
+    return changed;
+}
+
+void timebaseCalibrationStore(bool idle)
+{
+#if TIMEBASE_CALIBRATION_EEPROM == true
+    // A byte per call, the loop never waits for a write to complete. The checksum byte is written last,
+    // so a record cut short by a reset is not loaded.
+    if (timebaseCalibrationStoreIndex < TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE) {
+        if (halEepromReady()) {
+            halEepromWriteByte(TIMEBASE_CALIBRATION_EEPROM_ADDRESS + timebaseCalibrationStoreIndex,
+                    timebaseCalibrationStoreRecord[timebaseCalibrationStoreIndex]);
+            timebaseCalibrationStoreIndex++;
+        }
+        return;
+    }
+
+    if (!idle || timebaseCalibrationWindowCount < TIMEBASE_CALIBRATION_STORE_WINDOWS) {
+        return;
+    }
+    int32_t ppm = timebaseCalibrationEstimatePpm;
+    int32_t change = ppm - timebaseCalibrationStoredPpm;
+    if (timebaseCalibrationStored && change > -TIMEBASE_CALIBRATION_STORE_PPM
+            && change < TIMEBASE_CALIBRATION_STORE_PPM) {
+        return;
+    }
+
+    uint8_t *record = timebaseCalibrationStoreRecord;
+    record[0] = TIMEBASE_CALIBRATION_EEPROM_MAGIC;
+    for (uint8_t i = 0; i < 4; i++) {
+        record[1 + i] = (uint32_t) ppm >> (8 * i);
+    }
+    record[TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE - 1] = timebaseCalibrationChecksum(record);
+    timebaseCalibrationStoreIndex = 0;
+
+    timebaseCalibrationStored = true;
+    timebaseCalibrationStoredPpm = ppm;
+#endif
+}
+
+int32_t timebaseCalibrationPpm()
+{
+    return timebaseCalibrationEstimatePpm;
+}
+
+uint16_t timebaseCalibrationWindows()
+{
+    return timebaseCalibrationWindowCount;
+}
+
+static uint16_t timebaseCalibrateTicks(uint16_t ticks)
+{
+    int32_t correction = (int32_t) ticks * timebaseCalibrationTimingPpm;
+    return ticks + (correction + (correction < 0 ? -500000 : 500000)) / 1000000;
+}
+
+void timebaseCalibrateTiming(KeyerTiming *timing)
+{
+    timing->ditDurationTicks = timebaseCalibrateTicks(timing->ditDurationTicks);
+    timing->dahDurationTicks = timebaseCalibrateTicks(timing->dahDurationTicks);
+    timing->pauseDurationTicks = timebaseCalibrateTicks(timing->pauseDurationTicks);
+    timing->scheduleAheadTicks = timebaseCalibrateTicks(timing->scheduleAheadTicks);
+}
+
+uint32_t timebaseCalibrateTuningWord(uint32_t tuningWord)
+{
+    return ((uint64_t) tuningWord * timebaseCalibrationTuningScale) >> 31;
+}
+
+#endif
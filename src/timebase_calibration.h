@@ -0,0 +1,136 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Optional calibration of the tick rate against the USB start of frame clock, built in with
+ * TIMEBASE_CALIBRATION_ENABLED. The host sends a start of frame every millisecond with the accuracy of its
+ * crystal, while the Timer4 tick of a board with a ceramic resonator may be off by a few thousand ppm from
+ * the REFCLK measured on one board. The main loop polls the USB frame number and counts the ticks over
+ * windows of TIMEBASE_CALIBRATION_WINDOW_FRAMES frames, between frame number changes seen within a tick of
+ * the previous poll. The tick rate error is averaged over the windows and the element timing (computed for
+ * 31250 Hz by millisToPwmTicks()) and the DDS tuning words (computed for REFCLK) are corrected for it when they
+ * are looked up. Until the first window completes, the tick rate is taken to be REFCLK.
+ *
+ * With TIMEBASE_CALIBRATION_EEPROM the estimate is stored to the EEPROM while the keyer is idle, so that an
+ * adapter keys at the right speed and pitch from power-up also without a host, and is stored again when it
+ * drifts by TIMEBASE_CALIBRATION_STORE_PPM.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_TIMEBASE_CALIBRATION_H
+#define WRC_MORSE_KEY_ADAPTER_TIMEBASE_CALIBRATION_H
+
+#include "hal.h"
+#include "keyer_tables.h"
+
+// Set to true to build in the calibration
+#ifndef TIMEBASE_CALIBRATION_ENABLED
+#define TIMEBASE_CALIBRATION_ENABLED false
+#endif
+
+// Set to true to store the calibration to the EEPROM
+#ifndef TIMEBASE_CALIBRATION_EEPROM
+#define TIMEBASE_CALIBRATION_EEPROM false
+#endif
+
+// USB frames per measurement window, 8.2 s: a tick of uncertainty at both ends is 8 ppm
+#define TIMEBASE_CALIBRATION_WINDOW_FRAMES 8192
+
+// Ticks between the polls before and after a frame number change for the change to start or end a window
+#define TIMEBASE_CALIBRATION_EDGE_TICKS 1
+
+// A window is restarted if the frame number has not changed for this long: the host suspended or reset the bus,
+// or the main loop did not run
+#define TIMEBASE_CALIBRATION_GAP_TICKS millisToPwmTicks(100)
+
+// Tick rate errors over this are not accepted as measurements
+#define TIMEBASE_CALIBRATION_PPM_MAXIMUM 20000
+
+// The estimate is the average of the windows with weight 1 / 2^TIMEBASE_CALIBRATION_FILTER_SHIFT for the last
+// window, and the timing and tuning words are recomputed when it changes by TIMEBASE_CALIBRATION_APPLY_PPM
+#define TIMEBASE_CALIBRATION_FILTER_SHIFT 2
+#define TIMEBASE_CALIBRATION_APPLY_PPM 5
+
+// EEPROM record: a magic byte, the estimate in ppm as a 32-bit little-endian value and a checksum
+#define TIMEBASE_CALIBRATION_EEPROM_ADDRESS 0
+#define TIMEBASE_CALIBRATION_EEPROM_MAGIC 0xC5
+#define TIMEBASE_CALIBRATION_EEPROM_RECORD_SIZE 6
+
+// The estimate is stored after this many windows, and again when it has changed by TIMEBASE_CALIBRATION_STORE_PPM
+#define TIMEBASE_CALIBRATION_STORE_WINDOWS 4
+#define TIMEBASE_CALIBRATION_STORE_PPM 20
+
+#if TIMEBASE_CALIBRATION_ENABLED == true
+
+// Loads the stored estimate, called before the keyer timing and the tuning word are set
+void timebaseCalibrationInit();
+
+// Polls the USB frame number, called at the start of every main loop iteration. Returns true when the estimate
+// has changed and the keyer timing and the tuning word have to be looked up again.
+bool timebaseCalibrationUpdate(uint32_t ticks);
+
+// Starts storing a changed estimate to the EEPROM if the keyer is idle, and writes the next byte of the record
+// being stored when the EEPROM is ready, called once per main loop iteration
+void timebaseCalibrationStore(bool idle);
+
+// Estimated tick rate error relative to REFCLK in ppm
+int32_t timebaseCalibrationPpm();
+
+// Measurement windows completed
+uint16_t timebaseCalibrationWindows();
+
+// Corrects the element timing computed for the nominal tick rate of millisToPwmTicks()
+void timebaseCalibrateTiming(KeyerTiming *timing);
+
+// Corrects a tuning word computed for REFCLK
+uint32_t timebaseCalibrateTuningWord(uint32_t tuningWord);
+
+#else
+
+inline void timebaseCalibrationInit()
+{
+}
+
+inline bool timebaseCalibrationUpdate(uint32_t ticks)
+{
+    return false;
+}
+
+inline void timebaseCalibrationStore(bool idle)
+{
+}
+
+inline int32_t timebaseCalibrationPpm()
+{
+    return 0;
+}
+
+inline uint16_t timebaseCalibrationWindows()
+{
+    return 0;
+}
+
+inline void timebaseCalibrateTiming(KeyerTiming *timing)
+{
+}
+
+inline uint32_t timebaseCalibrateTuningWord(uint32_t tuningWord)
+{
+    return tuningWord;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Binary trace dump format, shared by the firmware and the host-side decoder (see trace_recorder.h).
+ *
+ * The trace is a sequence of TRACE_RECORD_SIZE byte records: the event type in the upper four bits of the
+ * first byte and its argument in the lower four bits, followed by a 16-bit little-endian value. For the timed
+ * events the value is the signed difference of the tick of the event to the tick of the previous timed event.
+ * A difference too large for 16 bits is preceded by a TRACE_EVENT_GAP record, whose value is the rest of the
+ * difference in units of 1 << TRACE_GAP_SHIFT ticks. TRACE_EVENT_VALUE records carry the value of the event
+ * before them and TRACE_EVENT_MISSED records the number of events that were not recorded during a dump.
+ *
+ * The dump is sent as:
+ *
+ *   TRACE_DUMP_SYNC, TRACE_DUMP_VERSION, record count (16 bits), start ticks (32 bits), end ticks (32 bits),
+ *   start flags, start pin levels, start switches, start keyer mode, start speed (16 bits), records..., checksum
+ *
+ * The start state is the state before the first record: the tick the first difference is counted from,
+ * TRACE_START_OVERWRITTEN if the trace does not begin at the start of the firmware, the pin levels
+ * (bit 1 << input set for a high pin), the switches, the keyer mode and the raw speed potentiometer value.
+ * The end ticks is the tick the dump was requested at. All values are little-endian and the checksum is
+ * the 8-bit sum of the bytes after the sync byte.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_TRACE_FORMAT_H
+#define WRC_MORSE_KEY_ADAPTER_TRACE_FORMAT_H
+
+#define TRACE_DUMP_SYNC 0xA6
+#define TRACE_DUMP_VERSION 1
+#define TRACE_DUMP_HEADER_SIZE 18
+#define TRACE_DUMP_OVERHEAD (TRACE_DUMP_HEADER_SIZE + 1)
+
+#define TRACE_RECORD_SIZE 3
+
+#define TRACE_EVENT_TYPE_MASK 0xF0
+#define TRACE_EVENT_ARGUMENT_MASK 0x0F
+
+#define TRACE_EVENT_GAP 0x00
+// Pin edge seen by the debouncer, the argument is the input (as in key_stream_format.h) and TRACE_PIN_HIGH
+#define TRACE_EVENT_PIN 0x10
+// Debounced change, the argument is the input and TRACE_ON
+#define TRACE_EVENT_DEBOUNCED 0x20
+// Keyer element scheduled to start at the tick of the event, the argument is the keyer action
+#define TRACE_EVENT_ELEMENT 0x30
+// Key or PTT output edge sent to the host, the argument is the output (as in raw_hid_format.h) and TRACE_ON
+#define TRACE_EVENT_OUTPUT 0x40
+// Switch states, the argument has the TRACE_SWITCH_ bits of the switches that are on
+#define TRACE_EVENT_SWITCHES 0x50
+#define TRACE_EVENT_MODE 0x60
+// Speed potentiometer change, followed by the raw value
+#define TRACE_EVENT_SPEED 0x70
+// Byte read from the serial port, followed by the byte
+#define TRACE_EVENT_SERIAL 0x80
+#define TRACE_EVENT_MISSED 0xE0
+#define TRACE_EVENT_VALUE 0xF0
+
+#define TRACE_INPUT_MASK 0x07
+#define TRACE_PIN_HIGH 0x08
+#define TRACE_ON 0x08
+
+#define TRACE_SWITCH_AUTOMATIC 0x01
+#define TRACE_SWITCH_IAMBIC 0x02
+#define TRACE_SWITCH_INVERTED 0x04
+
+#define TRACE_START_OVERWRITTEN 0x01
+
+#define TRACE_GAP_SHIFT 15
+
+#endif
@@ -0,0 +1,310 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "trace_recorder.h"
+
+uint8_t traceEvents[TRACE_RECORDER_SIZE];
+uint16_t traceValues[TRACE_RECORDER_SIZE];
+uint16_t traceFirst = 0;
+uint16_t traceCount = 0;
+uint32_t traceRecordNumber = 0;
+
+// Tick of the last timed record and the state before the first record
+uint32_t traceLastTicks = 0;
+TraceState traceStart = {0, 0, 0, 0, 0, 0};
+
+// Edge counts of the inputs already recorded and the last recorded switch states
+uint8_t traceEdgeCounts[TRACE_INPUT_MASK + 1];
+uint8_t traceSwitches = 0;
+
+// Events not recorded while dumping
+uint16_t traceMissedEvents = 0;
+
+bool traceDumping = false;
+uint16_t traceDumpPosition = 0;
+uint8_t traceDumpChecksum = 0;
+uint8_t traceDumpHeader[TRACE_DUMP_HEADER_SIZE];
+
+void traceRecorderInit(uint32_t ticks)
+{
+#if TRACE_RECORDER_ENABLED == true
+    traceFirst = 0;
+    traceCount = 0;
+    traceLastTicks = ticks;
+    traceStart.ticks = ticks;
+    traceStart.flags = 0;
+    // The keys and the PTT are released by the pull-ups
+    traceStart.pins = 0xFF;
+    traceStart.switches = 0;
+    traceStart.mode = 0;
+    traceStart.speed = 0;
+    // Not a valid combination, so the first switch states are recorded
+    traceSwitches = 0xFF;
+    traceMissedEvents = 0;
+    traceDumping = false;
+#endif
+}
+
+#if TRACE_RECORDER_ENABLED == true
+// Folds the oldest record, and the values following it, into the start state
+static void traceDropOldest()
+{
+    uint8_t droppedType = TRACE_EVENT_VALUE;
+    do {
+        uint8_t event = traceEvents[traceFirst];
+        uint16_t value = traceValues[traceFirst];
+        traceFirst = (traceFirst + 1) & (TRACE_RECORDER_SIZE - 1);
+        traceCount--;
+        traceStart.flags = TRACE_START_OVERWRITTEN;
+
+        uint8_t type = event & TRACE_EVENT_TYPE_MASK;
+        uint8_t argument = event & TRACE_EVENT_ARGUMENT_MASK;
+        switch (type) {
+            case TRACE_EVENT_GAP:
+                traceStart.ticks += (uint32_t) value << TRACE_GAP_SHIFT;
+                break;
+            case TRACE_EVENT_VALUE:
+                if (droppedType == TRACE_EVENT_SPEED) {
+                    traceStart.speed = value;
+                }
+                break;
+            case TRACE_EVENT_MISSED:
+                break;
+            default:
+                traceStart.ticks += (int16_t) value;
+                if (type == TRACE_EVENT_PIN) {
+                    uint8_t mask = 1 << (argument & TRACE_INPUT_MASK);
+                    traceStart.pins = (argument & TRACE_PIN_HIGH) ? traceStart.pins | mask : traceStart.pins & ~mask;
+                } else if (type == TRACE_EVENT_SWITCHES) {
+                    traceStart.switches = argument;
+                } else if (type == TRACE_EVENT_MODE) {
+                    traceStart.mode = argument;
+                }
+                break;
+        }
+        droppedType = type;
+    } while (traceCount > 0 && (traceEvents[traceFirst] & TRACE_EVENT_TYPE_MASK) == TRACE_EVENT_VALUE);
+}
+
+static void traceStore(uint8_t event, uint16_t value)
+{
+    if (traceCount == TRACE_RECORDER_SIZE) {
+        traceDropOldest();
+    }
+
+    uint16_t index = (traceFirst + traceCount) & (TRACE_RECORDER_SIZE - 1);
+    traceEvents[index] = event;
+    traceValues[index] = value;
+    traceCount++;
+    traceRecordNumber++;
+}
+#endif
+
+void traceRecord(uint8_t event, uint32_t ticks)
+{
+#if TRACE_RECORDER_ENABLED == true
+    if (traceDumping) {
+        traceMissedEvents++;
+        return;
+    }
+    if (traceMissedEvents > 0) {
+        traceStore(TRACE_EVENT_MISSED, traceMissedEvents);
+        traceMissedEvents = 0;
+    }
+
+    int32_t delta = (int32_t) (ticks - traceLastTicks);
+    if (delta < -0x8000) {
+        // An edge that waited longer for the debouncer, such as one of an input of the other key mode,
+        // is recorded at the earliest tick that can be encoded
+        delta = -0x8000;
+    }
+    traceLastTicks += delta;
+
+    if (delta > 0x7FFF) {
+        uint16_t gap = (uint32_t) delta >> TRACE_GAP_SHIFT;
+        traceStore(TRACE_EVENT_GAP, gap);
+        delta -= (uint32_t) gap << TRACE_GAP_SHIFT;
+    }
+    traceStore(event, (uint16_t) delta);
+#endif
+}
+
+void traceRecordValue(uint8_t event, uint32_t ticks, uint16_t value)
+{
+#if TRACE_RECORDER_ENABLED == true
+    traceRecord(event, ticks);
+    if (!traceDumping) {
+        traceStore(TRACE_EVENT_VALUE, value);
+    }
+#endif
+}
+
+void traceRecordInputEdge(DebouncedInput *input, uint8_t traceInput)
+{
+#if TRACE_RECORDER_ENABLED == true
+    uint8_t edgeCount;
+    uint8_t rawState;
+    uint32_t edgeTicks;
+    do {
+        edgeCount = input->edgeCount;
+        rawState = input->rawState;
+        edgeTicks = input->edgeTicks;
+    } while (edgeCount != input->edgeCount);
+
+    if (edgeCount == traceEdgeCounts[traceInput]) {
+        return;
+    }
+    traceEdgeCounts[traceInput] = edgeCount;
+
+    traceRecord(TRACE_EVENT_PIN | traceInput | (rawState == HIGH ? TRACE_PIN_HIGH : 0), edgeTicks);
+#endif
+}
+
+void traceRecordSwitches(uint8_t switches, uint32_t ticks)
+{
+#if TRACE_RECORDER_ENABLED == true
+    if (switches == traceSwitches) {
+        return;
+    }
+    traceSwitches = switches;
+    traceRecord(TRACE_EVENT_SWITCHES | switches, ticks);
+#endif
+}
+
+void traceRecorderExpire(uint32_t ticks)
+{
+#if TRACE_RECORDER_ENABLED == true
+    if (!traceDumping && ticksOlderThan(traceLastTicks, ticks, TICKS_MAXIMUM_AGE)) {
+        traceStore(TRACE_EVENT_GAP, TICKS_MAXIMUM_AGE >> TRACE_GAP_SHIFT);
+        traceLastTicks += TICKS_MAXIMUM_AGE;
+    }
+#endif
+}
+
+#if TRACE_RECORDER_ENABLED == true
+static void traceWriteHeaderValue(uint8_t *header, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++) {
+        header[i] = value >> (8 * i);
+    }
+}
+#endif
+
+void traceRecorderStartDump(uint32_t ticks)
+{
+#if TRACE_RECORDER_ENABLED == true
+    if (traceDumping) {
+        return;
+    }
+
+    traceDumpHeader[0] = TRACE_DUMP_SYNC;
+    traceDumpHeader[1] = TRACE_DUMP_VERSION;
+    traceWriteHeaderValue(&traceDumpHeader[2], traceCount, 2);
+    traceWriteHeaderValue(&traceDumpHeader[4], traceStart.ticks, 4);
+    traceWriteHeaderValue(&traceDumpHeader[8], ticks, 4);
+    traceDumpHeader[12] = traceStart.flags;
+    traceDumpHeader[13] = traceStart.pins;
+    traceDumpHeader[14] = traceStart.switches;
+    traceDumpHeader[15] = traceStart.mode;
+    traceWriteHeaderValue(&traceDumpHeader[16], traceStart.speed, 2);
+
+    traceDumping = true;
+    traceDumpPosition = 0;
+    traceDumpChecksum = 0;
+#endif
+}
+
+bool traceRecorderDumping()
+{
+    return traceDumping;
+}
+
+#if TRACE_RECORDER_ENABLED == true
+static uint8_t traceDumpByte(uint16_t position)
+{
+    if (position < TRACE_DUMP_HEADER_SIZE) {
+        return traceDumpHeader[position];
+    }
+
+    uint16_t offset = position - TRACE_DUMP_HEADER_SIZE;
+    uint16_t record = offset / TRACE_RECORD_SIZE;
+    if (record == traceCount) {
+        return traceDumpChecksum;
+    }
+
+    uint16_t index = (traceFirst + record) & (TRACE_RECORDER_SIZE - 1);
+    switch (offset - record * TRACE_RECORD_SIZE) {
+        case 0:
+            return traceEvents[index];
+        case 1:
+            return traceValues[index];
+        default:
+            return traceValues[index] >> 8;
+    }
+}
+#endif
+
+void traceRecorderDump()
+{
+#if TRACE_RECORDER_ENABLED == true
+    uint16_t length = TRACE_DUMP_OVERHEAD + traceCount * TRACE_RECORD_SIZE;
+    uint8_t buffer[16];
+
+    while (traceDumping) {
+        int space = halSerialAvailableForWrite();
+        if (space <= 0) {
+            return;
+        }
+
+        uint8_t count = 0;
+        while (count < sizeof(buffer) && count < space && traceDumpPosition < length) {
+            uint8_t value = traceDumpByte(traceDumpPosition);
+            if (traceDumpPosition > 0) {
+                traceDumpChecksum += value;
+            }
+            buffer[count++] = value;
+            traceDumpPosition++;
+        }
+        halSerialWrite(buffer, count);
+
+        traceDumping = traceDumpPosition < length;
+    }
+#endif
+}
+
+uint32_t traceRecorderRecordCount()
+{
+    return traceRecordNumber;
+}
+
+bool traceRecorderReadRecord(uint32_t number, uint8_t *event, uint16_t *value)
+{
+    if (number >= traceRecordNumber || traceRecordNumber - number > traceCount) {
+        return false;
+    }
+
+    uint16_t index = (traceFirst + traceCount - (traceRecordNumber - number)) & (TRACE_RECORDER_SIZE - 1);
+    *event = traceEvents[index];
+    *value = traceValues[index];
+    return true;
+}
+
+const TraceState *traceRecorderStartState()
+{
+    return &traceStart;
+}
@@ -0,0 +1,96 @@
+/**
+ * Arduino USB Morse Key adapter for Web Radio Control amateur radio remote control software
+ * Copyright (C) 2020-2023 Mikael Nousiainen OH3BHX <mikael@webradiocontrol.tech>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Always-on trace of the keyer inputs and outputs in a RAM ring buffer (see trace_format.h): the pin edges
+ * and debounced changes of the inputs, the switches, speed, keyer mode and serial port input, the scheduled
+ * keyer elements and the key and PTT edges sent to the host. Each event takes a single 3-byte record with
+ * the tick delta-encoded, the oldest records are overwritten and folded into the start state, so the trace
+ * always covers the last TRACE_RECORDER_SIZE events.
+ *
+ * The events are recorded from the main loop only, so the recording needs no locking. The pin change
+ * interrupts only record the last edge of each input for the debouncer, which is what the main loop records:
+ * the edges between two loop iterations are not seen by the keyer either.
+ *
+ * Sending TRACE_SERIAL_COMMAND_DUMP to the CDC serial port dumps the trace. The dump is written as the serial
+ * port has space, the other binary serial output waits and the events of the dump period are counted
+ * as missed. The host-side decoder is in host/trace_decoder.h and the simulator replays a dump with --replay.
+ */
+
+#ifndef WRC_MORSE_KEY_ADAPTER_TRACE_RECORDER_H
+#define WRC_MORSE_KEY_ADAPTER_TRACE_RECORDER_H
+
+#include "hal.h"
+#include "debounce.h"
+#include "ticks.h"
+#include "trace_format.h"
+
+// Set to false to leave out the trace recorder
+#ifndef TRACE_RECORDER_ENABLED
+#define TRACE_RECORDER_ENABLED true
+#endif
+
+// Records in the ring buffer, 3 bytes each, must be a power of two
+#ifndef TRACE_RECORDER_SIZE
+#define TRACE_RECORDER_SIZE 128
+#endif
+
+// ASCII ENQ control character
+#define TRACE_SERIAL_COMMAND_DUMP 0x05
+
+// State before the first record of the trace
+struct TraceState {
+    uint32_t ticks;
+    uint8_t flags;
+    uint8_t pins;
+    uint8_t switches;
+    uint8_t mode;
+    uint16_t speed;
+};
+
+void traceRecorderInit(uint32_t ticks);
+
+// Records an event at the given tick, the event is the type and its argument
+void traceRecord(uint8_t event, uint32_t ticks);
+
+// Records an event with a value
+void traceRecordValue(uint8_t event, uint32_t ticks, uint16_t value);
+
+// Records the last pin edge of the input, if the debouncer has not seen it yet
+void traceRecordInputEdge(DebouncedInput *input, uint8_t traceInput);
+
+// Records the switch states (TRACE_SWITCH_ bits) if they have changed
+void traceRecordSwitches(uint8_t switches, uint32_t ticks);
+
+// Keeps the tick of the last record within the wraparound-safe distance of the current tick with gap records
+void traceRecorderExpire(uint32_t ticks);
+
+void traceRecorderStartDump(uint32_t ticks);
+
+bool traceRecorderDumping();
+
+// Writes the next part of the dump as the serial port has space
+void traceRecorderDump();
+
+// Total number of records stored since the start and the record of the given number, if it has not
+// been overwritten yet, for reading the trace as it is recorded in the simulator
+uint32_t traceRecorderRecordCount();
+
+bool traceRecorderReadRecord(uint32_t number, uint8_t *event, uint16_t *value);
+
+const TraceState *traceRecorderStartState();
+
+#endif
@@ -16,81 +16,35 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <Arduino.h>
-#include <Keyboard.h>
-
+#include "hal.h"
+#include "pins.h"
+#include "keyboard_definitions.h"
 #include "dds_sine_generator.h"
-
-// Uncomment to enable serial port debugging
-// #define DEBUG_INTERRUPTS
-// #define DEBUG_TIMING
-// #define DEBUG_SCHEDULING
-// #define DEBUG_KEY
-// #define DEBUG_CONTROLS
-
-// Pin definitions
-
-#define PIN_PTT 0
-
-#define PIN_KEY_RING 2
-#define PIN_KEY_TIP 3
-#define PIN_KEY_AUTOMATIC_MODE 8
-#define PIN_KEY_IAMBIC 9
-#define PIN_KEY_INVERTED 10
-
-#define PIN_ANALOG_KEYER_PITCH A0
-#define PIN_ANALOG_KEYER_SPEED A1
-
-#define PIN_STATE_KEY_ON LOW
-#define PIN_STATE_PTT_ON LOW
-
-// Keyboard definitions
-
-#define KEYBOARD_KEY_MODIFIER_PTT KEY_LEFT_ALT
-#define KEYBOARD_KEY_PTT_ON 'i'
-#define KEYBOARD_KEY_PTT_OFF 'o'
-
-#define KEYBOARD_KEY_STRAIGHT ','
-#define KEYBOARD_KEY_PASS_THROUGH_DIT '.'
-#define KEYBOARD_KEY_PASS_THROUGH_DAH '/'
-
-// Automatic keyer definitions
-
-#define KEYER_SYSTEM_VOLTAGE 5.00
-#define KEYER_ANALOG_INPUT_REFERENCE_VOLTAGE 3.20
-#define KEYER_ANALOG_INPUT_REFERENCE_MULTIPLIER (KEYER_ANALOG_INPUT_REFERENCE_VOLTAGE / KEYER_SYSTEM_VOLTAGE)
-
-#define KEYER_SPEED_WPM_MINIMUM 5
-#define KEYER_SPEED_WPM_MAXIMUM 50
-
-#define KEYER_SPEED_WPM_MINIMUM_DELTA 1
-#define KEYER_SPEED_WPM_MAXIMUM_ANALOG_VALUE (1023.0 * KEYER_ANALOG_INPUT_REFERENCE_MULTIPLIER)
-
-#define KEYER_PITCH_MINIMUM 300
-#define KEYER_PITCH_MAXIMUM 1200
-
-#define KEYER_PITCH_MINIMUM_DELTA 1
-#define KEYER_PITCH_MAXIMUM_ANALOG_VALUE (1023.0 * KEYER_ANALOG_INPUT_REFERENCE_MULTIPLIER)
-
-// Defaults
-
-#define KEYER_PITCH_DEFAULT 750.0
-#define KEYER_SPEED_WPM_DEFAULT 20
+#include "keyer_config.h"
+#include "keyer_tables.h"
+#include "keyer_modes.h"
+#include "ticks.h"
+#include "keyer_parameters.h"
+#include "keyer_queue.h"
+#include "keyer_output.h"
+#include "debounce.h"
+#include "adc_sampler.h"
+#include "key_stream.h"
+#include "raw_hid.h"
+#include "hid_report_queue.h"
+#include "text_keyer.h"
+#include "cw_decoder.h"
+#include "trace_recorder.h"
+#include "instrumentation.h"
+#include "debug_log.h"
+#include "timebase_calibration.h"
+#include "benchmark.h"
+#include "idle_mode.h"
+
+// The serial port debugging is enabled in debug_log.h
 
 // Definitions
 
-#define INPUT_STATE_ON_CHANGED 3
-#define INPUT_STATE_OFF_CHANGED 2
-#define INPUT_STATE_ON 1
-#define INPUT_STATE_OFF 0
-#define INPUT_STATE_IGNORE -1
-
-#define KEYER_ACTION_NONE 0
-#define KEYER_ACTION_DIT 1
-#define KEYER_ACTION_DAH 2
-
-#define DEBOUNCE_FILTER_SAMPLE_COUNT 100
-
 // Switch states
 
 volatile bool isAutomaticKey = false;
@@ -101,101 +55,135 @@ volatile bool isPassThroughMode = false;
 
 // Internal state
 
-volatile uint32_t ditDurationTicks = 0;
-volatile uint32_t dahDurationTicks = 0;
-volatile uint32_t pauseDurationTicks = 0;
-volatile uint32_t scheduleAheadTicks = 0;
-
-volatile int rawStraightState = HIGH;
-int previousRawStraightState = HIGH;
-volatile int rawDitState = HIGH;
-int previousRawDitState = HIGH;
-volatile int rawDahState = HIGH;
-int previousRawDahState = HIGH;
+DebouncedInput straightInput = DEBOUNCED_INPUT(DEBOUNCE_STRAIGHT_KEY_TICKS);
+DebouncedInput ditInput = DEBOUNCED_INPUT(DEBOUNCE_PADDLE_TICKS);
+DebouncedInput dahInput = DEBOUNCED_INPUT(DEBOUNCE_PADDLE_TICKS);
 
-bool ditActive = false;
-bool ditPending = false;
-bool dahActive = false;
-bool dahPending = false;
-
-uint32_t lastScheduledEventStartTime = 0;
+// End time and action of the last element pushed to the keyer queue
 uint32_t lastScheduledEventEndTime = 0;
 char lastScheduledEventAction = KEYER_ACTION_NONE;
 
+// Paddle memory: the taps and the squeezes of Iambic B not yet scheduled in the order they were made,
+// and the paddle pressed last, see keyer_modes.h
+uint8_t keyerTaps[KEYER_TYPEAHEAD_ELEMENTS];
+uint8_t keyerTapCount = 0;
+bool keyerDahPressedLast = false;
+
+// Taps ignored because the paddle memory was full
+uint32_t keyerTapsDropped = 0;
+
+// Dah paddle keying manually in bug mode
+bool keyerManualKeyOn = false;
+
+// Keyer modes of the iambic switch positions and the keyer of the current mode
+uint8_t keyerModeSwitchOn = KEYER_MODE_SWITCH_ON;
+uint8_t keyerModeSwitchOff = KEYER_MODE_SWITCH_OFF;
+bool keyerModeSwitchState = true;
+void (*keyerUpdate)(int ditState, int dahState);
+
 uint16_t previousRawKeyerSpeed = 0;
 uint16_t rawKeyerSpeed = 0;
 
 uint16_t previousRawKeyerPitch = 0;
 uint16_t rawKeyerPitch = 0;
 
-volatile int rawPttState = HIGH;
-int previousRawPttState = HIGH;
+// Keyer speed and the tuning word of the pitch before the timebase calibration
+uint8_t keyerSpeedWpm = KEYER_SPEED_WPM_DEFAULT;
+uint32_t keyerTuningWord = pwmFrequencyToTuningWord(KEYER_PITCH_DEFAULT);
+
+DebouncedInput pttInput = DEBOUNCED_INPUT(DEBOUNCE_PTT_TICKS);
 
 inline uint32_t getTicks()
 {
     return getPwmTicks();
 }
 
-int debounceInput(volatile int *state, int *previousState, int onState)
+// Publishes the element timing of the keyer speed for the tick rate of the timebase calibration
+void keyerPublishTiming()
 {
-    int initialState = *state;
-    if (initialState == *previousState) {
-        return initialState == onState ? INPUT_STATE_ON : INPUT_STATE_OFF;
-    }
+    KeyerParameters *parameters = keyerParametersEdit();
+    keyerTimingForSpeedWpm(keyerSpeedWpm, &parameters->timing);
+    timebaseCalibrateTiming(&parameters->timing);
+    keyerParametersPublish();
+}
 
-    // TODO: Debouncing does not work reliably here for pass-through mode
-    for (int i = 0; i < DEBOUNCE_FILTER_SAMPLE_COUNT; i++) {
-        if (*state != initialState) {
-            return INPUT_STATE_IGNORE;
-        }
-        // Delay without interrupts
-        // for (int j = 0; j < 10000; j++);
-    }
+void keyerSetSpeedWpm(int wpm)
+{
+    keyerSpeedWpm = wpm;
+    keyerPublishTiming();
 
-    *previousState = initialState;
+#if CW_DECODER_ENABLED == true
+    // The keyer output is decoded at the keyer speed from the start, and the potentiometer gives the decoder
+    // the speed of the straight key
+    cwDecoderSetDitTicks(keyerParameters()->timing.ditDurationTicks);
+#endif
 
-    return initialState == onState ? INPUT_STATE_ON_CHANGED : INPUT_STATE_OFF_CHANGED;
+#if defined(DEBUG_TIMING) || defined(DEBUG_SCHEDULING)
+    // The scheduled elements are logged without the timing
+    const KeyerParameters *parameters = keyerParameters();
+    debugLog(DEBUG_LOG_MESSAGE_TIMING, getTicks(), wpm,
+            parameters->timing.ditDurationTicks | ((uint32_t) parameters->timing.dahDurationTicks << 16),
+            parameters->timing.pauseDurationTicks | ((uint32_t) parameters->timing.scheduleAheadTicks << 16));
+#endif
 }
 
-void keyerSetSpeedWpm(int wpm)
+#if CW_DECODER_ENABLED == true && KEY_STREAM_OUTPUT == true
+static_assert(!(CW_DECODER_OUTPUT & CW_DECODER_OUTPUT_SERIAL),
+        "The decoded characters cannot be written to the serial port of the binary key stream");
+#endif
+
+// Sends a key edge as a keyboard key press or release, or as a raw HID edge in raw HID mode
+void sendKey(uint8_t output, char key, bool on, uint32_t ticks)
 {
-    // PARIS: 50 dot durations, 20 WPM -> 60ms per unit
-    // CODEX: 60 dot durations, 20 WPM -> 50ms per unit
-    double unitDurationMillis = (60.0 * 20.0) / (double) wpm; // Use PARIS
-
-    ditDurationTicks = millisToPwmTicks(unitDurationMillis);
-    dahDurationTicks = millisToPwmTicks(unitDurationMillis * 3.0);
-    pauseDurationTicks = millisToPwmTicks(unitDurationMillis);
-
-    scheduleAheadTicks = millisToPwmTicks(unitDurationMillis / 10.0);
-
-#ifdef DEBUG_TIMING
-    Serial.print("Timing: unit: ");
-    Serial.println(unitDurationMillis);
-    Serial.print("dit: ");
-    Serial.println(ditDurationTicks);
-    Serial.print("dah: ");
-    Serial.println(dahDurationTicks);
-    Serial.print("pause: ");
-    Serial.println(pauseDurationTicks);
-    Serial.print("ahead: ");
-    Serial.println(scheduleAheadTicks);
+#if CW_DECODER_ENABLED == true
+    // The straight key and the keyer output, the paddles of the pass-through mode are not decoded
+    if (output == RAW_HID_OUTPUT_KEY) {
+        cwDecoderRecordEdge(on, ticks);
+    }
 #endif
+
+    traceRecord(TRACE_EVENT_OUTPUT | output | (on ? TRACE_ON : 0), ticks);
+
+    if (rawHidIsEnabled()) {
+        rawHidRecord(output, on, ticks);
+    } else if (on) {
+        hidReportQueuePress(key);
+    } else {
+        hidReportQueueRelease(key);
+    }
+    instrumentationRecordOutputEdge(INSTRUMENTATION_LATENCY_KEY, ticks);
 }
 
-void generatePassThroughKeyEvent(volatile int *state, int *previousState, const char *name, char key)
+int debounceAndStreamInput(DebouncedInput *input, uint8_t onState, uint8_t streamInput, uint32_t ticks)
 {
-    int debouncedState = debounceInput(state, previousState, PIN_STATE_KEY_ON);
+    traceRecordInputEdge(input, streamInput);
+    int debouncedState = debounceInput(input, onState, ticks);
+    instrumentationRecordDebounce(streamInput, input->edgeCount,
+            debouncedState == INPUT_STATE_ON_CHANGED || debouncedState == INPUT_STATE_OFF_CHANGED);
+
+    if (debouncedState == INPUT_STATE_ON_CHANGED || debouncedState == INPUT_STATE_OFF_CHANGED) {
+        bool on = debouncedState == INPUT_STATE_ON_CHANGED;
+        keyStreamRecord(streamInput, on, debounceChangeTicks(input));
+        traceRecord(TRACE_EVENT_DEBOUNCED | streamInput | (on ? TRACE_ON : 0), ticks);
+    }
+
+    return debouncedState;
+}
+
+void generatePassThroughKeyEvent(DebouncedInput *input, uint8_t streamInput, uint8_t output, const char *name,
+        char key)
+{
+    int debouncedState = debounceAndStreamInput(input, PIN_STATE_KEY_ON, streamInput, getTicks());
 
     switch (debouncedState) {
         case INPUT_STATE_ON_CHANGED:
-            Keyboard.press(key);
+            sendKey(output, key, true, debounceChangeTicks(input));
             if (!isPassThroughMode) {
                 pwmSetEnabled(true);
             }
             break;
         case INPUT_STATE_OFF_CHANGED:
-            Keyboard.release(key);
+            sendKey(output, key, false, debounceChangeTicks(input));
             if (!isPassThroughMode) {
                 pwmSetEnabled(false);
             }
@@ -205,445 +193,662 @@ void generatePassThroughKeyEvent(volatile int *state, int *previousState, const
     }
 }
 
-bool keyerIsSchedulingPossibleAt(uint32_t ticks)
-{
-    return ((lastScheduledEventEndTime + pauseDurationTicks) < ticks + scheduleAheadTicks);
-}
-
-bool keyerIsEventActiveAt(uint32_t ticks)
+// The space is the time between the elements in addition to the pause, for the character and word spaces of the text keyer
+bool keyerIsSchedulingPossibleAt(uint32_t ticks, const KeyerTiming *timing, uint32_t spaceTicks)
 {
-    return (ticks >= lastScheduledEventStartTime && ticks < lastScheduledEventEndTime);
+    return ticksBefore(lastScheduledEventEndTime + timing->pauseDurationTicks + spaceTicks,
+            ticks + timing->scheduleAheadTicks);
 }
 
-void keyerKey(bool on, char key)
+void keyerKey(bool on, char key, uint32_t ticks)
 {
 #ifdef DEBUG_KEY
-    Serial.print("Keying: ");
-    Serial.println(key);
+    debugLog(DEBUG_LOG_MESSAGE_KEY, ticks, key, on, 0);
 #endif
 
-    if (on) {
-        Keyboard.press(key);
-    } else {
-        Keyboard.release(key);
-    }
-    pwmSetEnabled(on);
+    sendKey(RAW_HID_OUTPUT_KEY, key, on, ticks);
 }
 
-void keyerScheduleEvent(uint32_t ticks, char action, uint32_t actionDurationTicks)
+void keyerScheduleEvent(uint32_t ticks, char action, const KeyerTiming *timing, uint32_t spaceTicks)
 {
-    if (ticks > lastScheduledEventEndTime + pauseDurationTicks) {
-        lastScheduledEventStartTime = ticks;
-        lastScheduledEventEndTime = lastScheduledEventStartTime + actionDurationTicks;
+    uint32_t actionDurationTicks = action == KEYER_ACTION_DAH ? timing->dahDurationTicks : timing->ditDurationTicks;
+
+    uint32_t startTime;
+    if (ticksBefore(lastScheduledEventEndTime + timing->pauseDurationTicks + spaceTicks, ticks)) {
+        // An element following another one should have been scheduled before its start
+        if (lastScheduledEventAction != KEYER_ACTION_NONE) {
+            instrumentationRecordScheduleMiss();
+        }
+        startTime = ticks;
     } else {
-        lastScheduledEventStartTime = lastScheduledEventEndTime + pauseDurationTicks;
-        lastScheduledEventEndTime = lastScheduledEventStartTime + actionDurationTicks;
+        startTime = lastScheduledEventEndTime + timing->pauseDurationTicks + spaceTicks;
     }
 
+    if (!keyerQueuePush(startTime, startTime + actionDurationTicks, action)) {
+        return;
+    }
+
+    lastScheduledEventEndTime = startTime + actionDurationTicks;
     lastScheduledEventAction = action;
+    traceRecord(TRACE_EVENT_ELEMENT | action, startTime);
 
 #ifdef DEBUG_SCHEDULING
-    Serial.print("Scheduling event: ticks: ");
-    Serial.print(ticks);
-    Serial.print(" start: ");
-    Serial.print(lastScheduledEventStartTime);
-    Serial.print(" end: ");
-    Serial.print(lastScheduledEventEndTime);
-    Serial.print(" dit: ");
-    Serial.print(ditDurationTicks);
-    Serial.print(" dah: ");
-    Serial.print(dahDurationTicks);
-    Serial.print(" pause: ");
-    Serial.print(pauseDurationTicks);
-    Serial.print(" ahead: ");
-    Serial.println(scheduleAheadTicks);
+    debugLog(DEBUG_LOG_MESSAGE_SCHEDULE, ticks, startTime, lastScheduledEventEndTime, action);
 #endif
 }
 
-void keyerKeyIfActive(char key, uint32_t ticks, bool *isActive)
+// Keeps the end of the last element of an idle keyer within the wraparound-safe distance of the current tick
+void keyerExpireSchedule(uint32_t ticks)
 {
-    bool eventActive = keyerIsEventActiveAt(ticks);
+    if (ticksOlderThan(lastScheduledEventEndTime, ticks, TICKS_MAXIMUM_AGE)) {
+        lastScheduledEventEndTime = ticks - TICKS_MAXIMUM_AGE;
+    }
+}
 
-    if (!eventActive && (isActive != NULL && *isActive)) {
-        keyerKey(false, key);
-        *isActive = false;
-    } else if (eventActive && (isActive != NULL && !*isActive)) {
-        keyerKey(true, key);
-        *isActive = true;
+// The tick interrupt keys the scheduled elements and the sidetone, this sends the key reports
+void keyerKeyScheduledElements(char key)
+{
+    bool on;
+    uint32_t ticks;
+    while (keyerOutputPollEdge(&on, &ticks)) {
+        keyerKey(on, key, ticks);
     }
 }
 
-void keyerHandleActionChange(char action, int actionState, uint32_t actionDurationTicks,
-        bool *pending, bool *otherPending, uint32_t ticks)
+inline bool isInputOn(int state)
 {
-    bool scheduleNewEvent = keyerIsSchedulingPossibleAt(ticks);
+    return state == INPUT_STATE_ON || state == INPUT_STATE_ON_CHANGED;
+}
 
-    switch (actionState) {
-        case INPUT_STATE_ON_CHANGED:
-#ifdef DEBUG_SCHEDULING
-            Serial.print("Action: ON_CHANGED");
-            Serial.print(" actionState: ");
-            Serial.print(actionState);
-            Serial.print(" actionDurationTicks: ");
-            Serial.print(actionDurationTicks);
-            Serial.print(" pending: ");
-            Serial.print(*pending);
-            Serial.print(" otherPending: ");
-            Serial.print(*otherPending);
-            Serial.print(" scheduleNewEvent: ");
-            Serial.print(scheduleNewEvent);
-            Serial.print(" ticks: ");
-            Serial.print(ticks);
-            Serial.print(" start: ");
-            Serial.print(lastScheduledEventStartTime);
-            Serial.print(" end: ");
-            Serial.print(lastScheduledEventEndTime);
-            Serial.print(" dit: ");
-            Serial.print(ditDurationTicks);
-            Serial.print(" dah: ");
-            Serial.print(dahDurationTicks);
-            Serial.print(" pause: ");
-            Serial.print(pauseDurationTicks);
-            Serial.print(" ahead: ");
-            Serial.println(scheduleAheadTicks);
-#endif
-            if (scheduleNewEvent) {
-                keyerScheduleEvent(ticks, action, actionDurationTicks);
-            } else if (lastScheduledEventAction != action) {
-                *pending = true;
-                // A race condition could lead to both signals being pending
-                *otherPending = false;
-            }
-            break;
-        case INPUT_STATE_ON:
-#ifdef DEBUG_SCHEDULING
-            Serial.print("Action: ON ");
-            Serial.print(" actionState: ");
-            Serial.print(actionState);
-            Serial.print(" actionDurationTicks: ");
-            Serial.print(actionDurationTicks);
-            Serial.print(" pending: ");
-            Serial.print(*pending);
-            Serial.print(" otherPending: ");
-            Serial.print(*otherPending);
-            Serial.print(" scheduleNewEvent: ");
-            Serial.print(scheduleNewEvent);
-            Serial.print(" ticks: ");
-            Serial.print(ticks);
-            Serial.print(" start: ");
-            Serial.print(lastScheduledEventStartTime);
-            Serial.print(" end: ");
-            Serial.print(lastScheduledEventEndTime);
-            Serial.print(" dit: ");
-            Serial.print(ditDurationTicks);
-            Serial.print(" dah: ");
-            Serial.print(dahDurationTicks);
-            Serial.print(" pause: ");
-            Serial.print(pauseDurationTicks);
-            Serial.print(" ahead: ");
-            Serial.println(scheduleAheadTicks);
-#endif
-            if (scheduleNewEvent && !*otherPending) {
-                *pending = false;
-                keyerScheduleEvent(ticks, action, actionDurationTicks);
-            }
-            break;
-        case INPUT_STATE_OFF_CHANGED:
-#ifdef DEBUG_SCHEDULING
-            Serial.print("Action: OFF_CHANGED ");
-            Serial.print(" actionState: ");
-            Serial.print(actionState);
-            Serial.print(" actionDurationTicks: ");
-            Serial.print(actionDurationTicks);
-            Serial.print(" pending: ");
-            Serial.print(*pending);
-            Serial.print(" otherPending: ");
-            Serial.print(*otherPending);
-            Serial.print(" scheduleNewEvent: ");
-            Serial.print(scheduleNewEvent);
-            Serial.print(" ticks: ");
-            Serial.print(ticks);
-            Serial.print(" start: ");
-            Serial.print(lastScheduledEventStartTime);
-            Serial.print(" end: ");
-            Serial.print(lastScheduledEventEndTime);
-            Serial.print(" dit: ");
-            Serial.print(ditDurationTicks);
-            Serial.print(" dah: ");
-            Serial.print(dahDurationTicks);
-            Serial.print(" pause: ");
-            Serial.print(pauseDurationTicks);
-            Serial.print(" ahead: ");
-            Serial.println(scheduleAheadTicks);
-#endif
-        case INPUT_STATE_OFF:
-            if (*pending && scheduleNewEvent && !*otherPending) {
-                *pending = false;
-                keyerScheduleEvent(ticks, action, actionDurationTicks);
-            }
-            break;
+// Keys the dah paddle as a straight key, as the dah side of a semi-automatic bug
+void keyerUpdateManualKey(bool dahOn, uint32_t ticks, const KeyerTiming *timing)
+{
+    if (keyerManualKeyOn) {
+        if (!dahOn) {
+            keyerManualKeyOn = false;
+            sendKey(RAW_HID_OUTPUT_KEY, KEYBOARD_KEY_STRAIGHT, false, debounceChangeTicks(&dahInput));
+            pwmSetEnabled(false);
+            // The next automatic element follows after a pause
+            lastScheduledEventEndTime = ticks;
+            lastScheduledEventAction = KEYER_ACTION_DAH;
+        }
+        return;
+    }
+
+    // The manual element starts once the automatic elements and the pause after them have ended
+    if (dahOn && keyerQueueDepth() == 0 && ticksReached(ticks, lastScheduledEventEndTime + timing->pauseDurationTicks)) {
+        keyerManualKeyOn = true;
+        sendKey(RAW_HID_OUTPUT_KEY, KEYBOARD_KEY_STRAIGHT, true, ticks);
+        pwmSetEnabled(true);
+    }
+}
+
+// A tap made while the keyer cannot schedule is sent after the taps before it, extra taps are ignored and counted
+void keyerRecordTap(uint8_t action)
+{
+    if (keyerTapCount < KEYER_TYPEAHEAD_ELEMENTS) {
+        keyerTaps[keyerTapCount++] = action;
+    } else {
+        keyerTapsDropped++;
+        instrumentationRecordTapDropped();
+    }
+}
+
+bool keyerIsTapPending(uint8_t action)
+{
+    for (uint8_t i = 0; i < keyerTapCount; i++) {
+        if (keyerTaps[i] == action) {
+            return true;
+        }
     }
+    return false;
 }
 
-void keyerGenerateEvent(int ditState, int dahState, char key)
+uint8_t keyerPopTap()
 {
+    uint8_t action = keyerTaps[0];
+    keyerTapCount--;
+    for (uint8_t i = 0; i < keyerTapCount; i++) {
+        keyerTaps[i] = keyerTaps[i + 1];
+    }
+    return action;
+}
+
+// The keyer of a single mode, specialized at compile time by the mode traits
+template <uint8_t Mode>
+void keyerUpdateMode(int ditState, int dahState)
+{
+    typedef KeyerModeTraits<Mode> Traits;
     uint32_t ticks = getTicks();
+    const KeyerTiming *timing = &keyerParameters()->timing;
 
-    if (lastScheduledEventAction == KEYER_ACTION_DIT) {
-        if (isAutomaticKeyIambic) {
-            keyerHandleActionChange(KEYER_ACTION_DAH, dahState, dahDurationTicks, &dahPending, &ditPending, ticks);
-            keyerHandleActionChange(KEYER_ACTION_DIT, ditState, ditDurationTicks, &ditPending, &dahPending, ticks);
-        } else {
-            keyerHandleActionChange(KEYER_ACTION_DIT, ditState, ditDurationTicks, &ditPending, &dahPending, ticks);
-            keyerHandleActionChange(KEYER_ACTION_DAH, dahState, dahDurationTicks, &dahPending, &ditPending, ticks);
+    bool ditOn = isInputOn(ditState);
+    bool dahOn = isInputOn(dahState);
+
+    // Paddle break-in: the paddles take over from the text keyer
+    if (ditState == INPUT_STATE_ON_CHANGED || dahState == INPUT_STATE_ON_CHANGED) {
+        textKeyerCancel();
+    }
+
+    if (ditState == INPUT_STATE_ON_CHANGED) {
+        keyerRecordTap(KEYER_ACTION_DIT);
+        keyerDahPressedLast = false;
+    }
+
+    if (Traits::manualDah) {
+        keyerUpdateManualKey(dahOn, ticks, timing);
+        if (keyerManualKeyOn || dahOn) {
+            // No automatic elements while the manual key is closed
+            return;
         }
-    } else {
-        if (isAutomaticKeyIambic) {
-            keyerHandleActionChange(KEYER_ACTION_DIT, ditState, ditDurationTicks, &ditPending, &dahPending, ticks);
-            keyerHandleActionChange(KEYER_ACTION_DAH, dahState, dahDurationTicks, &dahPending, &ditPending, ticks);
-        } else {
-            keyerHandleActionChange(KEYER_ACTION_DAH, dahState, dahDurationTicks, &dahPending, &ditPending, ticks);
-            keyerHandleActionChange(KEYER_ACTION_DIT, ditState, ditDurationTicks, &ditPending, &dahPending, ticks);
+    } else if (dahState == INPUT_STATE_ON_CHANGED) {
+        keyerRecordTap(KEYER_ACTION_DAH);
+        keyerDahPressedLast = true;
+    }
+
+    if (Traits::squeezeMemory && keyerTapCount < KEYER_TYPEAHEAD_ELEMENTS) {
+        // The opposite paddle held at any time during an element is sent next even if it is released. While the
+        // paddle memory is full a squeeze is not recorded, it is recorded if still held once a tap has been sent.
+        if (lastScheduledEventAction == KEYER_ACTION_DIT && dahOn && !keyerIsTapPending(KEYER_ACTION_DAH)) {
+            keyerRecordTap(KEYER_ACTION_DAH);
+        } else if (lastScheduledEventAction == KEYER_ACTION_DAH && ditOn && !keyerIsTapPending(KEYER_ACTION_DIT)) {
+            keyerRecordTap(KEYER_ACTION_DIT);
         }
     }
 
-    bool *active = NULL;
-    switch (lastScheduledEventAction) {
+    if (!keyerIsSchedulingPossibleAt(ticks, timing, 0)) {
+        return;
+    }
+
+    // The taps are sent in order before the mode decides from the paddles held
+    uint8_t action = keyerTapCount > 0 ? keyerPopTap() : keyerModeNextAction(Traits::transitions(),
+            lastScheduledEventAction, ditOn, dahOn, keyerDahPressedLast);
+
+    switch (action) {
         case KEYER_ACTION_DIT:
-            active = &ditActive;
-            break;
         case KEYER_ACTION_DAH:
-            active = &dahActive;
+            keyerScheduleEvent(ticks, action, timing, 0);
+            break;
+        default:
+            // The keyer is idle, the next element starts a new sequence
+            lastScheduledEventAction = KEYER_ACTION_NONE;
             break;
     }
+}
+
+// Schedules the next element of the text received from the serial port while the paddles are idle
+void keyerUpdateText(int ditState, int dahState)
+{
+    if (isInputOn(ditState) || isInputOn(dahState) || keyerManualKeyOn) {
+        return;
+    }
 
-    keyerKeyIfActive(key, ticks, active);
+    uint8_t spaceUnits;
+    uint8_t action = textKeyerPeek(&spaceUnits);
+    if (action == KEYER_ACTION_NONE) {
+        return;
+    }
+
+    uint32_t ticks = getTicks();
+    const KeyerTiming *timing = &keyerParameters()->timing;
+    uint32_t spaceTicks = spaceUnits * (uint32_t) timing->ditDurationTicks;
+    if (!keyerIsSchedulingPossibleAt(ticks, timing, spaceTicks)) {
+        return;
+    }
+
+    keyerScheduleEvent(ticks, action, timing, spaceTicks);
+    textKeyerPop();
 }
 
-void keyerHandleSpeedChange()
+void keyerSetMode(uint8_t mode)
 {
-    rawKeyerSpeed = analogRead(PIN_ANALOG_KEYER_SPEED);
+    if (keyerManualKeyOn) {
+        keyerManualKeyOn = false;
+        sendKey(RAW_HID_OUTPUT_KEY, KEYBOARD_KEY_STRAIGHT, false, getTicks());
+        pwmSetEnabled(false);
+    }
+    keyerTapCount = 0;
+    traceRecord(TRACE_EVENT_MODE | mode, getTicks());
+
+    switch (mode) {
+        case KEYER_MODE_IAMBIC_A:
+            keyerUpdate = keyerUpdateMode<KEYER_MODE_IAMBIC_A>;
+            break;
+        case KEYER_MODE_ULTIMATIC:
+            keyerUpdate = keyerUpdateMode<KEYER_MODE_ULTIMATIC>;
+            break;
+        case KEYER_MODE_BUG:
+            keyerUpdate = keyerUpdateMode<KEYER_MODE_BUG>;
+            break;
+        case KEYER_MODE_IAMBIC_B:
+        default:
+            keyerUpdate = keyerUpdateMode<KEYER_MODE_IAMBIC_B>;
+            break;
+    }
+
+#ifdef DEBUG_SCHEDULING
+    debugLog(DEBUG_LOG_MESSAGE_KEYER_MODE, getTicks(), mode, 0, 0);
+#endif
+}
+
+// Sets the keyer modes of the iambic switch positions
+void keyerSetSwitchModes(uint8_t switchOnMode, uint8_t switchOffMode)
+{
+    keyerModeSwitchOn = switchOnMode;
+    keyerModeSwitchOff = switchOffMode;
+    keyerSetMode(keyerModeSwitchState ? keyerModeSwitchOn : keyerModeSwitchOff);
+}
 
-    // Ignore small changes
-    if (rawKeyerSpeed >= previousRawKeyerSpeed - KEYER_SPEED_WPM_MINIMUM_DELTA &&
-        rawKeyerSpeed <= previousRawKeyerSpeed + KEYER_SPEED_WPM_MINIMUM_DELTA) {
+void keyerHandleModeSwitch()
+{
+    if (isAutomaticKeyIambic == keyerModeSwitchState) {
         return;
     }
-    previousRawKeyerSpeed = rawKeyerSpeed;
 
-    int speedWpm = KEYER_SPEED_WPM_MINIMUM +
-                   ((KEYER_SPEED_WPM_MAXIMUM - KEYER_SPEED_WPM_MINIMUM) / KEYER_SPEED_WPM_MAXIMUM_ANALOG_VALUE) *
-                   (double) rawKeyerSpeed;
-    if (speedWpm > KEYER_SPEED_WPM_MAXIMUM) {
-        speedWpm = KEYER_SPEED_WPM_MAXIMUM;
+    keyerModeSwitchState = isAutomaticKeyIambic;
+    keyerSetMode(keyerModeSwitchState ? keyerModeSwitchOn : keyerModeSwitchOff);
+}
+
+void keyerHandleSpeedChange()
+{
+    // Small changes are already filtered out by the ADC sampler hysteresis
+    rawKeyerSpeed = adcSamplerRead(ADC_SAMPLER_CHANNEL_SPEED);
+    if (rawKeyerSpeed == previousRawKeyerSpeed) {
+        return;
     }
+    previousRawKeyerSpeed = rawKeyerSpeed;
+
+    traceRecordValue(TRACE_EVENT_SPEED, getTicks(), rawKeyerSpeed);
+
+    int speedWpm = keyerSpeedWpmForAnalogValue(rawKeyerSpeed);
     keyerSetSpeedWpm(speedWpm);
 
 #ifdef DEBUG_CONTROLS
-    Serial.print("Raw Speed: ");
-    Serial.print((int) rawKeyerSpeed);
-    Serial.println();
-
-    Serial.print("Speed: ");
-    Serial.print(speedWpm);
-    Serial.println();
+    debugLog(DEBUG_LOG_MESSAGE_SPEED, getTicks(), rawKeyerSpeed, speedWpm, 0);
 #endif
 }
 
-void keyerHandlePitchChange()
+void keyerSetTuningWord(uint32_t tuningWord)
 {
-    rawKeyerPitch = analogRead(PIN_ANALOG_KEYER_PITCH);
+    keyerTuningWord = tuningWord;
+    pwmSetTuningWord(timebaseCalibrateTuningWord(tuningWord));
+}
 
-    // Ignore small changes
-    if (rawKeyerPitch >= previousRawKeyerPitch - KEYER_PITCH_MINIMUM_DELTA &&
-        rawKeyerPitch <= previousRawKeyerPitch + KEYER_PITCH_MINIMUM_DELTA) {
+void keyerHandlePitchChange()
+{
+    rawKeyerPitch = adcSamplerRead(ADC_SAMPLER_CHANNEL_PITCH);
+    if (rawKeyerPitch == previousRawKeyerPitch) {
         return;
     }
     previousRawKeyerPitch = rawKeyerPitch;
 
-    double pitch =
-            KEYER_PITCH_MINIMUM +
-            ((KEYER_PITCH_MAXIMUM - KEYER_PITCH_MINIMUM) / KEYER_PITCH_MAXIMUM_ANALOG_VALUE) * (double) rawKeyerPitch;
-    if (pitch > KEYER_PITCH_MAXIMUM) {
-        pitch = KEYER_PITCH_MAXIMUM;
-    }
-    pwmSetFrequency(pitch);
+    uint32_t tuningWord = keyerTuningWordForAnalogValue(rawKeyerPitch);
+    keyerSetTuningWord(tuningWord);
 
 #ifdef DEBUG_CONTROLS
-    Serial.print("Raw Pitch: ");
-    Serial.print((int) rawKeyerPitch);
-    Serial.println();
-
-    Serial.print("Pitch: ");
-    Serial.print((int) pitch);
-    Serial.println();
+    debugLog(DEBUG_LOG_MESSAGE_PITCH, getTicks(), rawKeyerPitch, tuningWord, 0);
 #endif
 }
 
-inline void handleInterruptAndReadPin(int pin, volatile int *state)
+template <uint8_t Pin>
+inline void handleInterruptAndReadPin(DebouncedInput *input)
 {
-    *state = digitalRead(pin);
+    debounceRecordEdge(input, pinRead<Pin>(), getTicks());
 }
 
-void pinChangeHandleRing()
+template <uint8_t Pin>
+inline void logInterrupt(uint8_t logPin)
 {
 #ifdef DEBUG_INTERRUPTS
-    Serial.println("Interrupt: ring");
+    debugLog(DEBUG_LOG_MESSAGE_INTERRUPT, getTicks(), logPin, pinRead<Pin>(), 0);
 #endif
+}
+
+void pinChangeHandleRing()
+{
+    logInterrupt<PIN_KEY_RING>(DEBUG_LOG_PIN_RING);
     if (!isAutomaticKey) {
         return;
     }
+    idleModeWake();
 
     if (isAutomaticKeyInverted) {
-        handleInterruptAndReadPin(PIN_KEY_RING, &rawDitState);
+        handleInterruptAndReadPin<PIN_KEY_RING>(&ditInput);
     } else {
-        handleInterruptAndReadPin(PIN_KEY_RING, &rawDahState);
+        handleInterruptAndReadPin<PIN_KEY_RING>(&dahInput);
     }
 }
 
 void pinChangeHandleTip()
 {
-#ifdef DEBUG_INTERRUPTS
-    Serial.println("Interrupt: tip");
-#endif
+    logInterrupt<PIN_KEY_TIP>(DEBUG_LOG_PIN_TIP);
+    idleModeWake();
     if (isAutomaticKey) {
         if (isAutomaticKeyInverted) {
-            handleInterruptAndReadPin(PIN_KEY_TIP, &rawDahState);
+            handleInterruptAndReadPin<PIN_KEY_TIP>(&dahInput);
         } else {
-            handleInterruptAndReadPin(PIN_KEY_TIP, &rawDitState);
+            handleInterruptAndReadPin<PIN_KEY_TIP>(&ditInput);
         }
     } else {
-        handleInterruptAndReadPin(PIN_KEY_TIP, &rawStraightState);
+        handleInterruptAndReadPin<PIN_KEY_TIP>(&straightInput);
     }
 }
 
 void pinChangeHandlePtt()
 {
-#ifdef DEBUG_INTERRUPTS
-    Serial.println("Interrupt: PTT");
-#endif
+    logInterrupt<PIN_PTT>(DEBUG_LOG_PIN_PTT);
+    idleModeWake();
 
-    handleInterruptAndReadPin(PIN_PTT, &rawPttState);
+    handleInterruptAndReadPin<PIN_PTT>(&pttInput);
 }
 
-inline void readPinToBoolean(int pin, volatile bool *value)
+// The mode switches are read from one snapshot of their port
+inline void readSwitches()
 {
-    int state = digitalRead(pin);
-    *value = state == HIGH;
+    uint8_t levels = halPortRead(PIN_SWITCH_PORT);
+    isAutomaticKey = pinLevel(PIN_KEY_AUTOMATIC_MODE, levels) == HIGH;
+    isAutomaticKeyIambic = pinLevel(PIN_KEY_IAMBIC, levels) == HIGH;
+    isAutomaticKeyInverted = pinLevel(PIN_KEY_INVERTED, levels) == HIGH;
 }
 
-void setPtt(bool on)
+#if IDLE_MODE_ENABLED == true
+// A pressed key or PTT, or anything still to be keyed, sounded or sent keeps the adapter out of the idle mode
+bool keyerIsActive()
 {
-    if (on) {
-#ifdef KEYBOARD_KEY_MODIFIER_PTT
-        Keyboard.press(KEYBOARD_KEY_MODIFIER_PTT);
+    uint8_t spaceUnits;
+    return pinRead<PIN_KEY_TIP>() == PIN_STATE_KEY_ON
+            || (isAutomaticKey && pinRead<PIN_KEY_RING>() == PIN_STATE_KEY_ON)
+            || pinRead<PIN_PTT>() == PIN_STATE_PTT_ON
+            || keyerManualKeyOn
+            || keyerQueueDepth() > 0
+            || pwmIsEnabled()
+            || pwmIsEnvelopeRamping()
+            || hidReportQueueDepth() > 0
+            || textKeyerPeek(&spaceUnits) != KEYER_ACTION_NONE;
+}
 #endif
-        Keyboard.press(KEYBOARD_KEY_PTT_ON);
-        Keyboard.release(KEYBOARD_KEY_PTT_ON);
+
+void setPtt(bool on, uint32_t ticks)
+{
+    traceRecord(TRACE_EVENT_OUTPUT | RAW_HID_OUTPUT_PTT | (on ? TRACE_ON : 0), ticks);
+#ifdef DEBUG_PTT
+    debugLog(DEBUG_LOG_MESSAGE_PTT, ticks, on, 0, 0);
+#endif
+
+    if (rawHidIsEnabled()) {
+        // A single edge instead of the keyboard key presses and releases
+        rawHidRecord(RAW_HID_OUTPUT_PTT, on, ticks);
+    } else if (on) {
 #ifdef KEYBOARD_KEY_MODIFIER_PTT
-        Keyboard.release(KEYBOARD_KEY_MODIFIER_PTT);
+        hidReportQueuePress(KEYBOARD_KEY_MODIFIER_PTT);
 #endif
-#ifdef DEBUG_PTT
-        Serial.println("PTT on");
+        hidReportQueuePress(KEYBOARD_KEY_PTT_ON);
+        hidReportQueueRelease(KEYBOARD_KEY_PTT_ON);
+#ifdef KEYBOARD_KEY_MODIFIER_PTT
+        hidReportQueueRelease(KEYBOARD_KEY_MODIFIER_PTT);
 #endif
     } else {
 #ifdef KEYBOARD_KEY_MODIFIER_PTT
-        Keyboard.press(KEYBOARD_KEY_MODIFIER_PTT);
+        hidReportQueuePress(KEYBOARD_KEY_MODIFIER_PTT);
 #endif
-        Keyboard.press(KEYBOARD_KEY_PTT_OFF);
-        Keyboard.release(KEYBOARD_KEY_PTT_OFF);
+        hidReportQueuePress(KEYBOARD_KEY_PTT_OFF);
+        hidReportQueueRelease(KEYBOARD_KEY_PTT_OFF);
 #ifdef KEYBOARD_KEY_MODIFIER_PTT
-        Keyboard.release(KEYBOARD_KEY_MODIFIER_PTT);
-#endif
-#ifdef DEBUG_PTT
-        Serial.println("PTT off");
+        hidReportQueueRelease(KEYBOARD_KEY_MODIFIER_PTT);
 #endif
     }
+    instrumentationRecordOutputEdge(INSTRUMENTATION_LATENCY_PTT, ticks);
 }
 
 void handlePttChange()
 {
-    int debouncedState = debounceInput(&rawPttState, &previousRawPttState, PIN_STATE_PTT_ON);
+    int debouncedState = debounceAndStreamInput(&pttInput, PIN_STATE_PTT_ON, KEY_STREAM_INPUT_PTT, getTicks());
 
     switch (debouncedState) {
         case INPUT_STATE_ON_CHANGED:
-            setPtt(true);
+            setPtt(true, debounceChangeTicks(&pttInput));
             break;
         case INPUT_STATE_OFF_CHANGED:
-            setPtt(false);
+            setPtt(false, debounceChangeTicks(&pttInput));
             break;
         default:
             break;
     }
 }
 
+#if CW_DECODER_ENABLED == true
+// Types a decoded character in the US layout, with shift for the shifted characters. The characters on the keys
+// used for keying are typed as CW_DECODER_KEYBOARD_MARKER.
+void typeDecodedCharacter(uint8_t character)
+{
+    // Lowercase so that the letters are typed without shift
+    if (character >= 'A' && character <= 'Z') {
+        character += 'a' - 'A';
+    }
+    uint8_t key = hidUnshiftedKey(character);
+    if (hidUsageForKey(key) == 0 || key == KEYBOARD_KEY_STRAIGHT || key == KEYBOARD_KEY_PASS_THROUGH_DIT
+            || key == KEYBOARD_KEY_PASS_THROUGH_DAH) {
+        character = CW_DECODER_KEYBOARD_MARKER;
+        key = hidUnshiftedKey(character);
+    }
+
+    bool shift = key != character;
+    if (shift) {
+        hidReportQueuePress(KEY_LEFT_SHIFT);
+    }
+    hidReportQueuePress(key);
+    hidReportQueueRelease(key);
+    if (shift) {
+        hidReportQueueRelease(KEY_LEFT_SHIFT);
+    }
+}
+#endif
+
+// Writes the decoded characters to the serial port and/or types them with the keyboard
+void handleDecodedCharacters()
+{
+#if CW_DECODER_ENABLED == true
+    cwDecoderUpdate(getTicks());
+
+    uint8_t character;
+    // The characters wait while the trace or the instrumentation readout is written to the serial port
+    while ((!(CW_DECODER_OUTPUT & CW_DECODER_OUTPUT_SERIAL) || (halSerialAvailableForWrite() > 0
+            && !traceRecorderDumping() && !instrumentationReadingOut())) && cwDecoderRead(&character)) {
+        if (CW_DECODER_OUTPUT & CW_DECODER_OUTPUT_SERIAL) {
+            halSerialWrite(&character, 1);
+        }
+        if ((CW_DECODER_OUTPUT & CW_DECODER_OUTPUT_KEYBOARD) && !rawHidIsEnabled()) {
+            typeDecodedCharacter(character);
+        }
+    }
+#endif
+}
+
+void handleSerialCommands()
+{
+#if RAW_HID_ENABLED == true || TEXT_KEYER_ENABLED == true || TRACE_RECORDER_ENABLED == true \
+        || INSTRUMENTATION_ENABLED == true
+    // The text is keyed only in automatic key mode, in the other modes it is dropped
+    bool textKeyed = isAutomaticKey && !isPassThroughMode;
+
+    while (halSerialAvailable() > 0) {
+        // The commands are control characters and are read at once. While the text buffer is full the text
+        // characters are left in the USB buffer, which makes the host wait.
+        int character = halSerialPeek();
+        if (TEXT_KEYER_ENABLED == true && textKeyed && character >= ' ' && textKeyerAvailableForWrite() == 0) {
+            break;
+        }
+        halSerialRead();
+
+        if (character == TRACE_SERIAL_COMMAND_DUMP) {
+            traceRecorderStartDump(getTicks());
+            continue;
+        }
+        if (INSTRUMENTATION_ENABLED == true && character == INSTRUMENTATION_SERIAL_COMMAND_READ) {
+            instrumentationStartReadout();
+            continue;
+        }
+        traceRecordValue(TRACE_EVENT_SERIAL, getTicks(), character);
+
+        switch (character) {
+#if RAW_HID_ENABLED == true
+            case RAW_HID_SERIAL_COMMAND_ENABLE:
+                // Keys pressed in keyboard mode would otherwise stay pressed
+                hidReportQueueReleaseAll();
+                rawHidSetEnabled(true);
+                break;
+            case RAW_HID_SERIAL_COMMAND_DISABLE:
+                rawHidSetEnabled(false);
+                break;
+#endif
+#if TEXT_KEYER_ENABLED == true
+            case TEXT_KEYER_SERIAL_COMMAND_CANCEL:
+                textKeyerCancel();
+                break;
+            default:
+                if (textKeyed) {
+                    textKeyerWrite(character);
+                }
+                break;
+#else
+            default:
+                break;
+#endif
+        }
+    }
+#endif
+}
+
 void setup()
 {
     // while (!Serial);
 
-    Serial.begin(115200);
-    Serial.println("USB Morse Key adapter initializing");
+    halSerialBegin(115200);
+    halSerialPrintln("USB Morse Key adapter initializing");
+
+#ifdef ENABLE_BENCHMARKS
+    while (!halSerialConnected());
+    benchmarkRun();
+#endif
 
     // Morse keyer
 
-    pinMode(PIN_KEY_RING, INPUT_PULLUP);
-    pinMode(PIN_KEY_TIP, INPUT_PULLUP);
+    halPinModeInputPullup(PIN_KEY_RING);
+    halPinModeInputPullup(PIN_KEY_TIP);
+
+    halPinModeInputPullup(PIN_KEY_AUTOMATIC_MODE);
+    halPinModeInputPullup(PIN_KEY_IAMBIC);
+    halPinModeInputPullup(PIN_KEY_INVERTED);
 
-    pinMode(PIN_KEY_AUTOMATIC_MODE, INPUT_PULLUP);
-    pinMode(PIN_KEY_IAMBIC, INPUT_PULLUP);
-    pinMode(PIN_KEY_INVERTED, INPUT_PULLUP);
+    halPinModeInput(PIN_ANALOG_KEYER_PITCH);
+    halPinModeInput(PIN_ANALOG_KEYER_SPEED);
 
-    pinMode(PIN_ANALOG_KEYER_PITCH, INPUT);
-    pinMode(PIN_ANALOG_KEYER_SPEED, INPUT);
+    traceRecorderInit(getTicks());
+    instrumentationInit();
 
+    timebaseCalibrationInit();
     pwmInit(KEYER_PITCH_DEFAULT);
+    keyerSetTuningWord(keyerTuningWord);
     keyerSetSpeedWpm(KEYER_SPEED_WPM_DEFAULT);
+    cwDecoderReset(keyerParameters()->timing.ditDurationTicks);
+
+    isAutomaticKeyIambic = pinRead<PIN_KEY_IAMBIC>() == HIGH;
+    keyerModeSwitchState = isAutomaticKeyIambic;
+    keyerSetMode(keyerModeSwitchState ? keyerModeSwitchOn : keyerModeSwitchOff);
 
-    attachInterrupt(digitalPinToInterrupt(PIN_KEY_RING), pinChangeHandleRing, CHANGE);
-    attachInterrupt(digitalPinToInterrupt(PIN_KEY_TIP), pinChangeHandleTip, CHANGE);
+    // The conversions are triggered by the PWM timer
+    adcSamplerInit();
+
+    halAttachPinChangeInterrupt(PIN_KEY_RING, pinChangeHandleRing);
+    halAttachPinChangeInterrupt(PIN_KEY_TIP, pinChangeHandleTip);
 
     // PTT switch
 
-    pinMode(PIN_PTT, INPUT_PULLUP);
+    halPinModeInputPullup(PIN_PTT);
 
-    attachInterrupt(digitalPinToInterrupt(PIN_PTT), pinChangeHandlePtt, CHANGE);
+    halAttachPinChangeInterrupt(PIN_PTT, pinChangeHandlePtt);
 
     // Keyboard setup
 
-    Keyboard.begin();
+    halKeyboardBegin();
 }
 
 void loop()
 {
-    readPinToBoolean(PIN_KEY_AUTOMATIC_MODE, &isAutomaticKey);
-    readPinToBoolean(PIN_KEY_IAMBIC, &isAutomaticKeyIambic);
-    readPinToBoolean(PIN_KEY_INVERTED, &isAutomaticKeyInverted);
+    instrumentationRecordLoop(getTicks());
 
-    if (!pwmIsEnabled()) {
-        // Read analog inputs only when PWM (CW sidetone) is not active to minimize changes caused by voltage fluctuations
-        keyerHandleSpeedChange();
-        keyerHandlePitchChange();
+    if (timebaseCalibrationUpdate(getTicks())) {
+        // The element timing and the sidetone pitch follow the measured tick rate, the decoder adapts by itself
+        keyerPublishTiming();
+        keyerSetTuningWord(keyerTuningWord);
     }
 
+    pwmRefillSamples();
+
+    keyerKeyScheduledElements(KEYBOARD_KEY_STRAIGHT);
+    keyerExpireSchedule(getTicks());
+    traceRecorderExpire(getTicks());
+
+    handleSerialCommands();
+
+    readSwitches();
+#if TEXT_KEYER_ENABLED == true
+    // Text buffered in automatic key mode is not keyed after a switch to another mode
+    if (!isAutomaticKey || isPassThroughMode) {
+        textKeyerCancel();
+    }
+#endif
+    traceRecordSwitches((isAutomaticKey ? TRACE_SWITCH_AUTOMATIC : 0) | (isAutomaticKeyIambic ? TRACE_SWITCH_IAMBIC : 0)
+            | (isAutomaticKeyInverted ? TRACE_SWITCH_INVERTED : 0), getTicks());
+
+#if IDLE_MODE_ENABLED == true
+    // Before the keyers, so that text received in this pass is keyed at the full tick rate
+    idleModeUpdate(keyerIsActive(), getTicks());
+#endif
+
+    keyerHandleModeSwitch();
+
+    // The potentiometers are sampled in sync with the PWM, so they can be read also while the sidetone is on
+    keyerHandleSpeedChange();
+    keyerHandlePitchChange();
+
     handlePttChange();
 
     if (isPassThroughMode) {
         if (isAutomaticKey) {
-            generatePassThroughKeyEvent(&rawDitState, &previousRawDitState, "dit: ", KEYBOARD_KEY_PASS_THROUGH_DIT);
-            generatePassThroughKeyEvent(&rawDahState, &previousRawDahState, "dah: ", KEYBOARD_KEY_PASS_THROUGH_DAH);
+            generatePassThroughKeyEvent(&ditInput, KEY_STREAM_INPUT_DIT, RAW_HID_OUTPUT_PASS_THROUGH_DIT,
+                    "dit: ", KEYBOARD_KEY_PASS_THROUGH_DIT);
+            generatePassThroughKeyEvent(&dahInput, KEY_STREAM_INPUT_DAH, RAW_HID_OUTPUT_PASS_THROUGH_DAH,
+                    "dah: ", KEYBOARD_KEY_PASS_THROUGH_DAH);
         } else {
-            generatePassThroughKeyEvent(&rawStraightState, &previousRawStraightState,
+            generatePassThroughKeyEvent(&straightInput, KEY_STREAM_INPUT_STRAIGHT, RAW_HID_OUTPUT_KEY,
                     "straight: ", KEYBOARD_KEY_STRAIGHT);
         }
     } else {
         if (isAutomaticKey) {
-            int ditStateDebounced = debounceInput(&rawDitState, &previousRawDitState, PIN_STATE_KEY_ON);
-            int dahStateDebounced = debounceInput(&rawDahState, &previousRawDahState, PIN_STATE_KEY_ON);
+            uint32_t ticks = getTicks();
+            int ditStateDebounced = debounceAndStreamInput(&ditInput, PIN_STATE_KEY_ON, KEY_STREAM_INPUT_DIT, ticks);
+            int dahStateDebounced = debounceAndStreamInput(&dahInput, PIN_STATE_KEY_ON, KEY_STREAM_INPUT_DAH, ticks);
 
-            keyerGenerateEvent(ditStateDebounced, dahStateDebounced, KEYBOARD_KEY_STRAIGHT);
+            keyerUpdate(ditStateDebounced, dahStateDebounced);
+            keyerUpdateText(ditStateDebounced, dahStateDebounced);
         } else {
-            generatePassThroughKeyEvent(&rawStraightState, &previousRawStraightState,
+            generatePassThroughKeyEvent(&straightInput, KEY_STREAM_INPUT_STRAIGHT, RAW_HID_OUTPUT_KEY,
                     "straight: ", KEYBOARD_KEY_STRAIGHT);
         }
     }
+
+    handleDecodedCharacters();
+
+    hidReportQueueDrain(getTicks());
+    traceRecorderDump();
+    instrumentationReadout();
+    // The log is written only while no element is scheduled or keyed, so that it never delays the keying
+    debugLogDrain(keyerQueueDepth() == 0 && !pwmIsEnabled());
+    timebaseCalibrationStore(keyerQueueDepth() == 0 && !pwmIsEnabled());
+    keyStreamFlush();
+    rawHidFlush();
+    instrumentationUpdateLatency(getTicks());
+
+    idleModeSleep();
 }